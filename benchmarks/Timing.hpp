@@ -0,0 +1,24 @@
+#ifndef CPPTENSOR_BENCHMARKS_TIMING_HPP_
+#define CPPTENSOR_BENCHMARKS_TIMING_HPP_
+
+// Timing shared by the benchmarks, so that all of them measure the same way
+
+#include <algorithm>
+#include <chrono>
+
+// Runs f repeatedly for at least min_seconds and returns the best time of a single run
+template<typename F>
+double BestTime(F f, double min_seconds = 0.3) {
+  double best = 1e30, total = 0;
+  int runs = 0;
+  while (total < min_seconds || runs < 3) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    best = std::min(best, elapsed);
+    total += elapsed, runs++;
+  }
+  return best;
+}
+
+#endif // CPPTENSOR_BENCHMARKS_TIMING_HPP_
@@ -0,0 +1,82 @@
+// Time of the optimizer part of a training step (ZeroGrad and Step) and of a whole step, with the parameters
+// of the model scattered over their own buffers and moved into a parameter arena
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ParameterArena.hpp"
+#include "Timing.hpp"
+
+using namespace cpp_tensor;
+
+struct Shape {
+  std::string name;
+  size_t layers;
+  size_t width;
+};
+
+void MakeModel(Sequential &model, const Shape &shape) {
+  for (size_t l = 0; l < shape.layers; l++) {
+    model.AddModule<LinearLayer>(shape.width, shape.width);
+    model.AddModule<ReLU>(0.1);
+  }
+}
+
+int main() {
+  const std::vector<Shape> kShapes = {
+      {"64 x 32", 64, 32},
+      {"16 x 128", 16, 128},
+      {"4 x 1024", 4, 1024},
+  };
+  const size_t kBatch = 16;
+
+  std::mt19937 mt(42);
+  std::uniform_real_distribution<Scalar> dist(-1, 1);
+
+  std::cout << std::left << std::setw(12) << "model" << std::right << std::setw(12) << "params"
+            << std::setw(14) << "optim us" << std::setw(14) << "arena us" << std::setw(14) << "step us"
+            << std::setw(14) << "arena us" << '\n';
+
+  for (auto &kShape : kShapes) {
+    Sequential plain, flat;
+    MakeModel(plain, kShape);
+    MakeModel(flat, kShape);
+    SGD plain_optimizer(plain.Parameters(), 1e-3);
+    SGD flat_optimizer(ParameterArena(flat.Parameters()), 1e-3);
+    size_t params = 0;
+    for (auto &p : plain.Parameters())
+      params += p->Size();
+
+    std::vector<Scalar> x_data(kBatch * kShape.width), y_data(kBatch * kShape.width);
+    for (auto &v : x_data) v = dist(mt);
+    for (auto &v : y_data) v = dist(mt);
+    const Tensor kX(x_data, {kBatch, kShape.width}), kY(y_data, {kBatch, kShape.width});
+
+    auto optim = [](SGD &optimizer) {
+      return BestTime([&] {
+        optimizer.ZeroGrad();
+        optimizer.Step();
+      });
+    };
+    auto step = [&](const Sequential &model, SGD &optimizer) {
+      return BestTime([&] {
+        optimizer.ZeroGrad();
+        MSELoss()(model(kX), kY).Backward();
+        optimizer.Step();
+      });
+    };
+
+    std::cout << std::left << std::setw(12) << kShape.name << std::right << std::setw(12) << params
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << optim(plain_optimizer) * 1e6 << std::setw(14) << optim(flat_optimizer) * 1e6
+              << std::setw(14) << step(plain, plain_optimizer) * 1e6 << std::setw(14) << step(flat, flat_optimizer) * 1e6
+              << '\n';
+  }
+  return 0;
+}
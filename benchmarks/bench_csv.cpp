@@ -0,0 +1,67 @@
+// Time to ingest a numeric CSV file: line by line with getline and stod into a std::vector (the usual approach),
+// with ReadCsv (parallel, straight into tensor storage) and with CsvStream (batch by batch)
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CsvReader.hpp"
+#include "Timing.hpp"
+
+using namespace cpp_tensor;
+
+int main() {
+  const size_t kRows = 1 << 19, kCols = 16;
+  const std::string kPath = (std::filesystem::temp_directory_path() / "cpptensor_bench.csv").string();
+  {
+    std::mt19937 mt(42);
+    std::uniform_real_distribution<double> dist(-100, 100);
+    std::ofstream file(kPath);
+    file << std::setprecision(8);
+    for (size_t r = 0; r < kRows; r++)
+      for (size_t c = 0; c < kCols; c++)
+        file << dist(mt) << (c + 1 < kCols ? ',' : '\n');
+  }
+  const double kMegabytes = std::filesystem::file_size(kPath) / 1e6;
+
+  CsvOptions options;
+  options.target_columns = {kCols - 1};
+
+  const double kGetline = BestTime([&] {
+    std::ifstream file(kPath);
+    std::vector<Scalar> x, y;
+    std::string line, field;
+    while (std::getline(file, line)) {
+      std::stringstream fields(line);
+      for (size_t c = 0; std::getline(fields, field, ','); c++)
+        (c + 1 < kCols ? x : y).push_back(std::stod(field));
+    }
+  });
+  const double kReadCsv = BestTime([&] {
+    Tensor x, y;
+    ReadCsv(kPath, options, x, y);
+  });
+  const double kStream = BestTime([&] {
+    CsvStream stream(kPath, options, 4096);
+    Tensor x, y;
+    while (stream.Next(x, y)) {}
+  });
+  std::remove(kPath.c_str());
+
+  std::cout << kRows << " rows x " << kCols << " columns (" << std::fixed << std::setprecision(1) << kMegabytes
+            << " MB)\n";
+  std::cout << std::left << std::setw(20) << "reader" << std::right << std::setw(10) << "ms" << std::setw(10) << "MB/s"
+            << '\n';
+  for (auto [name, seconds] : {std::make_pair("getline + stod", kGetline), std::make_pair("ReadCsv", kReadCsv),
+                               std::make_pair("CsvStream", kStream)})
+    std::cout << std::left << std::setw(20) << name << std::right << std::setw(10) << seconds * 1e3
+              << std::setw(10) << kMegabytes / seconds << '\n';
+  return 0;
+}
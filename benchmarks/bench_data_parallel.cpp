@@ -0,0 +1,72 @@
+// Scaling of data-parallel training: time of a training step with 1 to N replicas (one thread each), on the
+// model of main.cpp and on a wider MLP. A single replica runs the kernels with intra-op parallelism instead.
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DataParallel.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ThreadPool.hpp"
+#include "Timing.hpp"
+
+using namespace cpp_tensor;
+
+struct Config {
+  std::string name;
+  std::vector<size_t> widths;
+  size_t batch;
+};
+
+int main() {
+  const std::vector<Config> kConfigs = {
+      {"main.cpp 2-8-8-3", {2, 8, 8, 3}, 256},
+      {"MLP 256-1024-1024-10", {256, 1024, 1024, 10}, 256},
+  };
+  std::vector<size_t> replica_counts = {1, 2, 4};
+  for (size_t n = 8; n <= std::thread::hardware_concurrency(); n *= 2)
+    replica_counts.push_back(n);
+
+  std::mt19937 mt(42);
+  std::uniform_real_distribution<Scalar> dist(-1, 1);
+  std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n";
+  std::cout << std::left << std::setw(24) << "model" << std::right << std::setw(10) << "replicas"
+            << std::setw(12) << "step ms" << std::setw(14) << "rows/s" << std::setw(10) << "speedup" << '\n';
+
+  const size_t kThreads = GetNumThreads();
+  for (auto &kConfig : kConfigs) {
+    std::vector<Scalar> x_data(kConfig.batch * kConfig.widths.front()), y_data(kConfig.batch * kConfig.widths.back());
+    for (auto &v : x_data) v = dist(mt);
+    for (auto &v : y_data) v = dist(mt);
+    const Tensor kX(x_data, {kConfig.batch, kConfig.widths.front()});
+    const Tensor kY(y_data, {kConfig.batch, kConfig.widths.back()});
+
+    double base = 0;
+    for (auto &kReplicas : replica_counts) {
+      SetNumThreads(kReplicas);
+      Sequential model;
+      for (size_t l = 0; l + 1 < kConfig.widths.size(); l++) {
+        model.AddModule<LinearLayer>(kConfig.widths[l], kConfig.widths[l + 1]);
+        if (l + 2 < kConfig.widths.size())
+          model.AddModule<ReLU>(0.1);
+      }
+      DataParallelTrainer trainer(model, kReplicas, [](ParameterArena arena) {
+        return std::make_unique<SGD>(std::move(arena), 1e-3, 0.9);
+      });
+      const double kTime = BestTime([&] { trainer.Step(kX, kY, MSELoss()); });
+      if (kReplicas == 1)
+        base = kTime;
+      std::cout << std::left << std::setw(24) << kConfig.name << std::right << std::setw(10) << kReplicas
+                << std::fixed << std::setprecision(3) << std::setw(12) << kTime * 1e3
+                << std::setprecision(0) << std::setw(14) << kConfig.batch / kTime
+                << std::setprecision(2) << std::setw(10) << base / kTime << '\n';
+    }
+  }
+  SetNumThreads(kThreads);
+  return 0;
+}
@@ -0,0 +1,63 @@
+// Time of a forward and backward pass through memory-bound chains of elementwise operations,
+// evaluated eagerly (one graph node and one pass over memory per operation) and lazily (fused)
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Tensor.hpp"
+#include "Timing.hpp"
+
+using namespace cpp_tensor;
+
+int main() {
+  struct Chain {
+    const char *name;
+    Tensor (*build)(const Tensor &a, const Tensor &b, const Tensor &bias);
+  };
+
+  const std::vector<Chain> kChains = {
+      {"mse", [](const Tensor &a, const Tensor &b, const Tensor &) { return (a - b).Pow(2).Mean(); }},
+      {"bias-relu-mse", [](const Tensor &a, const Tensor &b, const Tensor &bias) {
+        return ((a + bias).Relu(0.1) - b).Pow(2).Mean();
+      }},
+  };
+  const std::vector<size_t> kRows = {1 << 8, 1 << 12, 1 << 16, 1 << 18};
+  const size_t kCols = 64;
+
+  std::mt19937 mt(42);
+  std::uniform_real_distribution<Scalar> dist(-1, 1);
+
+  std::cout << std::left << std::setw(16) << "chain" << std::setw(12) << "elements"
+            << std::right << std::setw(12) << "eager ms" << std::setw(12) << "fused ms" << std::setw(10) << "speedup"
+            << '\n';
+
+  for (auto &kChain : kChains) {
+    for (auto &kRow : kRows) {
+      std::vector<Scalar> a_data(kRow * kCols), b_data(kRow * kCols), bias_data(kCols);
+      for (auto &v : a_data) v = dist(mt);
+      for (auto &v : b_data) v = dist(mt);
+      for (auto &v : bias_data) v = dist(mt);
+      Tensor a(a_data, {kRow, kCols}, true), b(b_data, {kRow, kCols}), bias(bias_data, {kCols}, true);
+
+      auto step = [&](bool lazy) {
+        return BestTime([&] {
+          Tensor::SetLazy(lazy);
+          auto loss = kChain.build(a, b, bias);
+          loss.Backward();
+          a.GetTensor()->SetGrad(0);
+          bias.GetTensor()->SetGrad(0);
+        });
+      };
+      double eager = step(false), fused = step(true);
+      Tensor::SetLazy(false);
+
+      std::cout << std::left << std::setw(16) << kChain.name << std::setw(12) << kRow * kCols
+                << std::right << std::fixed << std::setprecision(3)
+                << std::setw(12) << eager * 1e3 << std::setw(12) << fused * 1e3
+                << std::setprecision(2) << std::setw(9) << eager / fused << "x\n";
+    }
+  }
+}
@@ -0,0 +1,82 @@
+// Throughput of the blocked GEMM engine compared with the original naive i-j-k MatmulVectors loop
+// (double precision), plus the single precision GEMM for reference
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "Gemm.hpp"
+#include "Timing.hpp"
+
+using namespace cpp_tensor;
+
+// The matmul kernel that shipped before the GEMM engine (kept here as the baseline)
+std::vector<double> NaiveMatmul(const std::vector<double> &a, const std::vector<double> &b,
+                                size_t n, size_t m, size_t p) {
+  std::vector<double> res(n * p);
+  size_t iter_res = 0;
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < p; j++) {
+      size_t iter_a = i * m, iter_b = j;
+      for (size_t k = 0; k < m; k++) {
+        res[iter_res] = res[iter_res] + a[iter_a] * b[iter_b];
+        iter_a++, iter_b += p;
+      }
+      iter_res++;
+    }
+  }
+  return res;
+}
+
+int main() {
+  struct Shape {
+    const char *kind;
+    size_t n, m, p;
+  };
+
+  const std::vector<Shape> kShapes = {
+      {"square", 64, 64, 64},
+      {"square", 128, 128, 128},
+      {"square", 256, 256, 256},
+      {"square", 512, 512, 512},
+      {"square", 1024, 1024, 1024},
+      {"tall-skinny", 32, 8, 8},
+      {"tall-skinny", 4096, 64, 64},
+      {"tall-skinny", 16384, 32, 128},
+      {"tall-skinny", 65536, 16, 16},
+      {"tall-skinny", 256, 4096, 256},
+  };
+
+  std::mt19937 mt(42);
+  std::uniform_real_distribution<double> dist(-1, 1);
+
+  std::cout << "GEMM kernel: " << GemmKernelName() << "\n\n";
+  std::cout << std::left << std::setw(13) << "shape" << std::setw(22) << "n x m x p"
+            << std::right << std::setw(14) << "naive GFLOP/s" << std::setw(14) << "gemm GFLOP/s"
+            << std::setw(10) << "speedup" << std::setw(14) << "f32 GFLOP/s" << '\n';
+
+  for (auto &kShape : kShapes) {
+    std::vector<double> a(kShape.n * kShape.m), b(kShape.m * kShape.p), c(kShape.n * kShape.p);
+    for (auto &v : a) v = dist(mt);
+    for (auto &v : b) v = dist(mt);
+    std::vector<float> a_f(a.begin(), a.end()), b_f(b.begin(), b.end()), c_f(c.size());
+
+    const double kFlops = 2.0 * kShape.n * kShape.m * kShape.p;
+    double naive = BestTime([&] { NaiveMatmul(a, b, kShape.n, kShape.m, kShape.p); });
+    double gemm = BestTime([&] {
+      Gemm(false, false, kShape.n, kShape.p, kShape.m, 1, a.data(), kShape.m, b.data(), kShape.p, 0, c.data(), kShape.p);
+    });
+    double gemm_f32 = BestTime([&] {
+      Gemm(false, false, kShape.n, kShape.p, kShape.m, 1.f, a_f.data(), kShape.m, b_f.data(), kShape.p, 0.f,
+           c_f.data(), kShape.p);
+    });
+
+    std::cout << std::left << std::setw(13) << kShape.kind
+              << std::setw(22) << (std::to_string(kShape.n) + " x " + std::to_string(kShape.m) + " x "
+                  + std::to_string(kShape.p))
+              << std::right << std::fixed << std::setprecision(2)
+              << std::setw(14) << kFlops / naive * 1e-9 << std::setw(14) << kFlops / gemm * 1e-9
+              << std::setw(9) << naive / gemm << "x" << std::setw(14) << kFlops / gemm_f32 * 1e-9 << '\n';
+  }
+}
@@ -0,0 +1,100 @@
+// Asynchronous (Hogwild) SGD against single-threaded SGD on the regression task of main.cpp:
+// training throughput and the loss on the test set after the same number of epochs
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DataLoader.hpp"
+#include "Hogwild.hpp"
+#include "Initializations.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+struct Mode {
+  std::string name;
+  size_t workers;  // 0: the plain training loop of main.cpp
+  size_t staleness;
+};
+
+void MakeModel(Sequential &model) {
+  model.AddModule<LinearLayer>(2, 8, Initialization::Uniform(0, 1));
+  model.AddModule<ReLU>(0.1);
+  model.AddModule<LinearLayer>(8, 8, Initialization::Normal(1, 2));
+  model.AddModule<ReLU>(0.2);
+  model.AddModule<LinearLayer>(8, 3);
+}
+
+int main() {
+  // The data of main.cpp
+  std::mt19937 mt(42);
+  std::uniform_real_distribution<Scalar> uniform_dist(0, 30);
+  std::normal_distribution<Scalar> normal_dist(0, 1);
+  const size_t kDataSize = 2e4;
+  std::vector<Scalar> data_x, data_y;
+  for (size_t i = 0; i < kDataSize; i++) {
+    Scalar x1 = uniform_dist(mt), x2 = uniform_dist(mt);
+    data_x.insert(data_x.end(), {(x1 - 15) / 8.66f, (x2 - 15) / 8.66f});
+    data_y.insert(data_y.end(), {-7 * x1 + 3 * x2, 0.2f * x1 * x2, 0.4f * x1 * x1 - 0.5f * x2 * x2});
+  }
+  for (auto &x : data_x)
+    x += 0.05 * normal_dist(mt);
+  auto [x_train, x_test, y_train, y_test] = Tensor::TrainTestSplit(Tensor(data_x, {kDataSize, 2}),
+                                                                   Tensor(data_y, {kDataSize, 3}), 0.8);
+
+  const size_t kEpochs = 10;
+  const double kLr = 5e-4;
+  const std::vector<Mode> kModes = {
+      {"SGD, 1 thread", 0, 0},
+      {"Hogwild 1 worker", 1, 0},
+      {"Hogwild 2 workers", 2, 0},
+      {"Hogwild 4 workers", 4, 0},
+      {"Hogwild 4, stale 8", 4, 8},
+  };
+
+  std::cout << "hardware threads: " << std::thread::hardware_concurrency() << ", " << kEpochs << " epochs of "
+            << x_train.Shape(0) << " rows, batch 32\n";
+  std::cout << std::left << std::setw(22) << "mode" << std::right << std::setw(14) << "samples/s"
+            << std::setw(14) << "test loss" << '\n';
+  const size_t kThreads = GetNumThreads();
+  for (auto &kMode : kModes) {
+    Sequential model;
+    MakeModel(model);
+    MSELoss criterion;
+    auto start = std::chrono::steady_clock::now();
+    if (kMode.workers == 0) {
+      SGD optimizer(model.Parameters(), kLr);
+      DataLoader loader(x_train, y_train, 32, true);
+      loader.SetSeed(0);
+      for (size_t epoch = 0; epoch < kEpochs; epoch++) {
+        for (auto &[x_batch, y_batch] : loader) {
+          optimizer.ZeroGrad();
+          criterion(model(x_batch), y_batch).Backward();
+          optimizer.Step();
+        }
+      }
+    } else {
+      SetNumThreads(kMode.workers);
+      HogwildTrainer trainer(model, kMode.workers, [&](ParameterArena arena) {
+        return std::make_unique<SGD>(std::move(arena), kLr);
+      }, kMode.staleness);
+      trainer.Train(x_train, y_train, criterion, kEpochs);
+      SetNumThreads(kThreads);
+    }
+    const double kSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    InferenceModeGuard inference_mode;
+    std::cout << std::left << std::setw(22) << kMode.name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(14) << kEpochs * x_train.Shape(0) / kSeconds << std::setprecision(1) << std::setw(14)
+              << criterion(model(x_test), y_test).Value() << '\n';
+  }
+  return 0;
+}
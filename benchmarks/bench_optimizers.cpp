@@ -0,0 +1,163 @@
+// Optimizers - time of a step per million parameters (fused kernels against one pass per operation of the
+// update rule), and the epochs until the model of main.cpp reaches a target loss on its test set
+
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DataLoader.hpp"
+#include "Initializations.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ParameterArena.hpp"
+#include "Timing.hpp"
+
+using namespace cpp_tensor;
+
+// Adam with one pass over memory per operation, as composed from elementwise tensor operations
+void UnfusedAdam(std::vector<Scalar> &p, const std::vector<Scalar> &g, std::vector<Scalar> &m,
+                 std::vector<Scalar> &v, std::vector<Scalar> &tmp, int step) {
+  const Scalar kLr = 1e-3, kBeta1 = 0.9, kBeta2 = 0.999, kEps = 1e-8;
+  const size_t kN = p.size();
+  const Scalar kBias1 = 1 - std::pow(kBeta1, step), kBias2 = 1 - std::pow(kBeta2, step);
+  for (size_t i = 0; i < kN; i++) m[i] *= kBeta1;
+  for (size_t i = 0; i < kN; i++) m[i] += (1 - kBeta1) * g[i];
+  for (size_t i = 0; i < kN; i++) v[i] *= kBeta2;
+  for (size_t i = 0; i < kN; i++) tmp[i] = g[i] * g[i];
+  for (size_t i = 0; i < kN; i++) v[i] += (1 - kBeta2) * tmp[i];
+  for (size_t i = 0; i < kN; i++) tmp[i] = std::sqrt(v[i] / kBias2);
+  for (size_t i = 0; i < kN; i++) tmp[i] += kEps;
+  for (size_t i = 0; i < kN; i++) tmp[i] = m[i] / kBias1 / tmp[i];
+  for (size_t i = 0; i < kN; i++) p[i] -= kLr * tmp[i];
+}
+
+using MakeOptimizer = std::function<std::unique_ptr<Optimizer>(std::vector<SharedTensor>)>;
+
+struct Variant {
+  std::string name;
+  MakeOptimizer make;
+};
+
+// The data and model of main.cpp
+struct Task {
+  Tensor x_train, x_test, y_train, y_test;
+
+  Task() {
+    std::mt19937 mt(42);
+    std::uniform_real_distribution<Scalar> uniform_dist(0, 30);
+    std::normal_distribution<Scalar> normal_dist(0, 1);
+    const size_t kDataSize = 2e4;
+    std::vector<Scalar> data_x, data_y;
+    for (size_t i = 0; i < kDataSize; i++) {
+      Scalar x1 = uniform_dist(mt), x2 = uniform_dist(mt);
+      data_x.insert(data_x.end(), {(x1 - 15) / 8.66f, (x2 - 15) / 8.66f});
+      data_y.insert(data_y.end(), {-7 * x1 + 3 * x2, 0.2f * x1 * x2, 0.4f * x1 * x1 - 0.5f * x2 * x2});
+    }
+    for (auto &x : data_x)
+      x += 0.05 * normal_dist(mt);
+    Tensor x(data_x, {kDataSize, 2}), y(data_y, {kDataSize, 3});
+    auto [x_tr, x_te, y_tr, y_te] = Tensor::TrainTestSplit(x, y, 0.8);
+    x_train = x_tr, x_test = x_te, y_train = y_tr, y_test = y_te;
+  }
+
+  // Trains for epochs and returns the first epoch after which the loss on the test set is below target
+  // (0 if none) and the final loss on the test set
+  std::pair<int, double> Train(const MakeOptimizer &make, double target, int epochs) const {
+    Sequential model;
+    model.AddModule<LinearLayer>(2, 8, Initialization::Uniform(0, 1));
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(8, 8, Initialization::Normal(1, 2));
+    model.AddModule<ReLU>(0.2);
+    model.AddModule<LinearLayer>(8, 3);
+    auto optimizer = make(model.Parameters());
+    DataLoader train_loader(x_train, y_train, 32, true);
+    train_loader.SetSeed(1);
+    MSELoss criterion;
+    int first = 0;
+    double loss = 0;
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+      for (auto &[x_batch, y_batch] : train_loader) {
+        optimizer->ZeroGrad();
+        criterion(model(x_batch), y_batch).Backward();
+        optimizer->Step();
+      }
+      InferenceModeGuard inference_mode;
+      loss = criterion(model(x_test), y_test).Value();
+      if (first == 0 && loss < target)
+        first = epoch;
+    }
+    return {first, loss};
+  }
+};
+
+int main() {
+  std::mt19937 mt(42);
+  std::uniform_real_distribution<Scalar> dist(-1, 1);
+
+  // Step time - one parameter of n elements with a gradient, in ms per million parameters
+  {
+    const std::vector<Variant> kVariants = {
+        {"SGD", [](auto p) { return std::make_unique<SGD>(p, 1e-3); }},
+        {"SGD momentum", [](auto p) { return std::make_unique<SGD>(p, 1e-3, 0.9); }},
+        {"SGD nesterov", [](auto p) { return std::make_unique<SGD>(p, 1e-3, 0.9, true); }},
+        {"Adam", [](auto p) { return std::make_unique<Adam>(p); }},
+        {"AdamW", [](auto p) { return std::make_unique<AdamW>(p); }},
+    };
+    const std::vector<size_t> kSizes = {1 << 16, 1 << 20, 1 << 24};
+
+    std::cout << std::left << std::setw(16) << "optimizer" << std::right;
+    for (auto &kSize : kSizes)
+      std::cout << std::setw(14) << (std::to_string(kSize >> 10) + "K ms/M");
+    std::cout << '\n';
+
+    for (auto &kVariant : kVariants) {
+      std::cout << std::left << std::setw(16) << kVariant.name << std::right;
+      for (auto &kSize : kSizes) {
+        Tensor p(0., {kSize}, true);
+        p.GetTensor()->SetGrad(Buffer(kSize, 1e-3));
+        auto optimizer = kVariant.make({p.GetTensor()});
+        const double kTime = BestTime([&] { optimizer->Step(); });
+        std::cout << std::setw(14) << std::fixed << std::setprecision(3) << kTime * 1e3 / (kSize / 1e6);
+      }
+      std::cout << '\n';
+    }
+
+    std::cout << std::left << std::setw(16) << "Adam (unfused)" << std::right;
+    for (auto &kSize : kSizes) {
+      std::vector<Scalar> p(kSize), g(kSize, 1e-3), m(kSize), v(kSize), tmp(kSize);
+      int step = 0;
+      const double kTime = BestTime([&] { UnfusedAdam(p, g, m, v, tmp, ++step); });
+      std::cout << std::setw(14) << std::fixed << std::setprecision(3) << kTime * 1e3 / (kSize / 1e6);
+    }
+    std::cout << "\n\n";
+  }
+
+  // Time to accuracy on the task of main.cpp
+  {
+    const double kTarget = 60;
+    const int kEpochs = 30;
+    const std::vector<Variant> kVariants = {
+        {"SGD 5e-4", [](auto p) { return std::make_unique<SGD>(p, 5e-4); }},
+        {"SGD 5e-4 m=0.9", [](auto p) { return std::make_unique<SGD>(p, 5e-4, 0.9); }},
+        {"SGD 5e-4 nesterov", [](auto p) { return std::make_unique<SGD>(p, 5e-4, 0.9, true); }},
+        {"Adam 1e-2", [](auto p) { return std::make_unique<Adam>(p, 1e-2); }},
+        {"AdamW 1e-2", [](auto p) { return std::make_unique<AdamW>(p, 1e-2); }},
+    };
+    Task task;
+    std::cout << "main.cpp task, " << kEpochs << " epochs\n";
+    std::cout << std::left << std::setw(20) << "optimizer" << std::right << std::setw(18)
+              << "epochs to < " + std::to_string(static_cast<int>(kTarget)) << std::setw(14) << "final loss" << '\n';
+    for (auto &kVariant : kVariants) {
+      const auto [kFirst, kLoss] = task.Train(kVariant.make, kTarget, kEpochs);
+      std::cout << std::left << std::setw(20) << kVariant.name << std::right << std::setw(18) << kFirst
+                << std::setw(14) << std::fixed << std::setprecision(1) << kLoss << '\n';
+    }
+  }
+  return 0;
+}
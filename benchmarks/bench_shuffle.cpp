@@ -0,0 +1,119 @@
+// Full shuffle against block shuffle: time of an epoch of batches gathered from a large dataset,
+// and convergence of a linear regression trained on data stored in sorted order (the worst case for block shuffles)
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DataLoader.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+
+using namespace cpp_tensor;
+
+struct Mode {
+  std::string name;
+  bool shuffle;
+  size_t block_size;
+  size_t window_size;
+};
+
+const std::vector<Mode> kModes = {
+    {"no shuffle", false, 0, 0},
+    {"full shuffle", true, 0, 0},
+    {"block 64/1024", true, 64, 1024},
+    {"block 256/4096", true, 256, 4096},
+};
+
+void Configure(DataLoader &loader, const Mode &mode) {
+  loader.SetSeed(42);
+  loader.SetBlockShuffle(mode.block_size, mode.window_size);
+}
+
+// Best time of an epoch that only touches every batch
+double EpochTime(const Tensor &x, const Tensor &y, const Mode &mode) {
+  DataLoader loader(x, y, 32, mode.shuffle);
+  Configure(loader, mode);
+  double best = 1e30, sink = 0;
+  for (int epoch = 0; epoch < 3; epoch++) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto &[x_batch, y_batch] : loader)
+      sink += x_batch[0] + y_batch[0];
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return sink == 0.5 ? 0 : best;
+}
+
+int main() {
+  std::mt19937 mt(42);
+  std::normal_distribution<Scalar> normal(0, 1);
+
+  // Epoch time - 2M rows of 32 features (512 MB in double precision)
+  {
+    const size_t kRows = 1 << 21, kCols = 32;
+    std::vector<Scalar> x_data(kRows * kCols), y_data(kRows);
+    for (auto &v : x_data) v = normal(mt);
+    Tensor x(x_data, {kRows, kCols}), y(y_data, {kRows, 1});
+    x_data = {};
+
+    std::cout << "epoch over " << kRows << " x " << kCols << " rows, batch 32\n";
+    std::cout << std::left << std::setw(18) << "mode" << std::right << std::setw(12) << "epoch ms" << '\n';
+    for (auto &mode : kModes)
+      std::cout << std::left << std::setw(18) << mode.name << std::right << std::setw(12) << std::fixed
+                << std::setprecision(1) << EpochTime(x, y, mode) * 1e3 << '\n';
+  }
+
+  // Convergence - y = x . w + noise, with the training rows sorted by y
+  {
+    const size_t kRows = 1 << 16, kCols = 8, kEpochs = 4;
+    std::vector<std::pair<Scalar, std::vector<Scalar>>> rows(kRows);
+    std::vector<Scalar> w(kCols);
+    for (auto &v : w) v = normal(mt);
+    for (auto &[target, features] : rows) {
+      features.resize(kCols);
+      target = 0.1 * normal(mt);
+      for (size_t c = 0; c < kCols; c++) {
+        features[c] = normal(mt);
+        target += w[c] * features[c];
+      }
+    }
+    std::sort(rows.begin(), rows.end());
+    std::vector<Scalar> x_data, y_data;
+    for (auto &[target, features] : rows) {
+      x_data.insert(x_data.end(), features.begin(), features.end());
+      y_data.push_back(target);
+    }
+    Tensor x(x_data, {kRows, kCols}), y(y_data, {kRows, 1});
+
+    std::cout << "\ntraining loss (full data) after each epoch, rows sorted by target\n";
+    std::cout << std::left << std::setw(18) << "mode";
+    for (size_t epoch = 1; epoch <= kEpochs; epoch++)
+      std::cout << std::right << std::setw(12) << ("epoch " + std::to_string(epoch));
+    std::cout << '\n';
+    for (auto &mode : kModes) {
+      DataLoader loader(x, y, 32, mode.shuffle);
+      Configure(loader, mode);
+      LinearLayer model(kCols, 1, Initialization::Normal(0, 0.1));
+      SGD optimizer(model.Parameters(), 1e-2);
+      MSELoss criterion;
+      std::cout << std::left << std::setw(18) << mode.name << std::right << std::scientific << std::setprecision(2);
+      for (size_t epoch = 0; epoch < kEpochs; epoch++) {
+        for (auto &[x_batch, y_batch] : loader) {
+          auto loss = criterion(model(x_batch), y_batch);
+          loss.Backward();
+          optimizer.Step();
+          optimizer.ZeroGrad();
+        }
+        InferenceModeGuard inference_mode;
+        std::cout << std::setw(12) << criterion(model(x), y).Value();
+      }
+      std::cout << '\n';
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,280 @@
+// Benchmark suite run by `make bench` - times the kernels (Matmul and the elementwise operations across sizes),
+// a forward and backward pass of the model of main.cpp, a DataLoader epoch and an SGD step, counts the
+// allocations per iteration, and compares everything with a baseline.
+//
+// Usage: bench_suite.exe [--csv path] [--baseline path] [--tolerance fraction] [--quick]
+//   --csv        writes the results as CSV (the format of the baseline)
+//   --baseline   flags benchmarks slower than the baseline by more than the tolerance (default 0.3) in repeated
+//                runs, or with more allocations per iteration, and then exits with 1
+//   --quick      shorter measurements, for a smoke run
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Buffer.hpp"
+#include "DataLoader.hpp"
+#include "GraphPool.hpp"
+#include "Initializations.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+struct Result {
+  std::string name;
+  size_t size = 0;            // items per iteration - elements, multiply-adds, rows or parameters
+  double ns = 0;              // best time of one iteration
+  double buffer_allocs = 0;   // per iteration, from the buffer cache
+  double pool_allocs = 0;     // per iteration, graph nodes from the graph pool
+  double heap_allocs = 0;     // per iteration, the ones of both that went to the system allocator
+
+  double ItemsPerSecond() const { return size / (ns * 1e-9); }
+};
+
+const char kCsvHeader[] = "benchmark,size,ns_per_iter,items_per_sec,buffer_allocs,pool_allocs,heap_allocs";
+
+double min_seconds = 0.2;
+
+// Runs f in batches of iterations that take at least 100 us, for at least min_seconds, and returns the best time
+// of one iteration, with the allocations of one more batch
+Result Measure(const std::string &name, size_t size, const std::function<void()> &f) {
+  using Clock = std::chrono::steady_clock;
+  auto run = [&](size_t iterations) {
+    const auto kStart = Clock::now();
+    for (size_t i = 0; i < iterations; i++)
+      f();
+    return std::chrono::duration<double>(Clock::now() - kStart).count();
+  };
+  run(1);  // warm up the caches
+  size_t iterations = 1;
+  while (run(iterations) < 1e-4)
+    iterations *= 2;
+
+  double best = 1e30, total = 0;
+  for (int runs = 0; total < min_seconds || runs < 3; runs++) {
+    const double kElapsed = run(iterations);
+    best = std::min(best, kElapsed);
+    total += kElapsed;
+  }
+
+  const BufferCacheStats kBuffers = GetBufferCacheStats();
+  const GraphPoolStats kPool = GetGraphPoolStats();
+  run(iterations);
+  const BufferCacheStats kBuffersAfter = GetBufferCacheStats();
+  const GraphPoolStats kPoolAfter = GetGraphPoolStats();
+
+  Result result;
+  result.name = name;
+  result.size = size;
+  result.ns = best / iterations * 1e9;
+  result.buffer_allocs = double(kBuffersAfter.hits + kBuffersAfter.misses - kBuffers.hits - kBuffers.misses)
+      / iterations;
+  result.pool_allocs = double(kPoolAfter.allocations - kPool.allocations) / iterations;
+  result.heap_allocs = double(kBuffersAfter.misses - kBuffers.misses + kPoolAfter.heap_allocations
+                              - kPool.heap_allocations) / iterations;
+  return result;
+}
+
+Tensor RandomTensor(const std::vector<size_t> &shape, std::mt19937 &mt, bool requires_grad = false) {
+  std::uniform_real_distribution<Scalar> dist(0.5, 1.5);  // away from 0 for the division
+  size_t size = 1;
+  for (auto s : shape)
+    size *= s;
+  std::vector<Scalar> data(size);
+  for (auto &v : data)
+    v = dist(mt);
+  return Tensor(data, shape, requires_grad);
+}
+
+std::vector<Result> RunBenchmarks() {
+  std::mt19937 mt(42);
+  std::vector<Result> results;
+
+  // Kernels - forward only
+  {
+    NoGradGuard no_grad;
+    for (size_t n : {64, 256, 512}) {
+      const Tensor kA = RandomTensor({n, n}, mt), kB = RandomTensor({n, n}, mt);
+      results.push_back(Measure("matmul", n * n * n, [&] { kA.Matmul(kB); }));
+    }
+    for (size_t n : {256, 1024}) {
+      const Tensor kA = RandomTensor({n, n}, mt), kV = RandomTensor({n, 1}, mt);
+      results.push_back(Measure("matvec", n * n, [&] { kA.Matmul(kV); }));
+    }
+
+    const std::vector<std::pair<std::string, std::function<void(const Tensor &, const Tensor &)>>> kElementwise = {
+        {"add", [](const Tensor &a, const Tensor &b) { a + b; }},
+        {"sub", [](const Tensor &a, const Tensor &b) { a - b; }},
+        {"mul", [](const Tensor &a, const Tensor &b) { a * b; }},
+        {"div", [](const Tensor &a, const Tensor &b) { a / b; }},
+        {"pow", [](const Tensor &a, const Tensor &) { a.Pow(2); }},
+        {"relu", [](const Tensor &a, const Tensor &) { a.Relu(0.1); }},
+        {"sum", [](const Tensor &a, const Tensor &) { a.Sum(); }},
+        {"mean", [](const Tensor &a, const Tensor &) { a.Mean(); }},
+    };
+    for (size_t n : {size_t(1) << 10, size_t(1) << 16, size_t(1) << 20}) {
+      const Tensor kA = RandomTensor({n}, mt), kB = RandomTensor({n}, mt);
+      for (auto &[name, op] : kElementwise)
+        results.push_back(Measure(name, n, [&, &op = op] { op(kA, kB); }));
+    }
+  }
+
+  // Forward and backward pass of the model of main.cpp (without fusion), per batch of 32 rows
+  {
+    Sequential model;
+    model.AddModule<LinearLayer>(2, 8, Initialization::Uniform(0, 1));
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(8, 8, Initialization::Normal(1, 2));
+    model.AddModule<ReLU>(0.2);
+    model.AddModule<LinearLayer>(8, 3);
+    const Tensor kX = RandomTensor({32, 2}, mt), kY = RandomTensor({32, 3}, mt);
+    results.push_back(Measure("train_step", 32, [&] { MSELoss()(model(kX), kY).Backward(); }));
+  }
+
+  // One shuffled epoch over the training set of main.cpp
+  {
+    const Tensor kX = RandomTensor({16000, 2}, mt), kY = RandomTensor({16000, 3}, mt);
+    DataLoader loader(kX, kY, 32, true);
+    results.push_back(Measure("dataloader_epoch", 16000, [&] {
+      for (auto &batch : loader)
+        (void)batch;
+    }));
+  }
+
+  // SGD steps over a million parameters
+  {
+    Sequential model;
+    model.AddModule<LinearLayer>(1000, 1000);
+    SGD optimizer(model.Parameters(), 1e-3);
+    const Tensor kX = RandomTensor({1, 1000}, mt), kY = RandomTensor({1, 1000}, mt);
+    MSELoss()(model(kX), kY).Backward();
+    results.push_back(Measure("sgd_step", 1000 * 1000 + 1000, [&] { optimizer.Step(); }));
+  }
+  return results;
+}
+
+// CSV
+
+std::string Key(const std::string &name, size_t size) {
+  return name + "/" + std::to_string(size);
+}
+
+bool WriteCsv(const std::string &path, const std::vector<Result> &results) {
+  std::ofstream file(path);
+  file << kCsvHeader << '\n' << std::setprecision(6);
+  for (auto &r : results)
+    file << r.name << ',' << r.size << ',' << r.ns << ',' << r.ItemsPerSecond() << ',' << r.buffer_allocs << ','
+         << r.pool_allocs << ',' << r.heap_allocs << '\n';
+  return file.good();
+}
+
+// The results of a CSV file by Key - empty if the file could not be read
+std::map<std::string, Result> ReadCsv(const std::string &path) {
+  std::map<std::string, Result> results;
+  std::ifstream file(path);
+  std::string line;
+  if (!std::getline(file, line) || line != kCsvHeader)
+    return results;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    Result r;
+    double items_per_second = 0;
+    char comma = 0;
+    if (std::getline(fields, r.name, ',') && fields >> r.size >> comma >> r.ns >> comma >> items_per_second >> comma
+        >> r.buffer_allocs >> comma >> r.pool_allocs >> comma >> r.heap_allocs)
+      results[Key(r.name, r.size)] = r;
+  }
+  return results;
+}
+
+int main(int argc, char **argv) {
+  std::string csv_path, baseline_path;
+  double tolerance = 0.3;
+  for (int i = 1; i < argc; i++) {
+    const std::string kArg = argv[i];
+    if (kArg == "--csv" && i + 1 < argc) {
+      csv_path = argv[++i];
+    } else if (kArg == "--baseline" && i + 1 < argc) {
+      baseline_path = argv[++i];
+    } else if (kArg == "--tolerance" && i + 1 < argc) {
+      tolerance = std::stod(argv[++i]);
+    } else if (kArg == "--quick") {
+      min_seconds = 0.01;
+    } else {
+      std::cerr << "usage: " << argv[0] << " [--csv path] [--baseline path] [--tolerance fraction] [--quick]\n";
+      return 2;
+    }
+  }
+
+  std::map<std::string, Result> baseline;
+  if (!baseline_path.empty()) {
+    baseline = ReadCsv(baseline_path);
+    if (baseline.empty()) {
+      std::cerr << "cannot read the baseline " << baseline_path << '\n';
+      return 2;
+    }
+  }
+
+  // A slowdown must persist: while benchmarks look slower than the baseline, the suite runs again (up to
+  // kMaxRuns times) and every benchmark keeps its best time, so that a noisy run does not fail the check
+  const int kMaxRuns = 3;
+  auto slower = [&](const Result &r) {
+    const auto kBase = baseline.find(Key(r.name, r.size));
+    return kBase != baseline.end() && r.ns > kBase->second.ns * (1 + tolerance);
+  };
+  std::vector<Result> results = RunBenchmarks();
+  for (int run = 1; run < kMaxRuns && std::any_of(results.begin(), results.end(), slower); run++) {
+    std::cerr << "slower than the baseline, measuring again (run " << run + 1 << " of " << kMaxRuns << ")\n";
+    const std::vector<Result> kRerun = RunBenchmarks();
+    for (size_t i = 0; i < results.size(); i++)
+      results[i].ns = std::min(results[i].ns, kRerun[i].ns);
+  }
+  const std::vector<Result> &kResults = results;
+  std::cout << std::left << std::setw(18) << "benchmark" << std::right << std::setw(10) << "size"
+            << std::setw(14) << "ns/iter" << std::setw(14) << "items/s" << std::setw(10) << "buffers"
+            << std::setw(10) << "nodes" << std::setw(8) << "heap" << std::setw(12) << "baseline" << '\n';
+  size_t regressions = 0;
+  for (auto &r : kResults) {
+    std::cout << std::left << std::setw(18) << r.name << std::right << std::setw(10) << r.size << std::fixed
+              << std::setprecision(1) << std::setw(14) << r.ns << std::scientific << std::setprecision(2)
+              << std::setw(14) << r.ItemsPerSecond() << std::fixed << std::setprecision(1)
+              << std::setw(10) << r.buffer_allocs << std::setw(10) << r.pool_allocs << std::setw(8) << r.heap_allocs;
+    const auto kBase = baseline.find(Key(r.name, r.size));
+    if (kBase != baseline.end()) {
+      // Times are noisy, allocation counts are not: any additional allocation is a regression
+      const Result &kB = kBase->second;
+      const bool kSlower = slower(r);
+      const bool kMoreAllocs = r.buffer_allocs > kB.buffer_allocs + 0.5 || r.pool_allocs > kB.pool_allocs + 0.5
+          || r.heap_allocs > kB.heap_allocs + 0.5;
+      std::cout << std::setw(11) << std::setprecision(2) << r.ns / kB.ns << 'x';
+      if (kSlower)
+        std::cout << "  SLOWER";
+      if (kMoreAllocs)
+        std::cout << "  MORE ALLOCATIONS";
+      regressions += kSlower || kMoreAllocs;
+    }
+    std::cout << '\n';
+  }
+
+  if (!csv_path.empty() && !WriteCsv(csv_path, kResults)) {
+    std::cerr << "cannot write " << csv_path << '\n';
+    return 2;
+  }
+  if (!baseline.empty()) {
+    std::cout << '\n' << regressions << " regression(s) against " << baseline_path << " (tolerance "
+              << std::setprecision(0) << tolerance * 100 << "%)\n";
+    return regressions == 0 ? 0 : 1;
+  }
+  return 0;
+}
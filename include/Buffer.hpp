@@ -0,0 +1,74 @@
+#ifndef CPPTENSOR_INCLUDE_BUFFER_HPP_
+#define CPPTENSOR_INCLUDE_BUFFER_HPP_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "Scalar.hpp"
+
+namespace cpp_tensor {
+
+// Caching allocator for the elements of tensors - data, gradients and the temporary buffers of the kernels.
+// Sizes are rounded up to a power of two (the size class), and freed buffers are kept in a cache per size class
+// instead of being returned to the system. Since a training step allocates the same sizes in every iteration,
+// after the first one all of its buffers are served from the cache.
+// Every buffer is aligned to kBufferAlignment bytes (a cache line, enough for any SIMD load).
+
+const size_t kBufferAlignment = 64;
+
+struct BufferCacheStats {
+  size_t bytes_in_use = 0;       // held by live buffers (rounded up to their size class)
+  size_t bytes_cached = 0;       // held by freed buffers waiting to be reused
+  size_t peak_bytes_in_use = 0;
+  size_t hits = 0;               // allocations served from the cache
+  size_t misses = 0;             // allocations that went to the system allocator
+
+  double HitRate() const { return hits + misses == 0 ? 0 : double(hits) / double(hits + misses); }
+};
+
+BufferCacheStats GetBufferCacheStats();
+void ResetPeakBufferMemory();  // sets the peak to the current usage
+void EmptyBufferCache();       // returns all cached buffers to the system
+// Bytes allocated by the calling thread so far (rounded up to their size class), including those allocated by the
+// pool threads running the tasks of its parallel regions. ChargeThreadAllocatedBytes adds bytes allocated on behalf
+// of the calling thread (used by ThreadPool).
+size_t ThreadAllocatedBytes();
+void ChargeThreadAllocatedBytes(size_t bytes);
+
+void *AllocateBuffer(size_t bytes);
+void FreeBuffer(void *buffer, size_t bytes);
+
+// Standard allocator backed by the buffer cache
+template<typename T>
+class BufferAllocator {
+ public:
+  using value_type = T;
+
+  BufferAllocator() = default;
+  template<typename U>
+  BufferAllocator(const BufferAllocator<U> &) {}
+
+  T *allocate(size_t n) { return static_cast<T *>(AllocateBuffer(n * sizeof(T))); }
+  void deallocate(T *buffer, size_t n) { FreeBuffer(buffer, n * sizeof(T)); }
+
+  // Elements constructed without a value are left uninitialized (default-initialized) rather than zeroed,
+  // since the kernels write every element of their outputs anyway - Buffer(n, 0) gives zeros
+  template<typename U>
+  void construct(U *p) { ::new(static_cast<void *>(p)) U; }
+  template<typename U, typename... Args>
+  void construct(U *p, Args &&... args) { ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+
+  template<typename U>
+  bool operator==(const BufferAllocator<U> &) const { return true; }
+  template<typename U>
+  bool operator!=(const BufferAllocator<U> &) const { return false; }
+};
+
+// The elements of a tensor
+using Buffer = std::vector<Scalar, BufferAllocator<Scalar>>;
+
+}
+
+#endif // CPPTENSOR_INCLUDE_BUFFER_HPP_
@@ -0,0 +1,92 @@
+#ifndef CPPTENSOR_INCLUDE_CHECKPOINT_HPP_
+#define CPPTENSOR_INCLUDE_CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TensorFile.hpp"
+
+namespace cpp_tensor {
+
+class Optimizer;
+class Sequential;
+
+// Checkpoints - a model (its topology and parameters) and optionally the state of its optimizer in one file.
+// The layout follows tensor files (see TensorFile.hpp): a header, the module and tensor tables and the
+// hyperparameters of the optimizer, then the elements of every tensor, starting at a page-aligned data_offset,
+// each tensor aligned to kBufferAlignment. The modules are stored in pre-order: a Sequential record is followed
+// by the records of its num_children modules. The tensors are the parameters of the model in the order of
+// Parameters(), followed by the buffers of the optimizer.
+
+const char kCheckpointMagic[8] = {'C', 'P', 'P', 'T', 'C', 'K', 'P', 'T'};
+const uint32_t kCheckpointVersion = 1;
+
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint8_t dtype;  // DType of the elements
+  uint8_t reserved[3];
+  uint64_t num_modules;
+  uint64_t num_model_tensors;
+  uint64_t num_optimizer_tensors;
+  uint64_t num_hyperparameters;
+  uint64_t data_offset;  // in bytes, from the beginning of the file
+};
+
+struct CheckpointModule {
+  enum Kind : uint32_t { kSequential = 1, kLinear = 2, kRelu = 3 };
+
+  uint32_t kind;
+  uint32_t has_bias;  // LinearLayer
+  uint64_t in_features;  // LinearLayer
+  uint64_t out_features;  // LinearLayer
+  double leaky;  // ReLU
+  uint64_t num_children;  // Sequential
+};
+
+struct CheckpointTensor {
+  uint64_t num_dims;
+  uint64_t shape[kMaxTensorFileDims];
+  uint64_t offset;  // in bytes, from data_offset
+};
+
+// Writes the model and, if given, the state of the optimizer to path - returns false if the file
+// could not be written or the model contains modules that cannot be stored
+bool SaveCheckpoint(const std::string &path, const Sequential &model, const Optimizer *optimizer = nullptr);
+
+// A checkpoint file mapped into memory, from which models and optimizer states are loaded
+class Checkpoint {
+ public:
+  explicit Checkpoint(const std::string &path);
+
+  // False if the file could not be mapped, is not a checkpoint, or stores another element type than Scalar
+  bool IsOpen() const { return header_ != nullptr; }
+  bool HasOptimizerState() const { return IsOpen() && header_->num_hyperparameters > 0; }
+
+  // Appends the stored modules to model (normally empty). With zero_copy, the parameters are the mapped file itself
+  // (nothing is read until they are used, and updates stay in memory); otherwise they are copied into new buffers.
+  bool LoadModel(Sequential &model, bool zero_copy = true) const;
+  // Restores the state of an optimizer of the loaded model - false if it does not match the stored state
+  bool LoadOptimizer(Optimizer &optimizer) const;
+
+ private:
+  // Helper functions - LoadTensor creates a tensor from its record, LoadModules appends the next count modules
+  // (from record on, taking their parameters from tensor on) to model
+  Tensor LoadTensor(size_t index, bool zero_copy, bool requires_grad) const;
+  bool LoadModules(const CheckpointModule *&record, size_t count, size_t &tensor, bool zero_copy,
+                   Sequential &model) const;
+
+  // Member variables
+  std::shared_ptr<void> mapping_;
+  size_t length_ = 0;
+  const CheckpointHeader *header_ = nullptr;
+  const CheckpointModule *modules_ = nullptr;
+  const CheckpointTensor *tensors_ = nullptr;
+  const double *hyperparameters_ = nullptr;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_CHECKPOINT_HPP_
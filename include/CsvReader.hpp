@@ -0,0 +1,68 @@
+#ifndef CPPTENSOR_INCLUDE_CSVREADER_HPP_
+#define CPPTENSOR_INCLUDE_CSVREADER_HPP_
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Tensor.hpp"
+
+namespace cpp_tensor {
+
+// Delimited numeric text files (CSV, TSV, ...) read straight into tensor storage.
+// Every non-empty line is a row and every field a number; spaces around the fields and "\r\n" line ends are allowed.
+// The selected feature columns of the rows form x (rows x features) and the target columns y (rows x targets),
+// i.e. the pair DataLoader takes.
+
+struct CsvOptions {
+  char delimiter = ',';
+  bool header = false;                   // the first line holds column names and is skipped
+  std::vector<size_t> feature_columns;   // empty: every column that is not a target column
+  std::vector<size_t> target_columns;
+};
+
+// Reads the whole file. It is split into chunks at line boundaries, which are parsed in parallel
+// into the final tensors (no intermediate copies). y is only assigned if there are target columns.
+// Returns false if the file cannot be read, a selected column is missing or a field is not a number.
+bool ReadCsv(const std::string &path, const CsvOptions &options, Tensor &x, Tensor &y);
+
+// Reads a file batch by batch, for files that should not be loaded at once: only one chunk of text
+// (chunk_bytes, or the size of a batch if larger) is held in memory at a time.
+class CsvStream {
+ public:
+  CsvStream(const std::string &path, CsvOptions options, size_t batch_rows, size_t chunk_bytes = 1 << 22);
+
+  // False if the file could not be opened or a selected column does not exist in its first line
+  bool IsOpen() const { return is_open_; }
+  // True once a malformed line has been found
+  bool Failed() const { return failed_; }
+
+  // Reads the next batch_rows rows (fewer at the end of the file) into x and y. The buffers of the previous
+  // batch are reused unless they are still referenced elsewhere. Returns false at the end of the file or on an error.
+  bool Next(Tensor &x, Tensor &y);
+
+ private:
+  // Helper function to read more text - returns false at the end of the file
+  bool Refill();
+
+  // Member variables
+  std::ifstream file_;
+  CsvOptions options_;
+  size_t batch_rows_;
+  size_t chunk_bytes_;
+  std::vector<int> x_slot_;  // position of each column in a row of x (-1 if not a feature)
+  std::vector<int> y_slot_;  // position of each column in a row of y (-1 if not a target)
+  size_t num_features_ = 0;
+  size_t num_targets_ = 0;
+  std::vector<char> text_;   // text read but not parsed yet, from text_begin_
+  size_t text_begin_ = 0;
+  std::vector<std::pair<size_t, size_t>> lines_;  // lines of the current batch, as offsets into text_
+  SharedStorage x_storage_;
+  SharedStorage y_storage_;
+  bool is_open_ = false;
+  bool failed_ = false;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_CSVREADER_HPP_
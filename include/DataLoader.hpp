@@ -2,6 +2,8 @@
 #define CPPTENSOR_INCLUDE_DATALOADER_HPP_
 
 #include <iterator>
+#include <memory>
+#include <random>
 #include <vector>
 
 #include "Tensor.hpp"
@@ -10,6 +12,8 @@ namespace cpp_tensor {
 
 class DataLoader {
  public:
+  class Prefetcher;  // background assembly of batches (see SetPrefetch)
+
   class Iterator {
    public:
     // Constructors
@@ -17,7 +21,8 @@ class DataLoader {
              std::vector<int>::iterator end,
              const Tensor &x,
              const Tensor &y,
-             int batch_size);
+             int batch_size,
+             std::shared_ptr<Prefetcher> prefetcher = nullptr);
     Iterator(std::vector<int>::iterator end, const Tensor &x, const Tensor &y);
 
     // Operators
@@ -26,8 +31,10 @@ class DataLoader {
     Iterator &operator++();
 
    private:
-    // Helper function to load a new batch of Data
+    // Helper functions to load a new batch of Data, and to release the previous one (its buffers are kept,
+    // or given back to the prefetcher, unless the batch is still referenced outside the iterator)
     void LoadBatch();
+    void ReleaseBatch();
 
     // Member variables
     std::vector<int>::iterator it_;
@@ -35,12 +42,32 @@ class DataLoader {
     const Tensor &x_;
     const Tensor &y_;
     std::pair<Tensor, Tensor> batch_;
+    // Buffers of the batches, reused as long as the previous batch is no longer referenced outside the iterator
+    SharedStorage x_storage_;
+    SharedStorage y_storage_;
+    // Shared with the loader, so that the workers outlive neither the iterator nor a new epoch started meanwhile
+    std::shared_ptr<Prefetcher> prefetcher_;
+    size_t batch_index_ = 0;
     int batch_size_;
     bool batch_processed_;
   };
 
-  // Constructor
+  // Constructor and destructor
   DataLoader(const Tensor &x, const Tensor &y, int batch_size = 32, bool shuffle = true);
+  ~DataLoader();
+
+  // Options
+  // Seeds the shuffling - the batches of every epoch are then the same in every run (by default they are random)
+  void SetSeed(unsigned seed) { mt_.seed(seed); }
+  // Prefetch mode: num_workers background threads assemble up to depth batches ahead of the training loop
+  // (0 workers assembles every batch on the calling thread, in operator++). The batches and their order
+  // do not depend on the number of workers.
+  void SetPrefetch(size_t num_workers, size_t depth = 2);
+  // Block shuffle: instead of permuting all rows, the order of blocks of block_size consecutive rows is shuffled,
+  // then the rows within every window of window_size consecutive positions. A batch thus reads its rows from
+  // a few contiguous blocks (about window_size / block_size of them) rather than from random addresses,
+  // which matters for large and memory-mapped datasets. block_size = 0 restores the full shuffle.
+  void SetBlockShuffle(size_t block_size, size_t window_size);
 
   // Iterator functions (used automatically by c++ for loop)
   Iterator begin();
@@ -53,6 +80,13 @@ class DataLoader {
   // Helper function to shuffle (if shuffle_ == true) the indices
   void ShuffleIndices();
 
+  // Helper functions to assemble batches: GatherRows copies the rows of source with the given indices
+  // into storage, which is replaced by a new buffer if there is none or it has the wrong size (the caller
+  // must own the buffer - a buffer still referenced elsewhere is never passed in).
+  // BatchTensor returns the batch of count rows of source stored in storage.
+  static void GatherRows(const Tensor &source, const int *indices, size_t count, SharedStorage &storage);
+  static Tensor BatchTensor(const Tensor &source, size_t count, const SharedStorage &storage);
+
   // Member variables
   std::vector<int> indices_;
   const Tensor &x_;
@@ -60,8 +94,14 @@ class DataLoader {
   size_t size_;
   int batch_size_;
   bool shuffle_;
+  std::mt19937 mt_;
+  size_t num_workers_ = 0;
+  size_t prefetch_depth_ = 2;
+  size_t block_size_ = 0;
+  size_t window_size_ = 0;
+  std::shared_ptr<Prefetcher> prefetcher_;
 };
 
 }
 
-#endif // CPPTENSOR_INCLUDE_DATALOADER_HPP_
\ No newline at end of file
+#endif // CPPTENSOR_INCLUDE_DATALOADER_HPP_
@@ -0,0 +1,59 @@
+#ifndef CPPTENSOR_INCLUDE_DATAPARALLEL_HPP_
+#define CPPTENSOR_INCLUDE_DATAPARALLEL_HPP_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ParameterArena.hpp"
+
+namespace cpp_tensor {
+
+// Data-parallel training on the threads of the pool (see ThreadPool.hpp). The model is replicated num_replicas
+// times - the model itself is the first replica and is trained in place - with the parameters of every replica
+// in its own ParameterArena. A step splits the rows of the batch between the replicas and runs their forward and
+// backward passes concurrently. It then all-reduces the gradients: every thread sums one chunk of the
+// arenas over all replicas, in replica order, and writes the sum back to all of them. Finally every replica
+// runs the same optimizer step on the same gradients, so the parameters of all replicas stay bit-identical
+// and the result does not depend on how many threads the pool has.
+// The loss must average over the rows (like MSELoss with MEAN): the gradients of the replicas are weighted
+// by their share of the batch, which gives the gradient of the whole batch only for a mean. With a summed loss
+// the result is wrong (too small by the number of replicas).
+// The replicas run as tasks of ThreadPool::Run, so they run one after another on the calling thread when the
+// pool has one thread or is busy (e.g. Step called from inside a pool task or during a DataLoader prefetch).
+// Tasks on the pool threads do not see the thread-local modes of the caller (Tensor::SetLazy, NoGradGuard):
+// a replica on a pool thread always runs eagerly and with gradients, while one on the calling thread follows
+// the modes of the caller. Call Step with gradients enabled and lazy mode off, so that both cases agree.
+class DataParallelTrainer {
+ public:
+  using MakeOptimizer = std::function<std::unique_ptr<Optimizer>(ParameterArena)>;
+
+  // Constructor - make_optimizer creates the optimizer of each replica
+  DataParallelTrainer(Sequential &model, size_t num_replicas, const MakeOptimizer &make_optimizer);
+
+  // False if the model contains modules that cannot be cloned (see Module::Clone)
+  bool IsValid() const { return !replicas_.empty(); }
+  size_t NumReplicas() const { return replicas_.size(); }
+  const Module &Replica(size_t index) const { return *replicas_[index]; }
+  const ParameterArena &Arena(size_t index) const { return arenas_[index]; }
+
+  // One training step on a batch (rows of x and y) - returns the loss over the whole batch (0 if not IsValid())
+  Scalar Step(const Tensor &x, const Tensor &y, const Loss &loss);
+
+ private:
+  // Helper function
+  void AllReduce(const std::vector<Scalar> &weights);
+
+  // Member variables
+  std::vector<const Module *> replicas_;
+  std::vector<std::unique_ptr<Module>> clones_;
+  std::vector<ParameterArena> arenas_;
+  std::vector<std::unique_ptr<Optimizer>> optimizers_;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_DATAPARALLEL_HPP_
@@ -0,0 +1,65 @@
+#ifndef CPPTENSOR_INCLUDE_FUSION_HPP_
+#define CPPTENSOR_INCLUDE_FUSION_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "InternalTensor.hpp"
+
+namespace cpp_tensor {
+
+// Lazy elementwise fusion.
+// In lazy mode (Tensor::SetLazy(true)) elementwise operations and reductions do not compute anything;
+// they return pending tensors holding a FusedProgram - the chain of operations recorded so far.
+// Using a pending tensor in another elementwise operation extends the chain, while anything that needs
+// its values (Value(), Matmul, views, Backward(), ...) materializes it: the whole chain is evaluated
+// in a single pass over memory, and a single graph node with a fused backward pass is created.
+// E.g. (pred - target).Pow(2).Mean() becomes one node and one loop instead of five of each.
+// Lazy mode is set per thread, and the node takes part in Backward() if gradients were enabled when the chain
+// was recorded, whatever the mode of the thread that materializes it.
+
+// Elementwise operations supported by the fusion engine (kLoad reads an input tensor)
+enum class FusedOp : unsigned char { kLoad, kAdd, kMultiply, kScale, kPow, kRelu };
+
+// One operation of a FusedProgram - produces a new value from the values lhs and rhs
+struct FusedInstruction {
+  FusedOp op;
+  int lhs;          // the index of the input for kLoad
+  int rhs;          // equal to lhs for unary operations
+  Scalar constant;  // the factor of kScale, the leaky slope of kRelu
+  int exponent;     // the exponent of kPow
+};
+
+// A chain of elementwise operations over a fixed set of (materialized, contiguous) input tensors.
+// Instruction k produces value k, and the last value is the result of the program. Inputs smaller than
+// the result are broadcast over its trailing dimensions (element i reads input element i % input size),
+// like scalars and biases. If reduce is set, the result is summed and multiplied by scale (Sum and Mean).
+struct FusedProgram {
+  ParentList inputs;
+  PoolVector<FusedInstruction> instructions;
+  size_t size = 0;  // number of elements of the elementwise result
+  bool reduce = false;
+  Scalar scale = 1;
+  bool use_grad = true;  // whether the operations were recorded with gradients enabled
+
+  int NumValues() const { return instructions.size(); }
+
+  // Evaluate writes the elementwise result (size elements) to out, Reduce returns its scaled sum
+  void Evaluate(Scalar *out) const;
+  double Reduce() const;
+
+  // Accumulates the gradients of the inputs, given the result res of the program
+  void Backward(InternalTensor *res) const;
+};
+
+// Maximum number of values in a program - longer chains materialize an intermediate tensor
+const int kMaxFusedValues = 32;
+
+// Fused counterparts of the elementwise operations and reductions - the result has the Shape of the larger operand
+SharedTensor FusedBinary(FusedOp op, const SharedTensor &a, const SharedTensor &b);
+SharedTensor FusedUnary(FusedOp op, const SharedTensor &a, Scalar constant = 1, int exponent = 1);
+SharedTensor FusedSum(const SharedTensor &a, Scalar scale = 1);
+
+}
+
+#endif // CPPTENSOR_INCLUDE_FUSION_HPP_
@@ -0,0 +1,32 @@
+#ifndef CPPTENSOR_INCLUDE_GEMM_HPP_
+#define CPPTENSOR_INCLUDE_GEMM_HPP_
+
+#include <cstddef>
+
+namespace cpp_tensor {
+
+// General matrix multiplication on row-major matrices: C = alpha * op(A) * op(B) + beta * C,
+// where op(X) is X or its transpose (selected by trans_a / trans_b), op(A) is m x k, op(B) is k x n
+// and C is m x n. lda, ldb and ldc are the row strides (leading dimensions) of the matrices as stored,
+// which allows multiplying sub-matrices in place. Transposed operands are read in place - no copy is made.
+// Large products are cache-blocked and packed into contiguous panels that feed a register-blocked
+// micro-kernel (AVX-512, AVX2 or portable scalar code, chosen once at runtime for the current CPU).
+// If beta is 0, C does not need to be initialized. Both single and double precision are supported.
+void Gemm(bool trans_a, bool trans_b,
+          size_t m, size_t n, size_t k,
+          double alpha, const double *a, size_t lda,
+          const double *b, size_t ldb,
+          double beta, double *c, size_t ldc);
+void Gemm(bool trans_a, bool trans_b,
+          size_t m, size_t n, size_t k,
+          float alpha, const float *a, size_t lda,
+          const float *b, size_t ldb,
+          float beta, float *c, size_t ldc);
+
+// Name of the micro-kernel selected for this CPU ("avx512", "avx2" or "scalar").
+// The choice can be forced with the CPPTENSOR_GEMM_KERNEL environment variable.
+const char *GemmKernelName();
+
+}
+
+#endif // CPPTENSOR_INCLUDE_GEMM_HPP_
@@ -0,0 +1,50 @@
+#ifndef CPPTENSOR_INCLUDE_GRADMODE_HPP_
+#define CPPTENSOR_INCLUDE_GRADMODE_HPP_
+
+#include "InternalTensor.hpp"
+
+namespace cpp_tensor {
+
+// Gradient mode of the calling thread. Each thread has its own mode, so one thread can run a model
+// without gradients (e.g. serving predictions) while another one trains it.
+// Without gradients operations do not build a graph at all: their results do not require a gradient
+// and keep no references to their operands.
+
+// Disables gradients on this thread for the lifetime of the guard
+class NoGradGuard {
+ public:
+  NoGradGuard() : previous_(InternalTensor::use_grad_) { InternalTensor::use_grad_ = false; }
+  ~NoGradGuard() { InternalTensor::use_grad_ = previous_; }
+  NoGradGuard(const NoGradGuard &) = delete;
+  NoGradGuard &operator=(const NoGradGuard &) = delete;
+
+ private:
+  bool previous_;
+};
+
+// Inference mode - like NoGradGuard, but gradients cannot be enabled again (by Tensor::SetUseGrad)
+// on this thread until the guard is destroyed, so code called from inside it never builds a graph
+class InferenceModeGuard {
+ public:
+  InferenceModeGuard() : previous_use_grad_(InternalTensor::use_grad_), previous_inference_(InternalTensor::inference_) {
+    InternalTensor::use_grad_ = false;
+    InternalTensor::inference_ = true;
+  }
+  ~InferenceModeGuard() {
+    InternalTensor::use_grad_ = previous_use_grad_;
+    InternalTensor::inference_ = previous_inference_;
+  }
+  InferenceModeGuard(const InferenceModeGuard &) = delete;
+  InferenceModeGuard &operator=(const InferenceModeGuard &) = delete;
+
+ private:
+  bool previous_use_grad_;
+  bool previous_inference_;
+};
+
+inline bool IsGradEnabled() { return InternalTensor::use_grad_; }
+inline bool IsInferenceMode() { return InternalTensor::inference_; }
+
+}
+
+#endif // CPPTENSOR_INCLUDE_GRADMODE_HPP_
@@ -0,0 +1,120 @@
+#ifndef CPPTENSOR_INCLUDE_GRAPHPOOL_HPP_
+#define CPPTENSOR_INCLUDE_GRAPHPOOL_HPP_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cpp_tensor {
+
+class InternalTensor;
+
+// Pooled allocation of graph metadata - the nodes of the computational graph, their parents, shapes and strides,
+// fused programs and the control blocks of the shared pointers to them.
+// Freed blocks are kept in per-thread free lists (one per size class) instead of going back to the heap,
+// and the next training step builds its graph from the blocks released by Backward() in the previous one.
+// After a warm-up step the graph is built without touching the heap.
+
+struct GraphPoolStats {
+  size_t allocations = 0;       // blocks handed out by the pool
+  size_t heap_allocations = 0;  // the ones that were not in a free list and came from the heap
+};
+
+GraphPoolStats GetGraphPoolStats();
+
+// Largest block kept in the free lists - bigger requests go straight to the heap
+const size_t kMaxPooledBytes = 1024;
+
+void *PoolAllocate(size_t bytes);
+void PoolDeallocate(void *block, size_t bytes);
+
+// Standard allocator backed by the pool, for std::allocate_shared and containers
+template<typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U> &) {}
+
+  T *allocate(size_t n) { return static_cast<T *>(PoolAllocate(n * sizeof(T))); }
+  void deallocate(T *block, size_t n) { PoolDeallocate(block, n * sizeof(T)); }
+
+  template<typename U>
+  bool operator==(const PoolAllocator<U> &) const { return true; }
+  template<typename U>
+  bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
+
+template<typename T>
+using PoolVector = std::vector<T, PoolAllocator<T>>;
+
+// Shapes and strides of tensors
+using Dims = PoolVector<size_t>;
+
+// Backward operation of a graph node - a type-erased callable like std::function<void(InternalTensor *)>,
+// except that the captured variables are always stored inside the object (never on the heap).
+// Capturing more than kCaptureBytes is a compile-time error.
+class BackwardFunction {
+ public:
+  static constexpr size_t kCaptureBytes = 96;
+
+  BackwardFunction() = default;
+  BackwardFunction(std::nullptr_t) {}
+
+  template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, BackwardFunction>::value>>
+  BackwardFunction(F &&fn) {
+    using Fn = std::decay_t<F>;
+    static_assert(sizeof(Fn) <= kCaptureBytes, "the captures of a backward operation exceed kCaptureBytes");
+    static_assert(alignof(Fn) <= alignof(std::max_align_t), "over-aligned captures are not supported");
+    new(storage_) Fn(std::forward<F>(fn));
+    invoke_ = [](void *fn, InternalTensor *res) { (*static_cast<Fn *>(fn))(res); };
+    relocate_ = [](void *dst, void *src) {
+      if (dst)
+        new(dst) Fn(std::move(*static_cast<Fn *>(src)));
+      static_cast<Fn *>(src)->~Fn();
+    };
+  }
+
+  BackwardFunction(BackwardFunction &&other) noexcept { MoveFrom(other); }
+  BackwardFunction &operator=(BackwardFunction &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+  BackwardFunction(const BackwardFunction &) = delete;
+  BackwardFunction &operator=(const BackwardFunction &) = delete;
+  ~BackwardFunction() { Reset(); }
+
+  explicit operator bool() const { return invoke_ != nullptr; }
+  void operator()(InternalTensor *res) { invoke_(storage_, res); }
+
+ private:
+  void Reset() {
+    if (relocate_)
+      relocate_(nullptr, storage_);
+    invoke_ = nullptr;
+    relocate_ = nullptr;
+  }
+  void MoveFrom(BackwardFunction &other) {
+    if (other.relocate_)
+      other.relocate_(storage_, other.storage_);
+    invoke_ = other.invoke_;
+    relocate_ = other.relocate_;
+    other.invoke_ = nullptr;
+    other.relocate_ = nullptr;
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[kCaptureBytes];
+  void (*invoke_)(void *, InternalTensor *) = nullptr;
+  void (*relocate_)(void *, void *) = nullptr;  // moves the callable from src to dst (if any) and destroys it in src
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_GRAPHPOOL_HPP_
@@ -0,0 +1,57 @@
+#ifndef CPPTENSOR_INCLUDE_HOGWILD_HPP_
+#define CPPTENSOR_INCLUDE_HOGWILD_HPP_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Buffer.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ParameterArena.hpp"
+
+namespace cpp_tensor {
+
+// Asynchronous (Hogwild) training: several workers on the threads of the pool train clones of the model,
+// each on its own shard of the rows with its own DataLoader, and update the shared parameters (the arena of
+// the model) without locks and without waiting for each other. The writes race by design: an update may
+// overwrite a concurrent one, which for sparse or small models costs less than synchronizing.
+// With staleness 0 the workers compute their gradients directly on the shared parameters and their optimizers
+// update them in place. With staleness k > 0 each worker trains a private copy for k steps, then adds its change
+// to the shared parameters and refreshes its copy from them.
+// Workers beyond the threads of the pool run after the others (see SetNumThreads).
+class HogwildTrainer {
+ public:
+  using MakeOptimizer = std::function<std::unique_ptr<Optimizer>(ParameterArena)>;
+
+  // Constructor - make_optimizer creates the optimizer of each worker
+  HogwildTrainer(Sequential &model, size_t num_workers, const MakeOptimizer &make_optimizer, size_t staleness = 0);
+
+  // False if the model contains modules that cannot be cloned (see Module::Clone)
+  bool IsValid() const { return !workers_.empty(); }
+  size_t NumWorkers() const { return workers_.size(); }
+
+  // Trains for epochs over the rows of x and y, in batches of batch_size rows - returns the number of steps
+  size_t Train(const Tensor &x, const Tensor &y, const Loss &loss, size_t epochs, int batch_size = 32);
+
+ private:
+  struct Worker {
+    std::unique_ptr<Module> model;
+    ParameterArena arena;
+    std::unique_ptr<Optimizer> optimizer;
+    Buffer snapshot;  // the shared parameters the private copy started from (staleness > 0)
+  };
+
+  // Helper function - adds the change of a private copy to the shared parameters and refreshes the copy
+  void Publish(Worker &worker);
+
+  // Member variables
+  ParameterArena shared_;
+  std::vector<Worker> workers_;
+  size_t staleness_;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_HOGWILD_HPP_
@@ -0,0 +1,68 @@
+#ifndef CPPTENSOR_INCLUDE_INFERENCEPLAN_HPP_
+#define CPPTENSOR_INCLUDE_INFERENCEPLAN_HPP_
+
+#include <vector>
+
+#include "Buffer.hpp"
+#include "Tensor.hpp"
+
+namespace cpp_tensor {
+
+// A frozen model for inference (see Sequential::Freeze) - a flat list of kernels (Gemm with a fused
+// bias addition and activation, or a standalone activation) on copies of the parameters taken when it was built.
+// Running it involves no tensors, no graph and no allocations: the activations alternate between the two
+// buffers of a workspace sized for max_batch rows. The plan itself is immutable, so any number of threads may
+// run it concurrently, each with its own workspace - also while the original model keeps training.
+class InferencePlan {
+ public:
+  // Scratch space of one thread
+  class Workspace {
+   private:
+    friend class InferencePlan;
+    Buffer buffers_[2];
+  };
+
+  // Constructor - an empty plan (the identity) for inputs of up to max_batch rows
+  explicit InferencePlan(size_t max_batch) : max_batch_(max_batch) {}
+
+  // Building - kernels are appended in order. A plan that had a kernel whose input width does not match
+  // the output width of the previous one (or a module that cannot be frozen) is invalid.
+  void AddLinear(const Tensor &weight, const Tensor *bias);  // weight is in x out, bias has out elements
+  void AddRelu(Scalar leaky);
+  void Invalidate() { valid_ = false; }
+
+  bool IsValid() const { return valid_ && width_ > 0; }
+  size_t MaxBatch() const { return max_batch_; }
+  size_t InFeatures() const { return steps_.empty() ? 0 : steps_.front().in; }
+  size_t OutFeatures() const { return steps_.empty() ? 0 : steps_.back().out; }
+
+  // Allocates the scratch space for a thread
+  Workspace MakeWorkspace() const;
+
+  // Runs the model on rows x InFeatures() elements at input (row-major) and writes rows x OutFeatures()
+  // elements to output. Returns false if the plan is invalid or rows exceeds MaxBatch().
+  bool Run(const Scalar *input, size_t rows, Scalar *output, Workspace &workspace) const;
+  // Convenience version for a tensor (one row, or a batch of rows) - allocates the result and a workspace.
+  // Returns an empty tensor if the plan is invalid or x has another width.
+  Tensor Run(const Tensor &x) const;
+
+ private:
+  struct Step {
+    size_t in = 0;
+    size_t out = 0;
+    Buffer weight;     // in x out (empty for a standalone activation)
+    Buffer bias;       // out elements, or empty
+    bool relu = false;
+    Scalar leaky = 0;
+  };
+
+  std::vector<Step> steps_;
+  size_t max_batch_;
+  size_t width_ = 0;      // output width of the last kernel (0 while there is no Gemm to define it)
+  size_t max_width_ = 0;  // widest activation between two kernels
+  bool valid_ = true;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_INFERENCEPLAN_HPP_
@@ -1,60 +1,147 @@
 #ifndef CPPTENSOR_INCLUDE_INTERNALTENSOR_HPP_
 #define CPPTENSOR_INCLUDE_INTERNALTENSOR_HPP_
 
-#include <functional>
+#include <initializer_list>
 #include <utility>
 #include <vector>
 #include <memory>
 
+#include "GraphPool.hpp"
+#include "Scalar.hpp"
+#include "Storage.hpp"
+
 namespace cpp_tensor {
 
 class InternalTensor;
 using SharedTensor = std::shared_ptr<InternalTensor>;
+using ParentList = PoolVector<SharedTensor>;
+struct FusedProgram;
 
 class InternalTensor {
  public:
-  // Constructor
-  InternalTensor(std::vector<double> data, std::vector<size_t> shape, bool requires_grad = false, bool is_leaf = false);
+  // Constructors
+  // (Tensors should be created with MakeTensor, which takes them from the graph pool)
+  InternalTensor(Buffer data, Dims shape, bool requires_grad = false, bool is_leaf = false);
+  // A view of existing storage - offset and strides are measured in elements of the storage
+  InternalTensor(SharedStorage storage, size_t offset, Dims shape, Dims strides,
+                 bool requires_grad = false, bool is_leaf = false);
+  // A pending tensor, whose values are computed by the program when first needed (see Fusion.hpp)
+  InternalTensor(std::shared_ptr<const FusedProgram> program, Dims shape);
+  ~InternalTensor();
 
-  // Data and gradient access
-  double &Data(int index) { return data_[index]; }
-  double &Grad(int index) { return grad_[index]; }
-  size_t Size() const &{ return data_.size(); }
+  // Data and gradient access - the index is the position in the 1D (row-major) representation of the tensor,
+  // the gradient is always stored densely in that order
+  Scalar &Data(int index) { return DataPtr()[contiguous_ ? index : StorageIndex(index) - offset_]; }
+  Scalar &Grad(int index) { return grad_[index]; }
+  bool HasGrad() const &{ return !grad_.empty(); }  // false until a backward pass reaches the tensor
+  size_t Size() const &{ return size_; }
   bool RequiresGrad() const &{ return requires_grad_ && use_grad_; }
 
+  // Layout - the first element lives at DataPtr(), and the element at position (i0, i1, ...)
+  // at DataPtr()[i0 * Strides()[0] + i1 * Strides()[1] + ...]
+  Scalar *DataPtr() {
+    if (fused_)
+      Materialize();
+    return storage_->Data() + offset_;
+  }
+  const Dims &Shape() const &{ return shape_; }
+  const Dims &Strides() const &{ return strides_; }
+  bool IsContiguous() const &{ return contiguous_; }
+  const SharedStorage &GetStorage() &{
+    DataPtr();
+    return storage_;
+  }
+
+  // Copies the elements to dst in row-major order, regardless of the layout
+  void CopyTo(Scalar *dst);
+
+  // Lazy evaluation - a pending tensor has no storage until Materialize() runs its program
+  bool IsPending() const &{ return fused_ != nullptr; }
+  const FusedProgram *Program() const &{ return fused_.get(); }
+  void Materialize();
+
+  // Strides of a densely stored, row-major tensor with the given shape
+  static Dims ContiguousStrides(const Dims &shape);
+
   // Gradient updates
-  void SetGrad(std::vector<double> grad) { grad_ = std::move(grad); }
-  void SetGrad(double grad) { SetGrad(std::vector<double>(Size(), grad)); }
-  void UpdateGrad(std::vector<double> grad);
-  void UpdateGrad(double grad) { UpdateGrad(std::vector<double>(Size(), grad)); }
+  void SetGrad(Buffer grad);
+  void SetGrad(Scalar grad);  // fills the existing gradient in place, if there is one
+  void UpdateGrad(Buffer grad);
+  void UpdateGrad(Scalar grad);
 
   // Performs Backward propagation through the computational graph created during the Forward pass.
-  // If retain_graph is true, the graph is retained for further Backward passes.
+  // The graph is sorted topologically and the backward operations run iteratively from this tensor down.
+  // Unless retain_graph is true, every node releases its backward operation, its parents and (if it is
+  // not a leaf) its gradient as soon as its operation has run, so the activations it kept alive can be freed.
   void Backward(bool retain_graph = false);
 
-  // Static boolean indicating whether to use gradients in every tensor
-  static bool use_grad_;
+  // Whether operations on the calling thread record gradients, and whether it is in inference mode
+  // (see GradMode.hpp). Each thread has its own mode.
+  static inline thread_local bool use_grad_ = true;
+  static inline thread_local bool inference_ = false;
+  // Whether elementwise operations on the calling thread are recorded for fusion instead of computed
+  static inline thread_local bool lazy_ = false;
 
  private:
-  // Friend class that needs full access to this one
+  // Friend classes that need full access to this one
   friend class Tensor;
+  friend class ParameterArena;
+  friend struct FusedProgram;
+
+  // Helper functions
+  void InitLayout();
+  size_t StorageIndex(size_t index) const;
+  // Connects this tensor to the computational graph as the result of an operation on parents, if gradients were
+  // enabled when the operation was recorded (use_grad)
+  void SetOperation(ParentList parents, BackwardFunction backward_op, bool use_grad = use_grad_);
+  // Gradient buffer management - every change goes through ResetGrad, which keeps the memory statistics.
+  // Gradients are created lazily by the first backward operation that reaches them: PrepareGrad allocates
+  // an uninitialized buffer if there is none yet and returns true, in which case the caller must write
+  // every element instead of accumulating into it. A gradient in an arena is never replaced: ResetGrad
+  // copies into it instead (or zeroes it, for an empty buffer), and ignores a buffer of another size.
+  void ResetGrad(Buffer grad);
+  // Moves the elements into data and the gradient into grad, both at offset (see ParameterArena)
+  void MoveToArena(const SharedStorage &data, const SharedStorage &grad, size_t offset);
+  void AllocateGrad();  // zero-filled, if there is no gradient yet
+  bool PrepareGrad();
+  // Accumulates the gradient contribution(i) into element i, for all elements (in parallel), without temporaries
+  template<typename F>
+  void AccumulateGrad(F contribution);
 
   // Member variables
-  std::vector<double> data_;
-  std::vector<double> grad_;
-  std::vector<size_t> shape_;
-  std::vector<SharedTensor> parents_;
-  std::function<void(InternalTensor *)> backward_op_;
+  SharedStorage storage_;
+  size_t offset_ = 0;
+  Dims shape_;
+  Dims strides_;
+  size_t size_ = 1;
+  bool contiguous_ = true;
+  GradBuffer grad_;
+  std::shared_ptr<const FusedProgram> fused_;
+  ParentList parents_;
+  BackwardFunction backward_op_;
+  const char *op_ = nullptr;  // the op that created this node (see Profiler.hpp)
   bool is_leaf_ = false;
   bool requires_grad_ = false;
-  int num_children_ = 0;
-  int children_processed_ = 0;
+  size_t visit_epoch_ = 0;  // the last Backward pass that visited this node
 
   // Friend functions for performing mathematical operations on tensors with gradient calculation support
-  friend SharedTensor ApplyOperation(const std::vector<double> &data,
-                                     const std::vector<size_t> &shape,
-                                     const std::vector<SharedTensor> &parents,
-                                     std::function<void(InternalTensor *)> backward_op);
+  friend SharedTensor ApplyOperation(SharedTensor res, ParentList parents, BackwardFunction backward_op);
+  friend SharedTensor ApplyOperation(Buffer data,
+                                     Dims shape,
+                                     ParentList parents,
+                                     BackwardFunction backward_op);
+  friend SharedTensor ViewInternal(const SharedTensor &a,
+                                   size_t offset,
+                                   Dims shape,
+                                   Dims strides,
+                                   size_t grad_offset,
+                                   Dims grad_strides);
+  friend SharedTensor SelectInternal(const SharedTensor &a, const Dims &indices);
+  friend SharedTensor SliceInternal(const SharedTensor &a, size_t dim, size_t begin, size_t end);
+  friend SharedTensor TransposeInternal(const SharedTensor &a, size_t dim0, size_t dim1);
+  friend SharedTensor ReshapeInternal(const SharedTensor &a, Dims shape);
+  friend SharedTensor ContiguousInternal(const SharedTensor &a);
+  friend void GatherRowsInternal(const SharedTensor &a, const int *indices, size_t count, Scalar *dst);
   friend SharedTensor AddManyOneInternal(const SharedTensor &a, const SharedTensor &b);
   friend SharedTensor AddManyManyInternal(const SharedTensor &a, const SharedTensor &b);
   friend SharedTensor AddBiasInternal(const SharedTensor &a, const SharedTensor &b);
@@ -68,6 +155,22 @@ class InternalTensor {
   friend SharedTensor ReluInternal(const SharedTensor &a, double leaky);
 };
 
+// Creates a tensor in a block of the graph pool (see GraphPool.hpp), together with the control block of the pointer
+template<typename... Args>
+SharedTensor MakeTensor(Args &&... args) {
+  return std::allocate_shared<InternalTensor>(PoolAllocator<InternalTensor>(), std::forward<Args>(args)...);
+}
+
+// x raised to an integer power by repeated multiplication (or division for negative exponents)
+inline Scalar IntegerPow(Scalar x, int exponent) {
+  Scalar res = 1;
+  for (int exp = exponent; exp < 0; exp++)
+    res /= x;
+  for (int exp = exponent; exp > 0; exp--)
+    res *= x;
+  return res;
+}
+
 }
 
 #endif // CPPTENSOR_INCLUDE_INTERNALTENSOR_HPP_
\ No newline at end of file
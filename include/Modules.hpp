@@ -4,6 +4,8 @@
 #include <vector>
 #include <memory>
 
+#include "Checkpoint.hpp"
+#include "InferencePlan.hpp"
 #include "Tensor.hpp"
 #include "Initializations.hpp"
 
@@ -11,6 +13,8 @@ namespace cpp_tensor {
 
 class Module {
  public:
+  virtual ~Module() = default;
+
   // Retrieve Parameters
   virtual std::vector<SharedTensor> Parameters() const & = 0;
 
@@ -19,6 +23,17 @@ class Module {
 
   // Overloaded call operator
   Tensor operator()(const Tensor &x) const &{ return Forward(x); }
+
+  // Appends the kernels of this module to an inference plan (see Sequential::Freeze) -
+  // modules that cannot be frozen invalidate the plan
+  virtual void AddToPlan(InferencePlan &plan) const & { plan.Invalidate(); }
+
+  // Appends the checkpoint records of this module (see Checkpoint.hpp) - false for modules that cannot be stored
+  virtual bool AddToCheckpoint(std::vector<CheckpointModule> &) const & { return false; }
+
+  // Deep copy of this module, with copies of its parameters (e.g. a replica for DataParallelTrainer) -
+  // null for modules that cannot be copied
+  virtual std::unique_ptr<Module> Clone() const & { return nullptr; }
 };
 
 class LinearLayer : public Module {
@@ -28,10 +43,15 @@ class LinearLayer : public Module {
               size_t out_features,
               Initialization init = Initialization::Uniform(),
               bool is_bias = true);
+  // From existing parameters (e.g. loaded from a checkpoint) - weight is in x out, bias is ignored unless is_bias
+  LinearLayer(Tensor weight, Tensor bias, bool is_bias = true);
 
   // Overloaded virtual methods
   virtual std::vector<SharedTensor> Parameters() const & override;
   virtual Tensor Forward(const Tensor &x) const & override;
+  virtual void AddToPlan(InferencePlan &plan) const & override { plan.AddLinear(weight_, is_bias_ ? &bias_ : nullptr); }
+  virtual bool AddToCheckpoint(std::vector<CheckpointModule> &records) const & override;
+  virtual std::unique_ptr<Module> Clone() const & override;
 
  private:
   // Member variables
@@ -50,6 +70,12 @@ class ReLU : public Module {
   // Overloaded virtual methods
   virtual std::vector<SharedTensor> Parameters() const & override { return {}; }
   virtual Tensor Forward(const Tensor &x) const & override { return x.Relu(leaky_); }
+  virtual void AddToPlan(InferencePlan &plan) const & override { plan.AddRelu(leaky_); }
+  virtual bool AddToCheckpoint(std::vector<CheckpointModule> &records) const & override {
+    records.push_back({CheckpointModule::kRelu, 0, 0, 0, leaky_, 0});
+    return true;
+  }
+  virtual std::unique_ptr<Module> Clone() const & override { return std::make_unique<ReLU>(leaky_); }
 
  private:
   // For standard ReLU, this parameter should be 0; for LeakyReLU, it specifies the negative slope
@@ -61,6 +87,14 @@ class Sequential : public Module {
   // Overloaded virtual methods
   virtual std::vector<SharedTensor> Parameters() const & override;
   virtual Tensor Forward(const Tensor &x) const & override;
+  virtual void AddToPlan(InferencePlan &plan) const & override;
+  virtual bool AddToCheckpoint(std::vector<CheckpointModule> &records) const & override;
+  virtual std::unique_ptr<Module> Clone() const & override;
+
+  // Freezes the model into an inference plan for batches of up to max_batch rows, with copies of the current
+  // parameters (later training does not change the plan). Check IsValid() on the result: a model with
+  // modules that have no kernel in a plan cannot be frozen.
+  InferencePlan Freeze(size_t max_batch) const;
 
   // Adds a module to the sequential model using the provided arguments.
   template<typename T, typename... Args>
@@ -70,6 +104,9 @@ class Sequential : public Module {
   }
 
  private:
+  // Checkpoint appends the loaded modules directly
+  friend class Checkpoint;
+
   // List of modules in the sequential model
   std::vector<std::unique_ptr<Module>> modules_;
 };
@@ -5,26 +5,109 @@
 #include <vector>
 
 #include "InternalTensor.hpp"
+#include "ParameterArena.hpp"
 
 namespace cpp_tensor {
 
-class SGD {
+// Base class of the optimizers. A step is one fused pass over every parameter (or over the whole arena),
+// which reads the gradient and updates the parameter and its state buffers (one element per parameter
+// element, e.g. the moments of Adam) in a single SIMD loop, split across threads for large parameters.
+// Parameters without a gradient are skipped.
+class Optimizer {
  public:
-  // Constructor
-  SGD(std::vector<SharedTensor> parameters, double lr) : parameters_(std::move(parameters)), lr_(lr) {}
+  // Constructors
+  explicit Optimizer(std::vector<SharedTensor> parameters);
+  // For the parameters of an arena - steps and zeroing the gradients are single passes over the arena
+  explicit Optimizer(ParameterArena arena);
+  virtual ~Optimizer() = default;
 
   // Optimizer operations
-  void Step();
+  virtual void Step() = 0;
   void ZeroGrad();
 
- private:
+  // State saved in checkpoints (see Checkpoint.hpp) - the hyperparameters and the state buffers.
+  // SetState returns false if the state does not fit this optimizer.
+  virtual std::vector<double> Hyperparameters() const = 0;
+  std::vector<SharedTensor> StateBuffers() const { return state_; }
+  virtual bool SetState(const std::vector<double> &hyperparameters, const std::vector<SharedTensor> &buffers) = 0;
+
+ protected:
+  // Calls update(data, grad, state, size) on ranges of the parameters, where state is the offset of data in
+  // the state buffers
+  template<typename F>
+  void ForEachRange(F update);
+  // Replaces the state buffers by count zero-filled ones, or by copies of buffers (false if they do not fit)
+  void ResetState(size_t count);
+  bool RestoreState(const std::vector<SharedTensor> &buffers);
+  Scalar *State(size_t index) const { return state_[index]->DataPtr(); }
+
   // Member variables
   std::vector<SharedTensor> parameters_;
+  ParameterArena arena_;
+  std::vector<size_t> offsets_;  // of the parameters in the state buffers
+  size_t state_size_ = 0;
+  std::vector<SharedTensor> state_;
+};
+
+// Stochastic gradient descent, optionally with (Nesterov) momentum
+class SGD : public Optimizer {
+ public:
+  // Constructors
+  SGD(std::vector<SharedTensor> parameters, double lr, double momentum = 0, bool nesterov = false);
+  SGD(ParameterArena arena, double lr, double momentum = 0, bool nesterov = false);
+
+  // Overloaded virtual methods
+  virtual void Step() override;
+  virtual std::vector<double> Hyperparameters() const override { return {lr_, momentum_, nesterov_ ? 1. : 0.}; }
+  virtual bool SetState(const std::vector<double> &hyperparameters,
+                        const std::vector<SharedTensor> &buffers) override;
+
+ private:
+  // Member variables
   double lr_;
+  double momentum_;
+  bool nesterov_;
 };
 
-// todo: create Adam optimizer
+// Adam with an L2 penalty in the gradient (weight_decay), see AdamW for decoupled weight decay
+class Adam : public Optimizer {
+ public:
+  // Constructors
+  explicit Adam(std::vector<SharedTensor> parameters, double lr = 1e-3, double beta1 = 0.9, double beta2 = 0.999,
+                double eps = 1e-8, double weight_decay = 0);
+  explicit Adam(ParameterArena arena, double lr = 1e-3, double beta1 = 0.9, double beta2 = 0.999,
+                double eps = 1e-8, double weight_decay = 0);
+
+  // Overloaded virtual methods
+  virtual void Step() override;
+  virtual std::vector<double> Hyperparameters() const override;
+  virtual bool SetState(const std::vector<double> &hyperparameters,
+                        const std::vector<SharedTensor> &buffers) override;
+
+ protected:
+  // Member variables
+  double lr_;
+  double beta1_;
+  double beta2_;
+  double eps_;
+  double weight_decay_;
+  bool decoupled_ = false;
+  size_t steps_ = 0;
+};
+
+// Adam with decoupled weight decay - the parameters shrink by lr * weight_decay every step, independently of
+// the moments
+class AdamW : public Adam {
+ public:
+  // Constructors
+  explicit AdamW(std::vector<SharedTensor> parameters, double lr = 1e-3, double beta1 = 0.9, double beta2 = 0.999,
+                 double eps = 1e-8, double weight_decay = 1e-2)
+      : Adam(std::move(parameters), lr, beta1, beta2, eps, weight_decay) { decoupled_ = true; }
+  explicit AdamW(ParameterArena arena, double lr = 1e-3, double beta1 = 0.9, double beta2 = 0.999,
+                 double eps = 1e-8, double weight_decay = 1e-2)
+      : Adam(std::move(arena), lr, beta1, beta2, eps, weight_decay) { decoupled_ = true; }
+};
 
 }
 
-#endif // CPPTENSOR_INCLUDE_OPTIMIZERS_HPP_
\ No newline at end of file
+#endif // CPPTENSOR_INCLUDE_OPTIMIZERS_HPP_
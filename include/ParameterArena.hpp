@@ -0,0 +1,43 @@
+#ifndef CPPTENSOR_INCLUDE_PARAMETERARENA_HPP_
+#define CPPTENSOR_INCLUDE_PARAMETERARENA_HPP_
+
+#include <vector>
+
+#include "InternalTensor.hpp"
+
+namespace cpp_tensor {
+
+// Parameters (e.g. model.Parameters()) moved into one contiguous, aligned buffer, and their gradients into
+// a second one. Every parameter becomes a dense view at the same offset of both buffers (aligned to
+// kBufferAlignment, the padding between them stays zero), so the modules keep working on them unchanged,
+// while whole-model operations - optimizer steps, zeroing or all-reducing the gradients, saving the
+// weights - are single passes over Data() and Grad(). Views taken of a parameter before it was moved
+// keep the old elements. A default-constructed arena is empty.
+class ParameterArena {
+ public:
+  ParameterArena() = default;
+  explicit ParameterArena(std::vector<SharedTensor> parameters);
+  // Parameters of a replica (of the same shapes, in the same order as those of shared) that become views of the
+  // elements of shared, with gradients of their own - updates through either arena are seen by both. Their
+  // values are written to shared, so they should be equal (e.g. a clone). Empty if the layouts differ.
+  ParameterArena(std::vector<SharedTensor> parameters, const ParameterArena &shared);
+
+  const std::vector<SharedTensor> &Parameters() const { return parameters_; }
+  size_t Size() const { return data_ ? data_->Size() : 0; }  // elements, including the padding
+  Scalar *Data() const { return data_ ? data_->Data() : nullptr; }
+  Scalar *Grad() const { return grad_ ? grad_->Data() : nullptr; }
+
+  void ZeroGrad() const;
+
+ private:
+  // Helper function - moves every parameter to its offset in data_ and grad_ (false if shared has another layout)
+  bool Bind(std::vector<SharedTensor> parameters, const ParameterArena *shared);
+
+  std::vector<SharedTensor> parameters_;
+  SharedStorage data_;
+  SharedStorage grad_;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_PARAMETERARENA_HPP_
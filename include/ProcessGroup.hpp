@@ -0,0 +1,64 @@
+#ifndef CPPTENSOR_INCLUDE_PROCESSGROUP_HPP_
+#define CPPTENSOR_INCLUDE_PROCESSGROUP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Scalar.hpp"
+
+namespace cpp_tensor {
+
+// A group of processes on one host that combine buffers of size elements through a POSIX shared-memory
+// segment, for multi-process data-parallel training: every process trains its own replica on its share of the
+// data, with the parameters in a ParameterArena, and calls AllReduce on the gradients between Backward and
+// the optimizer step. Since every process then applies the same step to the same gradients, the parameters
+// stay bit-identical.
+// The collectives synchronize through atomic counters in the segment, without locks: each process writes its
+// buffer to its own slot, then reduces one chunk of the buffers of all processes (in rank order, so the result
+// does not depend on timing) and finally copies the reduced buffer back. Every process must call the same
+// collectives in the same order; if one of them dies, the others wait forever.
+// Processes may be forked after the thread pool was used - every child starts a pool of its own (e.g. set
+// SetNumThreads(1) in each child, so that the processes do not oversubscribe the cores).
+class ProcessGroup {
+ public:
+  // Joins the group called name (e.g. "/my-job") as process rank of world_size. Rank 0 creates the segment
+  // (replacing a stale one of the same name) and removes it again when it is destroyed; the others wait for it
+  // (a segment whose rank 0 no longer exists, left by a crashed run, is never joined).
+  ProcessGroup(const std::string &name, size_t rank, size_t world_size, size_t size);
+  ~ProcessGroup();
+  ProcessGroup(const ProcessGroup &) = delete;
+  ProcessGroup &operator=(const ProcessGroup &) = delete;
+
+  // False if the segment could not be created or opened, or was created for another group size or buffer size
+  bool IsOpen() const { return header_ != nullptr; }
+  size_t Rank() const { return rank_; }
+  size_t WorldSize() const { return world_size_; }
+
+  // Collectives on size elements at data - the same result in every process
+  void AllReduce(Scalar *data);  // the average over all processes
+  void Broadcast(Scalar *data, size_t root = 0);  // the buffer of root
+  void Barrier();
+
+ private:
+  struct Header;
+
+  // Helper function
+  Scalar *Slot(size_t rank) const;  // world_size slots, then the reduced buffer
+
+  // Member variables
+  std::string name_;
+  size_t rank_;
+  size_t world_size_;
+  size_t size_;
+  size_t stride_ = 0;  // elements between two slots
+  size_t length_ = 0;
+  uint64_t barriers_ = 0;  // barriers this process has passed
+  Header *header_ = nullptr;
+  void *mapping_ = nullptr;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_PROCESSGROUP_HPP_
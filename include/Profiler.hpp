@@ -0,0 +1,92 @@
+#ifndef CPPTENSOR_INCLUDE_PROFILER_HPP_
+#define CPPTENSOR_INCLUDE_PROFILER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "InternalTensor.hpp"
+
+namespace cpp_tensor {
+
+// Per-op profiler. While it runs (between StartProfiler and StopProfiler), every tensor operation and every
+// backward operation records an event: the op, the shapes of its inputs, its wall time, the bytes of buffers it
+// allocated and the thread it ran on. The events are summarized per op or exported as a Chrome trace (open it in
+// chrome://tracing or https://ui.perfetto.dev). Times include nested ops, e.g. the copy of a non-contiguous
+// operand of a matmul.
+// When the profiler is stopped an op costs one relaxed load and a branch, so it stays compiled into every build.
+
+enum class ProfilePhase : uint8_t { kForward, kBackward };
+
+struct ProfileEvent {
+  const char *op;
+  ProfilePhase phase;
+  std::string shapes;       // of the inputs, e.g. "[32, 8] [8, 3]"
+  uint64_t start_ns;        // since StartProfiler
+  uint64_t duration_ns;
+  size_t bytes_allocated;   // buffers allocated by the op, also by the pool threads running its parallel kernels
+  uint32_t thread;          // numbered in the order in which threads recorded their first event
+};
+
+struct ProfileSummaryRow {
+  std::string op;
+  ProfilePhase phase;
+  size_t calls = 0;
+  uint64_t total_ns = 0;
+  size_t bytes_allocated = 0;
+};
+
+void StartProfiler();  // discards the previous events
+void StopProfiler();
+std::vector<ProfileEvent> GetProfileEvents();
+// Events aggregated by op and phase, the longest total time first
+std::vector<ProfileSummaryRow> GetProfileSummary();
+void PrintProfileSummary(std::ostream &out);
+// Writes the events in the Chrome trace_event format - false if the file could not be written
+bool SaveChromeTrace(const std::string &path);
+
+// Records the op running for its lifetime (used by the operations, see InternalTensor.cpp). It also makes op the
+// current op of the thread, which names the backward operations of the nodes created meanwhile.
+class ProfileScope {
+ public:
+  ProfileScope(const char *op, std::initializer_list<const InternalTensor *> inputs) : previous_op_(current_op_) {
+    current_op_ = op;
+    if (enabled_.load(std::memory_order_relaxed))
+      Begin(op, ProfilePhase::kForward, Shapes(inputs));
+  }
+  ProfileScope(const char *op, ProfilePhase phase, const ParentList &inputs) : previous_op_(current_op_) {
+    current_op_ = op;
+    if (enabled_.load(std::memory_order_relaxed))
+      Begin(op, phase, Shapes(inputs));
+  }
+  ~ProfileScope() {
+    current_op_ = previous_op_;
+    if (record_)
+      End();
+  }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+  static inline std::atomic<bool> enabled_{false};
+  static inline thread_local const char *current_op_ = nullptr;
+
+ private:
+  struct Record;  // of an op that runs while the profiler runs
+
+  // Helper functions (only called while the profiler runs)
+  static std::string Shapes(std::initializer_list<const InternalTensor *> inputs);
+  static std::string Shapes(const ParentList &inputs);
+  void Begin(const char *op, ProfilePhase phase, std::string shapes);
+  void End();
+
+  // Member variables - only two pointers, so that a stopped profiler costs nothing
+  const char *previous_op_;
+  Record *record_ = nullptr;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_PROFILER_HPP_
@@ -0,0 +1,36 @@
+#ifndef CPPTENSOR_INCLUDE_SCALAR_HPP_
+#define CPPTENSOR_INCLUDE_SCALAR_HPP_
+
+namespace cpp_tensor {
+
+// Element type of every tensor in the library, fixed at build time.
+// Compile with -DCPPTENSOR_FLOAT32 (make PRECISION=float) for single precision; the default is double.
+// Because a single element type is used throughout, tensors of different precisions can never be mixed -
+// passing e.g. std::vector<double> data to a float32 build is a compile-time error.
+#ifdef CPPTENSOR_FLOAT32
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
+
+// Tag describing an element type, used wherever tensors are stored outside of the process
+enum class DType : unsigned char { kFloat32 = 1, kFloat64 = 2 };
+
+template<typename T>
+constexpr DType DTypeOf();
+
+template<>
+constexpr DType DTypeOf<float>() { return DType::kFloat32; }
+
+template<>
+constexpr DType DTypeOf<double>() { return DType::kFloat64; }
+
+// The element type of this build
+constexpr DType kDType = DTypeOf<Scalar>();
+
+// Human-readable name of an element type ("float32" or "float64")
+constexpr const char *DTypeName(DType dtype) { return dtype == DType::kFloat32 ? "float32" : "float64"; }
+
+}
+
+#endif // CPPTENSOR_INCLUDE_SCALAR_HPP_
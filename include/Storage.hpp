@@ -0,0 +1,93 @@
+#ifndef CPPTENSOR_INCLUDE_STORAGE_HPP_
+#define CPPTENSOR_INCLUDE_STORAGE_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Buffer.hpp"
+
+namespace cpp_tensor {
+
+// Memory held by tensors - the data of every storage and every gradient buffer, in bytes.
+// During a training step the peak is reached at the end of the Forward pass (all activations alive)
+// and the usage falls again as Backward releases the graph.
+struct GraphMemoryStats {
+  size_t current_bytes = 0;
+  size_t peak_bytes = 0;
+};
+
+GraphMemoryStats GetGraphMemoryStats();
+void ResetPeakGraphMemory(); // sets the peak to the current usage
+void TrackGraphMemory(std::ptrdiff_t bytes); // called by the owners of tensor memory
+
+// Flat buffer of elements shared by a tensor and every view of it.
+// A tensor only describes which part of its storage it uses (offset, shape and strides),
+// so selecting, slicing, reshaping or transposing a tensor never copies the elements.
+class Storage {
+ public:
+  explicit Storage(Buffer data) : data_(std::move(data)), elements_(data_.data()), size_(data_.size()) {
+    TrackGraphMemory(Bytes());
+  }
+  // Elements owned by something else, e.g. a memory-mapped file (see TensorFile.hpp),
+  // which owner keeps alive as long as the storage exists. They are not counted as graph memory.
+  Storage(Scalar *elements, size_t size, std::shared_ptr<void> owner)
+      : elements_(elements), size_(size), owner_(std::move(owner)) {}
+  ~Storage() { TrackGraphMemory(-Bytes()); }
+  Storage(const Storage &) = delete;
+  Storage &operator=(const Storage &) = delete;
+
+  Scalar *Data() { return elements_; }
+  const Scalar *Data() const { return elements_; }
+  size_t Size() const { return size_; }
+
+ private:
+  std::ptrdiff_t Bytes() const { return data_.capacity() * sizeof(Scalar); }
+
+  Buffer data_;
+  Scalar *elements_;
+  size_t size_;
+  std::shared_ptr<void> owner_;
+};
+
+using SharedStorage = std::shared_ptr<Storage>;
+
+// Gradient of a tensor - a buffer of its own, or a range of the gradient storage of a parameter arena
+// (see ParameterArena.hpp), which the tensor accumulates into in place and never replaces.
+// Only owned buffers count towards the capacity (the arena's storage keeps its own statistics).
+class GradBuffer {
+ public:
+  GradBuffer() = default;
+  GradBuffer(Buffer grad) : owned_(std::move(grad)), elements_(owned_.data()), size_(owned_.size()) {}
+  GradBuffer(SharedStorage arena, size_t offset, size_t size)
+      : elements_(arena->Data() + offset), size_(size), arena_(std::move(arena)) {}
+  GradBuffer(GradBuffer &&other) noexcept { *this = std::move(other); }
+  GradBuffer &operator=(GradBuffer &&other) noexcept {
+    owned_ = std::move(other.owned_);
+    elements_ = std::exchange(other.elements_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    arena_ = std::move(other.arena_);
+    return *this;
+  }
+
+  Scalar *data() { return elements_; }
+  const Scalar *data() const { return elements_; }
+  Scalar *begin() { return elements_; }
+  Scalar *end() { return elements_ + size_; }
+  Scalar &operator[](size_t index) { return elements_[index]; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return owned_.capacity(); }
+  bool InArena() const { return arena_ != nullptr; }
+
+ private:
+  Buffer owned_;
+  Scalar *elements_ = nullptr;
+  size_t size_ = 0;
+  SharedStorage arena_;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_STORAGE_HPP_
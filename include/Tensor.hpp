@@ -6,6 +6,7 @@
 #include <vector>
 #include <array>
 
+#include "GradMode.hpp"
 #include "InternalTensor.hpp"
 
 namespace cpp_tensor {
@@ -13,14 +14,18 @@ namespace cpp_tensor {
 class Tensor {
  public:
   // Constructors
-  Tensor(double value = 0, bool requires_grad = false); // for a 0D tensor
-  Tensor(std::vector<double> values, bool requires_grad = false); // for a 1D tensor
-  Tensor(std::vector<double> values, std::vector<size_t> shape, bool requires_grad = false); // specified Shape
-  Tensor(double value, std::vector<size_t> shape, bool requires_grad = false); // specified Shape filled with value
+  Tensor(Scalar value = 0, bool requires_grad = false); // for a 0D tensor
+  Tensor(std::vector<Scalar> values, bool requires_grad = false); // for a 1D tensor
+  Tensor(std::vector<Scalar> values, std::vector<size_t> shape, bool requires_grad = false); // specified Shape
+  Tensor(Scalar value, std::vector<size_t> shape, bool requires_grad = false); // specified Shape filled with value
   Tensor(SharedTensor &&tensor); // for internal use
 
   // Static functions
-  static void SetUseGrad(bool use_grad) { InternalTensor::use_grad_ = use_grad; }
+  // Enables or disables gradients on the calling thread (prefer the scoped NoGradGuard, see GradMode.hpp)
+  static void SetUseGrad(bool use_grad) { InternalTensor::use_grad_ = use_grad && !InternalTensor::inference_; }
+  // In lazy mode chains of elementwise operations, Sum and Mean are fused and evaluated when needed (see Fusion.hpp).
+  // Like the grad mode, the mode belongs to the calling thread.
+  static void SetLazy(bool lazy) { InternalTensor::lazy_ = lazy; }
   static Tensor Concat(const std::vector<Tensor> &tensors);
   static std::array<Tensor, 4> TrainTestSplit(const Tensor &x, const Tensor &y, double ratio);
 
@@ -28,21 +33,29 @@ class Tensor {
   SharedTensor GetTensor() const { return tensor_; };
   // Value(indices): If fewer indices are provided than the number of dimensions,
   // the remaining dimensions are assumed to be zero.
-  double Value(const std::vector<int> &indices = {}) const;
+  Scalar Value(const std::vector<int> &indices = {}) const;
   // ValueTensor(indices): If fewer indices are provided than the number of dimensions,
   // the returned tensor contains all the Data in the remaining dimensions and has the corresponding Shape.
   Tensor ValueTensor(const std::vector<int> &indices) const;
 
   // Shape information
-  std::vector<size_t> Shape() const { return tensor_->shape_; }
+  std::vector<size_t> Shape() const { return {tensor_->shape_.begin(), tensor_->shape_.end()}; }
   size_t Shape(int index) const { return tensor_->shape_[index]; }
-  size_t Size() const { return tensor_->data_.size(); }
+  size_t Size() const { return tensor_->Size(); }
   size_t NumDimensions() const { return tensor_->shape_.size(); }
+  bool IsContiguous() const { return tensor_->IsContiguous(); }
+
+  // Views - ValueTensor, Slice, Transpose, Reshape and Flatten return tensors sharing the Data of this one
+  // (writes through one are visible in the other) and gradients flow back through them.
+  // Reshape and Flatten copy the Data only if this tensor is not contiguous (e.g. after Transpose).
+  Tensor Slice(size_t dim, size_t begin, size_t end) const &; // elements [begin, end) of dimension dim
+  Tensor Transpose(size_t dim0 = 0, size_t dim1 = 1) const &;
+  Tensor Reshape(std::vector<size_t> new_shape) const &;
+  Tensor Flatten() const &;
+  Tensor Contiguous() const &; // this tensor if contiguous, a dense copy otherwise
 
   // Tensor operations
   void Backward(bool retain_graph = false);
-  Tensor Reshape(std::vector<size_t> new_shape);
-  Tensor Flatten();
   Tensor Clone(bool deep_copy = true) const &;
 
   // Mathematical operations
@@ -59,16 +72,11 @@ class Tensor {
   Tensor Relu(double leaky) const &;
 
   // Indexing operator - returns the Data at the specified index in the 1D representation of the tensor
-  double operator[](int index) const { return tensor_->data_[index]; }
+  Scalar operator[](int index) const { return tensor_->Data(index); }
 
  private:
-  // Helper function - the strides are used to determine the position of elements in the
-  // 1D representation of the tensor, primarily for use in the ValueTensor() function.
-  void CalculateStrides();
-
   // Member variables
   SharedTensor tensor_;
-  std::vector<size_t> strides_;
 };
 
 }
@@ -0,0 +1,80 @@
+#ifndef CPPTENSOR_INCLUDE_TENSORFILE_HPP_
+#define CPPTENSOR_INCLUDE_TENSORFILE_HPP_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Tensor.hpp"
+
+namespace cpp_tensor {
+
+// Binary tensor files - a fixed-size header followed by the elements in row-major order, so that a dataset
+// can be memory-mapped and used without parsing or loading it (see MappedDataset).
+// The elements start at data_offset, a multiple of kTensorFileAlignment, which keeps them page aligned
+// once mapped. All fields are stored in the byte order of the machine (little-endian on x86 and ARM).
+
+const char kTensorFileMagic[8] = {'C', 'P', 'P', 'T', 'E', 'N', 'S', 'R'};
+const uint32_t kTensorFileVersion = 1;
+const size_t kMaxTensorFileDims = 8;
+const size_t kTensorFileAlignment = 4096;
+
+struct TensorFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint8_t dtype;  // DType of the elements
+  uint8_t reserved[3];
+  uint64_t num_dims;
+  uint64_t shape[kMaxTensorFileDims];
+  uint64_t data_offset;  // in bytes, from the beginning of the file
+};
+
+// Writes a tensor file row by row, for datasets that are produced (or converted) in pieces.
+// The first dimension of the shape is the number of rows appended; it is written into the header by Close().
+class TensorFileWriter {
+ public:
+  // Constructor and destructor - row_shape is the shape of a single row (empty for a 1D tensor)
+  TensorFileWriter(const std::string &path, std::vector<size_t> row_shape);
+  ~TensorFileWriter() { Close(); }
+
+  bool IsOpen() const { return file_.is_open(); }
+  size_t NumRows() const { return num_rows_; }
+
+  // Appends count rows, stored one after another at rows
+  void AppendRows(const Scalar *rows, size_t count);
+  // Completes the header and closes the file - returns false if anything could not be written
+  bool Close();
+
+ private:
+  std::ofstream file_;
+  std::vector<size_t> row_shape_;
+  size_t row_size_ = 1;
+  size_t num_rows_ = 0;
+};
+
+// Writes the tensor to path (any layout) - returns false if the file could not be written
+bool WriteTensorFile(const std::string &path, const Tensor &tensor);
+
+// A tensor file mapped into memory. Data() is a tensor whose storage is the mapping itself, so opening
+// a dataset of any size takes constant time, and the rows are paged in by the operating system when first read
+// (e.g. when DataLoader gathers them into a batch) rather than loaded up front. Parts of the dataset are taken
+// with views, e.g. Data().Slice(0, 0, n) for a training split, which do not copy anything either.
+// The mapping is private: writes to the tensor are never written back to the file.
+class MappedDataset {
+ public:
+  explicit MappedDataset(const std::string &path);
+
+  // False if the file could not be mapped, is not a tensor file, or stores another element type than Scalar
+  bool IsOpen() const { return is_open_; }
+  const Tensor &Data() const { return data_; }
+  size_t NumRows() const { return is_open_ ? data_.Shape(0) : 0; }
+
+ private:
+  Tensor data_;
+  bool is_open_ = false;
+};
+
+}
+
+#endif // CPPTENSOR_INCLUDE_TENSORFILE_HPP_
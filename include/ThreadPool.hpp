@@ -0,0 +1,115 @@
+#ifndef CPPTENSOR_INCLUDE_THREADPOOL_HPP_
+#define CPPTENSOR_INCLUDE_THREADPOOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpp_tensor {
+
+// Sets the number of threads used by intra-op parallel kernels (1 runs everything on the calling thread).
+// By default all hardware threads are used, or the value of the CPPTENSOR_NUM_THREADS environment variable.
+void SetNumThreads(size_t num_threads);
+size_t GetNumThreads();
+
+// Default number of elements below which elementwise kernels stay serial
+constexpr size_t kGrainSize = 1 << 15;
+
+// A fixed set of worker threads that execute the tasks of one parallel region at a time.
+// The calling thread takes part in the work, so a pool of n threads owns n - 1 workers.
+class ThreadPool {
+ public:
+  // Constructor and destructor
+  explicit ThreadPool(size_t num_threads);
+  ~ThreadPool();
+
+  size_t NumThreads() const { return workers_.size() + 1; }
+
+  // Runs task(0), ..., task(num_tasks - 1) across the pool and returns when all of them have finished.
+  // If the pool is already busy with another region (or called from inside one), the tasks run serially.
+  void Run(size_t num_tasks, const std::function<void(size_t)> &task);
+
+  // Returns the process-wide pool used by the kernels, with GetNumThreads() threads. Callers keep the pointer for
+  // the whole parallel region: SetNumThreads replaces the global pool, but one that is still running stays alive
+  // until its last region has finished. The pool is looked up without locks unless the number of threads changed.
+  // A child process created by fork starts with a new pool (the threads of the parent's pool do not exist in it).
+  static std::shared_ptr<ThreadPool> Global();
+
+  // True while the current thread executes a task of some parallel region
+  static bool InParallelRegion();
+
+ private:
+  // Helper functions
+  void WorkerLoop();
+  void RunTasks();
+
+  // Member variables
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(size_t)> *task_ = nullptr;
+  size_t num_tasks_ = 0;
+  std::atomic<size_t> next_task_{0};
+  std::atomic<size_t> worker_allocated_bytes_{0};  // buffers allocated by the workers' tasks, in this region
+  size_t active_workers_ = 0;
+  size_t generation_ = 0;
+  bool stop_ = false;
+};
+
+// Calls fn(chunk_begin, chunk_end) on disjoint sub-ranges covering [begin, end).
+// Ranges no longer than grain run inline on the calling thread without touching the pool.
+template<typename F>
+void ParallelFor(size_t begin, size_t end, size_t grain, F &&fn) {
+  const size_t kSize = end > begin ? end - begin : 0;
+  const size_t kThreads = GetNumThreads();
+  if (kSize <= grain || kThreads == 1 || ThreadPool::InParallelRegion()) {
+    if (kSize > 0)
+      fn(begin, end);
+    return;
+  }
+
+  // A few chunks per thread for load balancing, but never smaller than the grain
+  const size_t kChunk = std::max(grain, (kSize + 4 * kThreads - 1) / (4 * kThreads));
+  const size_t kNumChunks = (kSize + kChunk - 1) / kChunk;
+  ThreadPool::Global()->Run(kNumChunks, [&](size_t chunk) {
+    const size_t kBegin = begin + chunk * kChunk;
+    fn(kBegin, std::min(end, kBegin + kChunk));
+  });
+}
+
+// Reduces [begin, end) by evaluating map(chunk_begin, chunk_end) on grain-sized chunks in parallel
+// and folding the partial results with combine in chunk order. Since the chunking depends only on grain,
+// the result is identical for any number of threads.
+template<typename T, typename Map, typename Combine>
+T ParallelReduce(size_t begin, size_t end, size_t grain, T identity, Map &&map, Combine &&combine) {
+  const size_t kSize = end > begin ? end - begin : 0;
+  if (kSize == 0)
+    return identity;
+  if (kSize <= grain)
+    return combine(identity, map(begin, end));
+
+  const size_t kNumChunks = (kSize + grain - 1) / grain;
+  std::vector<T> partials(kNumChunks, identity);
+  ParallelFor(0, kNumChunks, 1, [&](size_t chunk_begin, size_t chunk_end) {
+    for (size_t chunk = chunk_begin; chunk < chunk_end; chunk++) {
+      const size_t kBegin = begin + chunk * grain;
+      partials[chunk] = map(kBegin, std::min(end, kBegin + grain));
+    }
+  });
+
+  T res = identity;
+  for (auto &partial : partials)
+    res = combine(res, partial);
+  return res;
+}
+
+}
+
+#endif // CPPTENSOR_INCLUDE_THREADPOOL_HPP_
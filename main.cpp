@@ -16,7 +16,7 @@
 using namespace cpp_tensor;
 
 // Standardizes the input values to have zero Mean and unit variance
-void Standardize(std::vector<double> &values, int features) {
+void Standardize(std::vector<Scalar> &values, int features) {
   for (int i = 0; i < features; i++) {
     double sum = 0;
 
@@ -40,7 +40,7 @@ void Standardize(std::vector<double> &values, int features) {
 double ComputeError(Sequential &model, DataLoader &data_loader) {
   auto criterion = MSELoss(MSELoss::SUM);
   double loss_sum = 0, cnt = 0;
-  Tensor::SetUseGrad(false);
+  InferenceModeGuard inference_mode;
 
   // Accumulate loss over all batches in the Data loader
   for (auto &[x_batch, y_batch] : data_loader) {
@@ -49,7 +49,6 @@ double ComputeError(Sequential &model, DataLoader &data_loader) {
     loss_sum += loss.Value();
     cnt += x_batch.Shape(0);
   }
-  Tensor::SetUseGrad(true);
   return loss_sum / cnt;
 }
 
@@ -57,17 +56,17 @@ int main() {
   // Random number generators for creating sample Data
   std::random_device rd;
   std::mt19937 mt(rd());
-  std::uniform_real_distribution<double> uniform_dist(0, 30);
-  std::normal_distribution<double> normal_dist(0, 1);
+  std::uniform_real_distribution<Scalar> uniform_dist(0, 30);
+  std::normal_distribution<Scalar> normal_dist(0, 1);
 
   // Generate sample Data with 2 features and 3 outputs
   const size_t kDataSize = 2e4, kFeatures = 2, kOutputs = 3;
-  std::vector<double> data_x, data_y;
+  std::vector<Scalar> data_x, data_y;
   for (int i = 0; i < kDataSize; i++) {
-    double x1 = uniform_dist(mt), x2 = uniform_dist(mt);
-    double y1 = -7.0 * x1 + 3.0 * x2;
-    double y2 = 0.2 * x1 * x2;
-    double y3 = 0.4 * x1 * x1 - 0.5 * x2 * x2;
+    Scalar x1 = uniform_dist(mt), x2 = uniform_dist(mt);
+    Scalar y1 = -7.0 * x1 + 3.0 * x2;
+    Scalar y2 = 0.2 * x1 * x2;
+    Scalar y3 = 0.4 * x1 * x1 - 0.5 * x2 * x2;
     data_x.insert(data_x.end(), {x1, x2});
     data_y.insert(data_y.end(), {y1, y2, y3});
   }
@@ -96,6 +95,9 @@ int main() {
   model.AddModule<ReLU>(0.2);
   model.AddModule<LinearLayer>(8, 3);
 
+  // Fuse chains of elementwise operations (the bias additions, activations and the loss)
+  Tensor::SetLazy(true);
+
   // Define optimizer and loss function
   SGD optimizer(model.Parameters(), 5e-4);
   MSELoss criterion;
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <mutex>
+#include <new>
+
+#include "Buffer.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+// Size classes are the powers of two from kMinBufferBytes up
+const size_t kMinBufferBytes = kBufferAlignment;
+const size_t kNumClasses = 64;
+
+struct BufferCache {
+  std::mutex mutex;
+  std::vector<void *> free_buffers[kNumClasses];
+  BufferCacheStats stats;
+};
+
+// Never destroyed - tensors owned by static objects may still free their buffers after main returns
+BufferCache &Cache() {
+  static BufferCache *cache = new BufferCache();
+  return *cache;
+}
+
+thread_local size_t thread_allocated_bytes = 0;
+
+size_t SizeClass(size_t bytes) {
+  size_t size_class = 0;
+  while ((kMinBufferBytes << size_class) < bytes)
+    size_class++;
+  return size_class;
+}
+
+}
+
+// Statistics
+
+BufferCacheStats GetBufferCacheStats() {
+  BufferCache &cache = Cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.stats;
+}
+
+void ResetPeakBufferMemory() {
+  BufferCache &cache = Cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.stats.peak_bytes_in_use = cache.stats.bytes_in_use;
+}
+
+void EmptyBufferCache() {
+  BufferCache &cache = Cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  for (auto &free_buffers : cache.free_buffers) {
+    for (void *buffer : free_buffers)
+      ::operator delete(buffer, std::align_val_t(kBufferAlignment));
+    free_buffers.clear();
+    free_buffers.shrink_to_fit();
+  }
+  cache.stats.bytes_cached = 0;
+}
+
+size_t ThreadAllocatedBytes() {
+  return thread_allocated_bytes;
+}
+
+void ChargeThreadAllocatedBytes(size_t bytes) {
+  thread_allocated_bytes += bytes;
+}
+
+// Allocation
+
+void *AllocateBuffer(size_t bytes) {
+  const size_t kClass = SizeClass(bytes);
+  const size_t kBytes = kMinBufferBytes << kClass;
+  thread_allocated_bytes += kBytes;
+  BufferCache &cache = Cache();
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    BufferCacheStats &stats = cache.stats;
+    stats.bytes_in_use += kBytes;
+    stats.peak_bytes_in_use = std::max(stats.peak_bytes_in_use, stats.bytes_in_use);
+    if (!cache.free_buffers[kClass].empty()) {
+      void *buffer = cache.free_buffers[kClass].back();
+      cache.free_buffers[kClass].pop_back();
+      stats.bytes_cached -= kBytes;
+      stats.hits++;
+      return buffer;
+    }
+    stats.misses++;
+  }
+  return ::operator new(kBytes, std::align_val_t(kBufferAlignment));
+}
+
+void FreeBuffer(void *buffer, size_t bytes) {
+  const size_t kClass = SizeClass(bytes);
+  const size_t kBytes = kMinBufferBytes << kClass;
+  BufferCache &cache = Cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.free_buffers[kClass].push_back(buffer);
+  cache.stats.bytes_in_use -= kBytes;
+  cache.stats.bytes_cached += kBytes;
+}
+
+}
@@ -0,0 +1,218 @@
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Checkpoint.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+size_t RoundUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+template<typename T>
+void WriteRecords(std::ofstream &file, const T *records, size_t count) {
+  file.write(reinterpret_cast<const char *>(records), count * sizeof(T));
+}
+
+}
+
+// Saving
+
+bool SaveCheckpoint(const std::string &path, const Sequential &model, const Optimizer *optimizer) {
+  std::vector<CheckpointModule> modules;
+  if (!model.AddToCheckpoint(modules))
+    return false;
+  std::vector<SharedTensor> tensors = model.Parameters();
+  const size_t kNumModelTensors = tensors.size();
+  std::vector<double> hyperparameters;
+  if (optimizer) {
+    hyperparameters = optimizer->Hyperparameters();
+    const auto kBuffers = optimizer->StateBuffers();
+    tensors.insert(tensors.end(), kBuffers.begin(), kBuffers.end());
+  }
+
+  std::vector<CheckpointTensor> records(tensors.size());
+  size_t data_size = 0;
+  for (size_t t = 0; t < tensors.size(); t++) {
+    const Dims &kShape = tensors[t]->Shape();
+    if (kShape.size() > kMaxTensorFileDims)
+      return false;
+    records[t].num_dims = kShape.size();
+    std::copy(kShape.begin(), kShape.end(), records[t].shape);
+    records[t].offset = data_size;
+    data_size = RoundUp(data_size + tensors[t]->Size() * sizeof(Scalar), kBufferAlignment);
+  }
+
+  CheckpointHeader header = {};
+  std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+  header.version = kCheckpointVersion;
+  header.dtype = static_cast<uint8_t>(kDType);
+  header.num_modules = modules.size();
+  header.num_model_tensors = kNumModelTensors;
+  header.num_optimizer_tensors = tensors.size() - kNumModelTensors;
+  header.num_hyperparameters = hyperparameters.size();
+  const size_t kMetadataSize = sizeof(header) + modules.size() * sizeof(CheckpointModule)
+      + records.size() * sizeof(CheckpointTensor) + hyperparameters.size() * sizeof(double);
+  header.data_offset = RoundUp(kMetadataSize, kTensorFileAlignment);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  WriteRecords(file, &header, 1);
+  WriteRecords(file, modules.data(), modules.size());
+  WriteRecords(file, records.data(), records.size());
+  WriteRecords(file, hyperparameters.data(), hyperparameters.size());
+  // The file reaches data_offset even when there are no tensors
+  const std::vector<char> kPadding(header.data_offset - kMetadataSize);
+  WriteRecords(file, kPadding.data(), kPadding.size());
+  Buffer data;
+  for (size_t t = 0; t < tensors.size(); t++) {
+    file.seekp(header.data_offset + records[t].offset);
+    data.resize(tensors[t]->Size());
+    tensors[t]->CopyTo(data.data());
+    WriteRecords(file, data.data(), data.size());
+  }
+  return file.good();
+}
+
+// Checkpoint - Constructor
+
+Checkpoint::Checkpoint(const std::string &path) {
+  const int kFd = open(path.c_str(), O_RDONLY);
+  if (kFd < 0)
+    return;
+  struct stat st = {};
+  length_ = fstat(kFd, &st) == 0 ? st.st_size : 0;
+  void *mapping = length_ >= sizeof(CheckpointHeader)
+      ? mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_PRIVATE, kFd, 0) : MAP_FAILED;
+  close(kFd);
+  if (mapping == MAP_FAILED)
+    return;
+  const size_t kLength = length_;
+  mapping_ = std::shared_ptr<void>(mapping, [kLength](void *p) { munmap(p, kLength); });
+
+  // Every table and every tensor must lie within the file
+  const char *kBase = static_cast<const char *>(mapping);
+  const auto *kHeader = reinterpret_cast<const CheckpointHeader *>(kBase);
+  const size_t kNumTensors = kHeader->num_model_tensors + kHeader->num_optimizer_tensors;
+  bool valid = std::memcmp(kHeader->magic, kCheckpointMagic, sizeof(kHeader->magic)) == 0
+      && kHeader->version == kCheckpointVersion && kHeader->dtype == static_cast<uint8_t>(kDType)
+      && kHeader->num_modules <= length_ / sizeof(CheckpointModule)
+      && kNumTensors <= length_ / sizeof(CheckpointTensor) && kHeader->num_hyperparameters <= length_ / sizeof(double)
+      && kHeader->data_offset % kTensorFileAlignment == 0 && kHeader->data_offset <= length_
+      && sizeof(CheckpointHeader) + kHeader->num_modules * sizeof(CheckpointModule)
+          + kNumTensors * sizeof(CheckpointTensor) + kHeader->num_hyperparameters * sizeof(double)
+          <= kHeader->data_offset;
+  if (!valid) {
+    mapping_ = nullptr;
+    return;
+  }
+  modules_ = reinterpret_cast<const CheckpointModule *>(kBase + sizeof(CheckpointHeader));
+  tensors_ = reinterpret_cast<const CheckpointTensor *>(modules_ + kHeader->num_modules);
+  hyperparameters_ = reinterpret_cast<const double *>(tensors_ + kNumTensors);
+
+  const size_t kDataLength = length_ - kHeader->data_offset;
+  for (size_t t = 0; valid && t < kNumTensors; t++) {
+    const CheckpointTensor &kRecord = tensors_[t];
+    size_t size = 1;
+    valid = kRecord.num_dims <= kMaxTensorFileDims && kRecord.offset % kBufferAlignment == 0;
+    for (size_t d = 0; valid && d < kRecord.num_dims; d++) {
+      valid = kRecord.shape[d] <= kDataLength;
+      size *= kRecord.shape[d];
+      valid = valid && size <= kDataLength;
+    }
+    valid = valid && kRecord.offset <= kDataLength && size * sizeof(Scalar) <= kDataLength - kRecord.offset;
+  }
+  if (!valid) {
+    mapping_ = nullptr;
+    return;
+  }
+  header_ = kHeader;
+}
+
+// Checkpoint - Loading
+
+bool Checkpoint::LoadModel(Sequential &model, bool zero_copy) const {
+  if (!IsOpen() || header_->num_modules == 0 || modules_[0].kind != CheckpointModule::kSequential)
+    return false;
+  const CheckpointModule *record = modules_ + 1;
+  size_t tensor = 0;
+  Sequential loaded;
+  if (!LoadModules(record, modules_[0].num_children, tensor, zero_copy, loaded)
+      || record != modules_ + header_->num_modules || tensor != header_->num_model_tensors)
+    return false;
+  for (auto &module : loaded.modules_)
+    model.modules_.push_back(std::move(module));
+  return true;
+}
+
+bool Checkpoint::LoadOptimizer(Optimizer &optimizer) const {
+  if (!HasOptimizerState())
+    return false;
+  const std::vector<double> kHyperparameters(hyperparameters_, hyperparameters_ + header_->num_hyperparameters);
+  std::vector<SharedTensor> buffers;
+  for (size_t t = 0; t < header_->num_optimizer_tensors; t++)
+    buffers.push_back(LoadTensor(header_->num_model_tensors + t, false, false).GetTensor());
+  return optimizer.SetState(kHyperparameters, buffers);
+}
+
+// Checkpoint - Helper functions
+
+Tensor Checkpoint::LoadTensor(size_t index, bool zero_copy, bool requires_grad) const {
+  const CheckpointTensor &kRecord = tensors_[index];
+  Dims shape(kRecord.shape, kRecord.shape + kRecord.num_dims);
+  size_t size = 1;
+  for (auto &s : shape)
+    size *= s;
+  auto *elements = reinterpret_cast<Scalar *>(static_cast<char *>(mapping_.get()) + header_->data_offset
+                                              + kRecord.offset);
+  if (!zero_copy)
+    return Tensor(MakeTensor(Buffer(elements, elements + size), std::move(shape), requires_grad, true));
+
+  // The storage keeps the mapping alive as long as the tensor (or a view of it) exists
+  Dims strides = InternalTensor::ContiguousStrides(shape);
+  return Tensor(MakeTensor(std::make_shared<Storage>(elements, size, mapping_), 0, std::move(shape),
+                           std::move(strides), requires_grad, true));
+}
+
+bool Checkpoint::LoadModules(const CheckpointModule *&record, size_t count, size_t &tensor, bool zero_copy,
+                             Sequential &model) const {
+  const CheckpointModule *kEnd = modules_ + header_->num_modules;
+  for (size_t m = 0; m < count; m++) {
+    if (record == kEnd)
+      return false;
+    const CheckpointModule kModule = *record++;
+    if (kModule.kind == CheckpointModule::kSequential) {
+      Sequential child;
+      if (!LoadModules(record, kModule.num_children, tensor, zero_copy, child))
+        return false;
+      model.AddModule<Sequential>(std::move(child));
+    } else if (kModule.kind == CheckpointModule::kRelu) {
+      model.AddModule<ReLU>(kModule.leaky);
+    } else if (kModule.kind == CheckpointModule::kLinear) {
+      // The parameters must have the shapes of the layer
+      const size_t kNumTensors = kModule.has_bias ? 2 : 1;
+      if (tensor + kNumTensors > header_->num_model_tensors)
+        return false;
+      const CheckpointTensor &kWeight = tensors_[tensor], &kBias = tensors_[tensor + kNumTensors - 1];
+      if (kWeight.num_dims != 2 || kWeight.shape[0] != kModule.in_features || kWeight.shape[1] != kModule.out_features
+          || (kModule.has_bias && (kBias.num_dims != 1 || kBias.shape[0] != kModule.out_features)))
+        return false;
+      Tensor weight = LoadTensor(tensor++, zero_copy, true);
+      Tensor bias = kModule.has_bias ? LoadTensor(tensor++, zero_copy, true) : Tensor();
+      model.AddModule<LinearLayer>(std::move(weight), std::move(bias), kModule.has_bias != 0);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}
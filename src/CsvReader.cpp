@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CsvReader.hpp"
+#include "ThreadPool.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+// Smallest piece of a file parsed by one task of ReadCsv, and number of lines per task of CsvStream
+constexpr size_t kMinChunkBytes = 1 << 20;
+constexpr size_t kLinesGrain = 1024;
+
+const char *LineEnd(const char *begin, const char *end) {
+  const void *kNewline = std::memchr(begin, '\n', end - begin);
+  return kNewline ? static_cast<const char *>(kNewline) : end;
+}
+
+// Calls fn(line_begin, line_end) for every non-empty line in [begin, end), without its line end
+template<typename F>
+void ForEachLine(const char *begin, const char *end, F &&fn) {
+  while (begin < end) {
+    const char *kEnd = LineEnd(begin, end);
+    const char *kLast = kEnd > begin && kEnd[-1] == '\r' ? kEnd - 1 : kEnd;
+    if (kLast > begin)
+      fn(begin, kLast);
+    begin = kEnd + 1;
+  }
+}
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t';
+}
+
+bool ParseField(const char *begin, const char *end, Scalar &value) {
+  while (begin < end && IsSpace(*begin))
+    begin++;
+  while (end > begin && IsSpace(end[-1]))
+    end--;
+  if (begin < end && *begin == '+')  // not accepted by from_chars
+    begin++;
+  const auto kResult = std::from_chars(begin, end, value);
+  return kResult.ec == std::errc() && kResult.ptr == end && begin < end;
+}
+
+// Column layout of a file - the position of every column in a row of x and of y (-1 if it is not selected)
+struct Layout {
+  std::vector<int> x_slot;
+  std::vector<int> y_slot;
+  size_t num_features = 0;
+  size_t num_targets = 0;
+};
+
+// Builds the layout of a file whose first line is [begin, end) - returns false if a selected column does not exist
+bool MakeLayout(const char *begin, const char *end, const CsvOptions &options, Layout &layout) {
+  const size_t kNumColumns = std::count(begin, end, options.delimiter) + 1;
+  layout.x_slot.assign(kNumColumns, -1);
+  layout.y_slot.assign(kNumColumns, -1);
+  for (auto &column : options.target_columns) {
+    if (column >= kNumColumns || layout.y_slot[column] >= 0)
+      return false;
+    layout.y_slot[column] = layout.num_targets++;
+  }
+  if (options.feature_columns.empty()) {
+    for (size_t column = 0; column < kNumColumns; column++)
+      if (layout.y_slot[column] < 0)
+        layout.x_slot[column] = layout.num_features++;
+  } else {
+    for (auto &column : options.feature_columns) {
+      if (column >= kNumColumns || layout.x_slot[column] >= 0)
+        return false;
+      layout.x_slot[column] = layout.num_features++;
+    }
+  }
+  return true;
+}
+
+// Parses the selected fields of a line into its rows of x and y - returns false if the line is malformed.
+// Fields of columns that are not selected are skipped without being parsed, so they may hold anything.
+bool ParseLine(const char *begin, const char *end, char delimiter, const std::vector<int> &x_slot,
+               const std::vector<int> &y_slot, Scalar *x_row, Scalar *y_row) {
+  size_t column = 0;
+  for (const char *field = begin;; column++) {
+    const void *kDelimiter = std::memchr(field, delimiter, end - field);
+    const char *kFieldEnd = kDelimiter ? static_cast<const char *>(kDelimiter) : end;
+    if (column >= x_slot.size())
+      return false;
+    const int kX = x_slot[column], kY = y_slot[column];
+    if (kX >= 0 || kY >= 0) {
+      Scalar value;
+      if (!ParseField(field, kFieldEnd, value))
+        return false;
+      if (kX >= 0)
+        x_row[kX] = value;
+      if (kY >= 0)
+        y_row[kY] = value;
+    }
+    if (kFieldEnd == end)
+      break;
+    field = kFieldEnd + 1;
+  }
+  return column + 1 == x_slot.size();
+}
+
+// Tensor of rows x cols elements stored in storage
+Tensor RowsTensor(const SharedStorage &storage, size_t rows, size_t cols) {
+  Dims shape = {rows, cols};
+  Dims strides = InternalTensor::ContiguousStrides(shape);
+  return Tensor(MakeTensor(storage, 0, std::move(shape), std::move(strides)));
+}
+
+}
+
+// ReadCsv - the file is mapped and cut into chunks at line boundaries. A first parallel pass counts the rows
+// of every chunk, which gives the first row of each chunk, and a second one parses them in place.
+
+bool ReadCsv(const std::string &path, const CsvOptions &options, Tensor &x, Tensor &y) {
+  const int kFd = open(path.c_str(), O_RDONLY);
+  if (kFd < 0)
+    return false;
+  struct stat st = {};
+  const size_t kSize = fstat(kFd, &st) == 0 ? st.st_size : 0;
+  void *mapping = kSize > 0 ? mmap(nullptr, kSize, PROT_READ, MAP_PRIVATE, kFd, 0) : MAP_FAILED;
+  close(kFd);
+  if (mapping == MAP_FAILED)
+    return false;
+  std::shared_ptr<void> owner(mapping, [kSize](void *p) { munmap(p, kSize); });
+  madvise(mapping, kSize, MADV_SEQUENTIAL);
+
+  const char *text = static_cast<const char *>(mapping), *end = text + kSize;
+  const char *kFirstLineEnd = LineEnd(text, end);
+  Layout layout;
+  if (!MakeLayout(text, kFirstLineEnd, options, layout))
+    return false;
+  const char *begin = options.header ? std::min(kFirstLineEnd + 1, end) : text;
+
+  const size_t kNumChunks = std::max<size_t>(1, std::min((end - begin) / kMinChunkBytes, 4 * GetNumThreads()));
+  std::vector<const char *> bounds(kNumChunks + 1, end);
+  bounds[0] = begin;
+  for (size_t c = 1; c < kNumChunks; c++) {
+    const char *kEnd = LineEnd(std::max(bounds[c - 1], begin + c * (end - begin) / kNumChunks), end);
+    bounds[c] = std::min(kEnd + 1, end);
+  }
+
+  std::vector<size_t> first_row(kNumChunks + 1, 0);
+  ParallelFor(0, kNumChunks, 1, [&](size_t chunk_begin, size_t chunk_end) {
+    for (size_t c = chunk_begin; c < chunk_end; c++)
+      ForEachLine(bounds[c], bounds[c + 1], [&](const char *, const char *) { first_row[c + 1]++; });
+  });
+  for (size_t c = 0; c < kNumChunks; c++)
+    first_row[c + 1] += first_row[c];
+
+  const size_t kRows = first_row[kNumChunks];
+  auto x_storage = std::make_shared<Storage>(Buffer(kRows * layout.num_features));
+  auto y_storage = std::make_shared<Storage>(Buffer(kRows * layout.num_targets));
+  std::atomic<bool> failed{false};
+  ParallelFor(0, kNumChunks, 1, [&](size_t chunk_begin, size_t chunk_end) {
+    for (size_t c = chunk_begin; c < chunk_end; c++) {
+      size_t row = first_row[c];
+      ForEachLine(bounds[c], bounds[c + 1], [&](const char *line_begin, const char *line_end) {
+        if (!ParseLine(line_begin, line_end, options.delimiter, layout.x_slot, layout.y_slot,
+                       x_storage->Data() + row * layout.num_features, y_storage->Data() + row * layout.num_targets))
+          failed = true;
+        row++;
+      });
+    }
+  });
+  if (failed)
+    return false;
+
+  x = RowsTensor(x_storage, kRows, layout.num_features);
+  if (layout.num_targets > 0)
+    y = RowsTensor(y_storage, kRows, layout.num_targets);
+  return true;
+}
+
+// CsvStream - Constructor
+
+CsvStream::CsvStream(const std::string &path, CsvOptions options, size_t batch_rows, size_t chunk_bytes)
+    : file_(path, std::ios::binary), options_(std::move(options)), batch_rows_(std::max<size_t>(1, batch_rows)),
+      chunk_bytes_(std::max<size_t>(1, chunk_bytes)) {
+  if (!file_.is_open())
+    return;
+  // The layout comes from the first line, read in full
+  while ((text_.empty() || std::memchr(text_.data(), '\n', text_.size()) == nullptr) && Refill()) {}
+  const char *kBegin = text_.data(), *kFirstLineEnd = LineEnd(kBegin, kBegin + text_.size());
+  Layout layout;
+  if (text_.empty() || !MakeLayout(kBegin, kFirstLineEnd, options_, layout))
+    return;
+  x_slot_ = std::move(layout.x_slot);
+  y_slot_ = std::move(layout.y_slot);
+  num_features_ = layout.num_features;
+  num_targets_ = layout.num_targets;
+  if (options_.header)
+    text_begin_ = std::min<size_t>(kFirstLineEnd + 1 - kBegin, text_.size());
+  is_open_ = true;
+}
+
+// CsvStream - Reading
+
+bool CsvStream::Next(Tensor &x, Tensor &y) {
+  if (!is_open_ || failed_)
+    return false;
+  // Releases the previous batch, so that its buffers can be reused
+  x = Tensor();
+  y = Tensor();
+
+  // Lines are collected until the batch is full; more text is only appended meanwhile, so the offsets stay valid
+  text_.erase(text_.begin(), text_.begin() + text_begin_);
+  lines_.clear();
+  size_t pos = 0;
+  while (lines_.size() < batch_rows_) {
+    const char *kText = text_.data();
+    const void *kNewline = std::memchr(kText + pos, '\n', text_.size() - pos);
+    if (!kNewline && Refill())
+      continue;
+    if (!kNewline && pos == text_.size())
+      break;
+    const size_t kEnd = kNewline ? static_cast<const char *>(kNewline) - kText : text_.size();
+    const size_t kLast = kEnd > pos && kText[kEnd - 1] == '\r' ? kEnd - 1 : kEnd;
+    if (kLast > pos)
+      lines_.emplace_back(pos, kLast);
+    pos = std::min(kEnd + 1, text_.size());
+  }
+  text_begin_ = pos;
+  if (lines_.empty())
+    return false;
+
+  const size_t kRows = lines_.size();
+  // A buffer still referenced elsewhere (e.g. by a batch the caller kept) is left alone
+  if (!x_storage_ || x_storage_.use_count() > 1 || x_storage_->Size() != kRows * num_features_)
+    x_storage_ = std::make_shared<Storage>(Buffer(kRows * num_features_));
+  if (!y_storage_ || y_storage_.use_count() > 1 || y_storage_->Size() != kRows * num_targets_)
+    y_storage_ = std::make_shared<Storage>(Buffer(kRows * num_targets_));
+
+  std::atomic<bool> failed{false};
+  ParallelFor(0, kRows, kLinesGrain, [&](size_t row_begin, size_t row_end) {
+    for (size_t row = row_begin; row < row_end; row++)
+      if (!ParseLine(text_.data() + lines_[row].first, text_.data() + lines_[row].second, options_.delimiter,
+                     x_slot_, y_slot_, x_storage_->Data() + row * num_features_, y_storage_->Data() + row * num_targets_))
+        failed = true;
+  });
+  if (failed) {
+    failed_ = true;
+    return false;
+  }
+
+  x = RowsTensor(x_storage_, kRows, num_features_);
+  if (num_targets_ > 0)
+    y = RowsTensor(y_storage_, kRows, num_targets_);
+  return true;
+}
+
+bool CsvStream::Refill() {
+  const size_t kOld = text_.size();
+  text_.resize(kOld + chunk_bytes_);
+  file_.read(text_.data() + kOld, chunk_bytes_);
+  text_.resize(kOld + file_.gcount());
+  return file_.gcount() > 0;
+}
+
+}
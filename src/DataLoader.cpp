@@ -1,19 +1,134 @@
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
 #include <random>
+#include <thread>
+#include <tuple>
 
 #include "DataLoader.hpp"
 #include "Tensor.hpp"
 
 namespace cpp_tensor {
 
+// Prefetcher - N worker threads assembling the batches of one epoch ahead of the training loop.
+// Batch k holds the rows indices[k * batch_size, (k + 1) * batch_size) and is written to slot k % depth;
+// a worker may start on batch k only once batch k - depth has been taken, which bounds the queue.
+// The training loop takes the batches strictly in order, so the result does not depend on which worker
+// assembled which batch, nor on the number of workers.
+// The prefetcher keeps the data and the order of its epoch, so it does not depend on the loader, which may
+// start a new epoch while an iterator of this one is still in use. Buffers pass from the workers to the
+// iterator with Take, and come back with Return once the iterator has released the batch.
+
+class DataLoader::Prefetcher {
+ public:
+  Prefetcher(const DataLoader &loader, size_t num_workers, size_t depth);
+  ~Prefetcher();
+
+  // Waits for the batch and hands over its buffers
+  std::pair<SharedStorage, SharedStorage> Take(size_t batch);
+  // Gives back buffers that are no longer referenced, to be reused by a later batch
+  void Return(SharedStorage x, SharedStorage y);
+
+ private:
+  struct Slot {
+    SharedStorage x, y;
+    size_t batch = 0;
+    bool ready = false;
+  };
+
+  void WorkerLoop();
+
+  const Tensor x_;
+  const Tensor y_;
+  const std::vector<int> indices_;
+  const size_t batch_size_;
+  const size_t num_batches_;  // in the epoch
+  std::vector<Slot> slots_;
+  std::vector<std::pair<SharedStorage, SharedStorage>> free_buffers_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  std::condition_variable space_cv_;
+  size_t next_batch_ = 0;  // the next batch to be assembled
+  size_t taken_ = 0;       // the number of batches taken by the training loop
+  bool stop_ = false;
+};
+
+DataLoader::Prefetcher::Prefetcher(const DataLoader &loader, size_t num_workers, size_t depth)
+    : x_(loader.x_), y_(loader.y_), indices_(loader.indices_), batch_size_(loader.batch_size_),
+      num_batches_((loader.size_ + loader.batch_size_ - 1) / loader.batch_size_), slots_(depth) {
+  // Pending tensors are evaluated here, not concurrently by the workers
+  x_.GetTensor()->DataPtr();
+  y_.GetTensor()->DataPtr();
+  for (size_t i = 0; i < num_workers; i++)
+    workers_.emplace_back([this] { WorkerLoop(); });
+}
+
+DataLoader::Prefetcher::~Prefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  space_cv_.notify_all();
+  for (auto &worker : workers_)
+    worker.join();
+}
+
+std::pair<SharedStorage, SharedStorage> DataLoader::Prefetcher::Take(size_t batch) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Slot &slot = slots_[batch % slots_.size()];
+  ready_cv_.wait(lock, [&] { return slot.ready && slot.batch == batch; });
+  slot.ready = false;
+  taken_ = batch + 1;
+  space_cv_.notify_all();
+  return {std::move(slot.x), std::move(slot.y)};
+}
+
+void DataLoader::Prefetcher::Return(SharedStorage x, SharedStorage y) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_buffers_.emplace_back(std::move(x), std::move(y));
+}
+
+void DataLoader::Prefetcher::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    space_cv_.wait(lock, [&] { return stop_ || next_batch_ >= num_batches_ || next_batch_ < taken_ + slots_.size(); });
+    if (stop_ || next_batch_ >= num_batches_)
+      return;
+
+    // The rows are copied into returned buffers (if any) without holding the lock
+    const size_t kBatch = next_batch_++;
+    Slot &slot = slots_[kBatch % slots_.size()];
+    SharedStorage x, y;
+    if (!free_buffers_.empty()) {
+      std::tie(x, y) = std::move(free_buffers_.back());
+      free_buffers_.pop_back();
+    }
+    lock.unlock();
+
+    const size_t kBegin = kBatch * batch_size_;
+    const size_t kCount = std::min(batch_size_, indices_.size() - kBegin);
+    GatherRows(x_, indices_.data() + kBegin, kCount, x);
+    GatherRows(y_, indices_.data() + kBegin, kCount, y);
+
+    lock.lock();
+    slot.x = std::move(x);
+    slot.y = std::move(y);
+    slot.batch = kBatch;
+    slot.ready = true;
+    ready_cv_.notify_all();
+  }
+}
+
 // Iterator - Constructors
 
 DataLoader::Iterator::Iterator(std::vector<int>::iterator it,
                                std::vector<int>::iterator end,
                                const Tensor &x,
                                const Tensor &y,
-                               int batch_size) :
-    it_(it), end_(end), x_(x), y_(y), batch_size_(batch_size) {
+                               int batch_size,
+                               std::shared_ptr<Prefetcher> prefetcher) :
+    it_(it), end_(end), x_(x), y_(y), prefetcher_(std::move(prefetcher)), batch_size_(batch_size) {
   batch_processed_ = false;
   LoadBatch();
 }
@@ -43,32 +158,73 @@ DataLoader::Iterator &DataLoader::Iterator::operator++() {
 }
 
 // Iterator - Helper function to load a new batch of Data
+// The selected rows are copied straight from x_ and y_ into the batch buffers, in a single pass
+// (or taken from the prefetcher, which has done the same in the background).
 
 void DataLoader::Iterator::LoadBatch() {
-  std::vector<Tensor> x_batch;
-  std::vector<Tensor> y_batch;
-  for (int i = 0; i < batch_size_ && it_ != end_; i++, it_++) {
-    x_batch.push_back(x_.ValueTensor({*it_}));
-    y_batch.push_back(y_.ValueTensor({*it_}));
+  const size_t kCount = std::min<size_t>(batch_size_, end_ - it_);
+  ReleaseBatch();
+  if (prefetcher_) {
+    std::tie(x_storage_, y_storage_) = prefetcher_->Take(batch_index_++);
+  } else {
+    GatherRows(x_, &*it_, kCount, x_storage_);
+    GatherRows(y_, &*it_, kCount, y_storage_);
   }
+  batch_ = std::make_pair(BatchTensor(x_, kCount, x_storage_), BatchTensor(y_, kCount, y_storage_));
+  it_ += kCount;
+}
 
-  batch_ = std::make_pair(Tensor::Concat(x_batch), Tensor::Concat(y_batch));
+void DataLoader::Iterator::ReleaseBatch() {
+  batch_ = {};
+  // Only the iterator creates references to its buffers, so a count of 1 means that no one else can use them
+  if (x_storage_.use_count() > 1)
+    x_storage_ = nullptr;
+  if (y_storage_.use_count() > 1)
+    y_storage_ = nullptr;
+  if (prefetcher_) {
+    if (x_storage_ && y_storage_)
+      prefetcher_->Return(std::move(x_storage_), std::move(y_storage_));
+    x_storage_ = nullptr;
+    y_storage_ = nullptr;
+  }
 }
 
-// DataLoader - Constructor
+// DataLoader - Constructor and destructor
 
 DataLoader::DataLoader(const Tensor &x, const Tensor &y, int batch_size, bool shuffle)
-    : x_(x), y_(y), batch_size_(batch_size), shuffle_(shuffle) {
+    : x_(x), y_(y), batch_size_(batch_size), shuffle_(shuffle), mt_(std::random_device()()) {
   size_ = x.Shape(0);
   for (int i = 0; i < size_; i++)
     indices_.push_back(i);
 }
 
+DataLoader::~DataLoader() = default;
+
+// DataLoader - Options
+
+void DataLoader::SetPrefetch(size_t num_workers, size_t depth) {
+  prefetcher_ = nullptr;
+  num_workers_ = num_workers;
+  prefetch_depth_ = std::max<size_t>(1, depth);
+}
+
+void DataLoader::SetBlockShuffle(size_t block_size, size_t window_size) {
+  block_size_ = block_size;
+  window_size_ = std::max<size_t>(1, window_size);
+}
+
 // DataLoader - Iterator functions (used automatically by c++ for loop)
 
 DataLoader::Iterator DataLoader::begin() {
+  // An empty dataset has no batches (and nothing to prefetch)
+  if (size_ == 0)
+    return end();
+  // The workers of the previous epoch (which have their own copy of the indices) stop once no iterator uses them
+  prefetcher_ = nullptr;
   ShuffleIndices();
-  return Iterator(indices_.begin(), indices_.end(), x_, y_, batch_size_);
+  if (num_workers_ > 0)
+    prefetcher_ = std::make_shared<Prefetcher>(*this, num_workers_, prefetch_depth_);
+  return Iterator(indices_.begin(), indices_.end(), x_, y_, batch_size_, prefetcher_);
 }
 
 DataLoader::Iterator DataLoader::end() {
@@ -78,11 +234,43 @@ DataLoader::Iterator DataLoader::end() {
 // DataLoader - Helper function to shuffle (if shuffle_ == true) the indices
 
 void DataLoader::ShuffleIndices() {
-  if (shuffle_) {
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::shuffle(indices_.begin(), indices_.end(), mt);
+  if (!shuffle_)
+    return;
+  if (block_size_ == 0) {
+    std::shuffle(indices_.begin(), indices_.end(), mt_);
+    return;
   }
+
+  // Blocks in random order, each one in its original row order (the last block may be shorter)
+  std::vector<size_t> blocks((size_ + block_size_ - 1) / block_size_);
+  for (size_t b = 0; b < blocks.size(); b++)
+    blocks[b] = b;
+  std::shuffle(blocks.begin(), blocks.end(), mt_);
+  auto it = indices_.begin();
+  for (auto &block : blocks)
+    for (size_t row = block * block_size_; row < std::min(size_, (block + 1) * block_size_); row++)
+      *it++ = row;
+
+  // Rows mixed within windows
+  for (size_t begin = 0; begin < size_; begin += window_size_)
+    std::shuffle(indices_.begin() + begin, indices_.begin() + std::min(size_, begin + window_size_), mt_);
+}
+
+// DataLoader - Helper functions to assemble batches
+
+void DataLoader::GatherRows(const Tensor &source, const int *indices, size_t count, SharedStorage &storage) {
+  const size_t kSize = count * (source.Size() / source.Shape(0));
+  if (!storage || storage->Size() != kSize)
+    storage = std::make_shared<Storage>(Buffer(kSize));
+  GatherRowsInternal(source.GetTensor(), indices, count, storage->Data());
+}
+
+Tensor DataLoader::BatchTensor(const Tensor &source, size_t count, const SharedStorage &storage) {
+  Dims shape = {count};
+  for (size_t d = 1; d < source.NumDimensions(); d++)
+    shape.push_back(source.Shape(d));
+  Dims strides = InternalTensor::ContiguousStrides(shape);
+  return Tensor(MakeTensor(storage, 0, std::move(shape), std::move(strides)));
 }
 
 }
\ No newline at end of file
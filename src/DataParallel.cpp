@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "DataParallel.hpp"
+#include "ThreadPool.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+// Elements of the arenas reduced by one task (a multiple of a cache line)
+constexpr size_t kReduceChunk = 1 << 14;
+
+}
+
+// Constructor
+
+DataParallelTrainer::DataParallelTrainer(Sequential &model,
+                                         size_t num_replicas,
+                                         const MakeOptimizer &make_optimizer) {
+  replicas_.push_back(&model);
+  arenas_.emplace_back(model.Parameters());
+  for (size_t r = 1; r < num_replicas; r++) {
+    clones_.push_back(model.Clone());
+    if (!clones_.back()) {
+      replicas_.clear();
+      clones_.clear();
+      arenas_.clear();
+      return;
+    }
+    replicas_.push_back(clones_.back().get());
+    arenas_.emplace_back(clones_.back()->Parameters());
+  }
+  for (auto &arena : arenas_)
+    optimizers_.push_back(make_optimizer(arena));
+}
+
+// Training
+
+Scalar DataParallelTrainer::Step(const Tensor &x, const Tensor &y, const Loss &loss) {
+  if (!IsValid())
+    return 0;
+  // Replica r trains on rows [r * rows / n, (r + 1) * rows / n) - none if the batch has fewer rows than replicas
+  const size_t kReplicas = replicas_.size(), kRows = x.Shape(0);
+  std::vector<Scalar> weights(kReplicas), losses(kReplicas);
+  ThreadPool::Global()->Run(kReplicas, [&](size_t r) {
+    const size_t kBegin = r * kRows / kReplicas, kEnd = (r + 1) * kRows / kReplicas;
+    optimizers_[r]->ZeroGrad();
+    if (kBegin == kEnd)
+      return;
+    Tensor res = loss((*replicas_[r])(x.Slice(0, kBegin, kEnd)), y.Slice(0, kBegin, kEnd));
+    res.Backward();
+    weights[r] = static_cast<Scalar>(kEnd - kBegin) / kRows;
+    losses[r] = res.Value();
+  });
+
+  AllReduce(weights);
+  ThreadPool::Global()->Run(kReplicas, [&](size_t r) { optimizers_[r]->Step(); });
+
+  Scalar res = 0;
+  for (size_t r = 0; r < kReplicas; r++)
+    res += weights[r] * losses[r];
+  return res;
+}
+
+// Helper function
+
+void DataParallelTrainer::AllReduce(const std::vector<Scalar> &weights) {
+  const size_t kSize = arenas_[0].Size();
+  const size_t kChunks = (kSize + kReduceChunk - 1) / kReduceChunk;
+  ThreadPool::Global()->Run(kChunks, [&](size_t chunk) {
+    const size_t kBegin = chunk * kReduceChunk, kEnd = std::min(kSize, kBegin + kReduceChunk);
+    Scalar *sum = arenas_[0].Grad();
+    for (size_t i = kBegin; i < kEnd; i++)
+      sum[i] *= weights[0];
+    for (size_t r = 1; r < arenas_.size(); r++) {
+      const Scalar *kGrad = arenas_[r].Grad();
+      for (size_t i = kBegin; i < kEnd; i++)
+        sum[i] += weights[r] * kGrad[i];
+    }
+    for (size_t r = 1; r < arenas_.size(); r++)
+      std::copy(sum + kBegin, sum + kEnd, arenas_[r].Grad() + kBegin);
+  });
+}
+
+}
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <numeric>
+
+#include "Fusion.hpp"
+#include "ThreadPool.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+// Number of elements processed at a time - all values of a tile stay in the cache
+const size_t kFusedTile = 256;
+
+// Gradient sums of the broadcast inputs (accumulated in double precision), in cached buffers
+using PartialSums = std::vector<double, BufferAllocator<double>>;
+
+// Per-thread scratch space for the values (and gradients) of a tile
+Scalar *TileBuffer(size_t size) {
+  thread_local std::vector<Scalar> buffer;
+  if (buffer.size() < size)
+    buffer.resize(size);
+  return buffer.data();
+}
+
+// Computes all values of the program for the elements [begin, begin + count).
+// values[k] points to value k: full-size inputs are read in place, everything else is stored in buf.
+void EvaluateTile(const FusedProgram &program, size_t begin, size_t count, Scalar *buf, const Scalar **values) {
+  for (int k = 0; k < program.NumValues(); k++) {
+    const FusedInstruction &kIns = program.instructions[k];
+    const Scalar *x = values[kIns.lhs], *y = values[kIns.rhs];
+    Scalar *out = buf + k * kFusedTile;
+    values[k] = out;
+
+    switch (kIns.op) {
+      case FusedOp::kLoad: {
+        const SharedTensor &kInput = program.inputs[kIns.lhs];
+        const Scalar *data = kInput->DataPtr();
+        const size_t kSize = kInput->Size();
+        if (kSize == program.size) {
+          values[k] = data + begin;
+        } else {
+          for (size_t i = 0, j = begin % kSize; i < count; i++, j = j + 1 == kSize ? 0 : j + 1)
+            out[i] = data[j];
+        }
+        break;
+      }
+      case FusedOp::kAdd:
+        for (size_t i = 0; i < count; i++)
+          out[i] = x[i] + y[i];
+        break;
+      case FusedOp::kMultiply:
+        for (size_t i = 0; i < count; i++)
+          out[i] = x[i] * y[i];
+        break;
+      case FusedOp::kScale:
+        for (size_t i = 0; i < count; i++)
+          out[i] = x[i] * kIns.constant;
+        break;
+      case FusedOp::kPow:
+        for (size_t i = 0; i < count; i++)
+          out[i] = IntegerPow(x[i], kIns.exponent);
+        break;
+      case FusedOp::kRelu:
+        for (size_t i = 0; i < count; i++)
+          out[i] = x[i] < 0 ? x[i] * kIns.constant : x[i];
+        break;
+    }
+  }
+}
+
+// Returns the value of the input a in the program, adding a load if needed
+int AddInput(FusedProgram &program, const SharedTensor &a) {
+  for (int k = 0; k < program.NumValues(); k++)
+    if (program.instructions[k].op == FusedOp::kLoad && program.inputs[program.instructions[k].lhs] == a)
+      return k;
+
+  const int kInput = program.inputs.size();
+  program.inputs.push_back(a);
+  program.instructions.push_back({FusedOp::kLoad, kInput, kInput, 1, 1});
+  return program.NumValues() - 1;
+}
+
+// Returns the value of the operand a in the program. A pending elementwise tensor is inlined
+// (its instructions are copied into the program), anything else becomes an input -
+// so pending reductions are materialized and views that are not contiguous are copied.
+// A chain recorded without gradients is materialized as a constant when gradients are enabled now,
+// otherwise the gradient would flow back through its operations.
+int AddOperand(FusedProgram &program, const SharedTensor &a) {
+  const FusedProgram *kSource = a->Program();
+  // (The limit leaves room for the other operand and the operation itself)
+  if (!kSource || kSource->reduce || (!kSource->use_grad && InternalTensor::use_grad_)
+      || program.NumValues() + kSource->NumValues() + 3 > kMaxFusedValues)
+    return AddInput(program, ContiguousInternal(a));
+
+  PoolVector<int> values(kSource->NumValues());
+  for (int k = 0; k < kSource->NumValues(); k++) {
+    FusedInstruction ins = kSource->instructions[k];
+    if (ins.op == FusedOp::kLoad) {
+      values[k] = AddInput(program, kSource->inputs[ins.lhs]);
+    } else {
+      ins.lhs = values[ins.lhs];
+      ins.rhs = values[ins.rhs];
+      program.instructions.push_back(ins);
+      values[k] = program.NumValues() - 1;
+    }
+  }
+  return values.back();
+}
+
+// Creates the pending tensor computed by the program
+SharedTensor MakePending(const std::shared_ptr<FusedProgram> &program, Dims shape) {
+  program->use_grad = InternalTensor::use_grad_;
+  return MakeTensor(program, std::move(shape));
+}
+
+// Programs live in the graph pool, like the tensors that hold them
+std::shared_ptr<FusedProgram> MakeProgram() {
+  return std::allocate_shared<FusedProgram>(PoolAllocator<FusedProgram>());
+}
+
+}
+
+// FusedProgram - Evaluation
+
+void FusedProgram::Evaluate(Scalar *out) const {
+  ParallelFor(0, size, kGrainSize, [&](size_t begin, size_t end) {
+    Scalar *buf = TileBuffer(NumValues() * kFusedTile);
+    const Scalar *values[kMaxFusedValues] = {};
+    for (size_t t = begin; t < end; t += kFusedTile) {
+      const size_t kCount = std::min(kFusedTile, end - t);
+      EvaluateTile(*this, t, kCount, buf, values);
+      std::copy(values[NumValues() - 1], values[NumValues() - 1] + kCount, out + t);
+    }
+  });
+}
+
+double FusedProgram::Reduce() const {
+  return scale * ParallelReduce(0, size, kGrainSize, 0., [&](size_t begin, size_t end) {
+    Scalar *buf = TileBuffer(NumValues() * kFusedTile);
+    const Scalar *values[kMaxFusedValues] = {};
+    double sum = 0;
+    for (size_t t = begin; t < end; t += kFusedTile) {
+      const size_t kCount = std::min(kFusedTile, end - t);
+      EvaluateTile(*this, t, kCount, buf, values);
+      sum = std::accumulate(values[NumValues() - 1], values[NumValues() - 1] + kCount, sum);
+    }
+    return sum;
+  }, std::plus<>());
+}
+
+// FusedProgram - Backward pass
+// The forward values of each tile are recomputed and the gradient is propagated through the
+// instructions in reverse. Full-size inputs accumulate their gradient in place (each input is loaded once,
+// so a gradient created by this pass is written directly), the gradients of broadcast inputs are reduced
+// over the tiles.
+
+void FusedProgram::Backward(InternalTensor *res) const {
+  const int kValues = NumValues();
+  Dims partial_offset(inputs.size());
+  // Decided once on the calling thread - RequiresGrad depends on its grad mode, which the pool threads do not share
+  PoolVector<unsigned char> needs_grad(inputs.size(), false);
+  PoolVector<unsigned char> fresh(inputs.size(), false);
+  size_t partial_size = 0;
+  for (size_t k = 0; k < inputs.size(); k++) {
+    needs_grad[k] = inputs[k]->RequiresGrad();
+    if (!needs_grad[k])
+      continue;
+    if (inputs[k]->Size() == size) {
+      fresh[k] = inputs[k]->PrepareGrad();
+    } else {
+      partial_offset[k] = partial_size;
+      partial_size += inputs[k]->Size();
+    }
+  }
+
+  auto tiles = [&](size_t begin, size_t end) {
+    PartialSums partial(partial_size, 0.);
+    Scalar *buf = TileBuffer(2 * kValues * kFusedTile);
+    Scalar *grad = buf + kValues * kFusedTile;
+    const Scalar *values[kMaxFusedValues] = {};
+
+    for (size_t t = begin; t < end; t += kFusedTile) {
+      const size_t kCount = std::min(kFusedTile, end - t);
+      EvaluateTile(*this, t, kCount, buf, values);
+
+      std::fill(grad, grad + kValues * kFusedTile, Scalar(0));
+      Scalar *res_grad = grad + (kValues - 1) * kFusedTile;
+      if (reduce)
+        std::fill(res_grad, res_grad + kCount, res->grad_[0] * scale);
+      else
+        std::copy(res->grad_.begin() + t, res->grad_.begin() + t + kCount, res_grad);
+
+      for (int k = kValues - 1; k >= 0; k--) {
+        const FusedInstruction &kIns = instructions[k];
+        const Scalar *g = grad + k * kFusedTile, *x = values[kIns.lhs], *y = values[kIns.rhs];
+        Scalar *gx = grad + kIns.lhs * kFusedTile, *gy = grad + kIns.rhs * kFusedTile;
+
+        switch (kIns.op) {
+          case FusedOp::kLoad: {
+            const SharedTensor &kInput = inputs[kIns.lhs];
+            if (!needs_grad[kIns.lhs])
+              break;
+            const size_t kSize = kInput->Size();
+            if (kSize == size) {
+              Scalar *input_grad = kInput->grad_.data() + t;
+              if (fresh[kIns.lhs])
+                std::copy(g, g + kCount, input_grad);
+              else
+                for (size_t i = 0; i < kCount; i++)
+                  input_grad[i] += g[i];
+            } else {
+              double *input_partial = partial.data() + partial_offset[kIns.lhs];
+              for (size_t i = 0, j = t % kSize; i < kCount; i++, j = j + 1 == kSize ? 0 : j + 1)
+                input_partial[j] += g[i];
+            }
+            break;
+          }
+          case FusedOp::kAdd:
+            for (size_t i = 0; i < kCount; i++) {
+              gx[i] += g[i];
+              gy[i] += g[i];
+            }
+            break;
+          case FusedOp::kMultiply:
+            for (size_t i = 0; i < kCount; i++) {
+              gx[i] += g[i] * y[i];
+              gy[i] += g[i] * x[i];
+            }
+            break;
+          case FusedOp::kScale:
+            for (size_t i = 0; i < kCount; i++)
+              gx[i] += g[i] * kIns.constant;
+            break;
+          case FusedOp::kPow:
+            // d(x^n)/dx = n * x^(n - 1), evaluated directly so that x = 0 does not produce 0 / 0
+            for (size_t i = 0; i < kCount; i++)
+              gx[i] += g[i] * (kIns.exponent * IntegerPow(x[i], kIns.exponent - 1));
+            break;
+          case FusedOp::kRelu:
+            for (size_t i = 0; i < kCount; i++)
+              gx[i] += g[i] * (x[i] < 0 ? kIns.constant : 1);
+            break;
+        }
+      }
+    }
+    return partial;
+  };
+  auto add = [](PartialSums lhs, const PartialSums &rhs) {
+    for (size_t j = 0; j < lhs.size(); j++)
+      lhs[j] += rhs[j];
+    return lhs;
+  };
+  const PartialSums kPartial = ParallelReduce(0, size, kGrainSize, PartialSums(partial_size, 0.), tiles, add);
+
+  for (size_t k = 0; k < inputs.size(); k++)
+    if (needs_grad[k] && inputs[k]->Size() != size)
+      inputs[k]->UpdateGrad(Buffer(kPartial.begin() + partial_offset[k],
+                                                kPartial.begin() + partial_offset[k] + inputs[k]->Size()));
+}
+
+// Fused operations
+
+SharedTensor FusedBinary(FusedOp op, const SharedTensor &a, const SharedTensor &b) {
+  auto program = MakeProgram();
+  const int kLhs = AddOperand(*program, a);
+  const int kRhs = a == b ? kLhs : AddOperand(*program, b);
+  program->instructions.push_back({op, kLhs, kRhs, 1, 1});
+
+  // Like the eager operations, the smaller operand is broadcast over the trailing dimensions of the larger one
+  const bool kLargerB = b->Size() > a->Size() || (b->Size() == a->Size() && b->Shape().size() > a->Shape().size());
+  const SharedTensor &kLarger = kLargerB ? b : a;
+  program->size = kLarger->Size();
+  return MakePending(program, kLarger->Shape());
+}
+
+SharedTensor FusedUnary(FusedOp op, const SharedTensor &a, Scalar constant, int exponent) {
+  auto program = MakeProgram();
+  const int kValue = AddOperand(*program, a);
+  program->instructions.push_back({op, kValue, kValue, constant, exponent});
+  program->size = a->Size();
+  return MakePending(program, a->Shape());
+}
+
+SharedTensor FusedSum(const SharedTensor &a, Scalar scale) {
+  auto program = MakeProgram();
+  AddOperand(*program, a);
+  program->size = a->Size();
+  program->reduce = true;
+  program->scale = scale;
+  return MakePending(program, Dims());
+}
+
+}
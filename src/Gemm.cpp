@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPPTENSOR_X86 1
+#endif
+
+#include "Gemm.hpp"
+#include "ThreadPool.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+// Cache blocking parameters (in elements). A kKc x kNc block of B is packed once and reused
+// by every kMc x kKc block of A, which in turn stays in L2 while the micro-kernel sweeps it.
+constexpr size_t kMc = 96;
+constexpr size_t kKc = 256;
+constexpr size_t kNc = 2048;
+
+// Products with fewer multiply-adds than this skip packing entirely
+constexpr size_t kSmallGemm = 32 * 32 * 32;
+
+// Products with at least this many multiply-adds are split across the thread pool by blocks of A rows
+constexpr size_t kParallelGemm = 1 << 20;
+
+// Number of B micro-panels packed by one task
+constexpr size_t kPackGrain = 8;
+
+// Micro-kernel: C[0:mr, 0:nr] += A_panel * B_panel, where the A panel holds k columns of mr values
+// and the B panel holds k rows of nr values (both packed contiguously).
+template<typename T>
+struct MicroKernel {
+  const char *name;
+  size_t mr;
+  size_t nr;
+  void (*fn)(size_t k, const T *a, const T *b, T *c, size_t ldc);
+};
+
+// Largest mr * nr of any micro-kernel below (size of the edge-tile buffer)
+constexpr size_t kMaxTile = 6 * 32;
+
+// Portable scalar micro-kernel
+
+constexpr size_t kScalarMr = 4;
+constexpr size_t kScalarNr = 4;
+
+template<typename T>
+void KernelScalar(size_t k, const T *a, const T *b, T *c, size_t ldc) {
+  T acc[kScalarMr][kScalarNr] = {};
+  for (size_t p = 0; p < k; p++, a += kScalarMr, b += kScalarNr)
+    for (size_t i = 0; i < kScalarMr; i++)
+      for (size_t j = 0; j < kScalarNr; j++)
+        acc[i][j] += a[i] * b[j];
+
+  for (size_t i = 0; i < kScalarMr; i++)
+    for (size_t j = 0; j < kScalarNr; j++)
+      c[i * ldc + j] += acc[i][j];
+}
+
+#ifdef CPPTENSOR_X86
+
+// All SIMD micro-kernels compute a 6-row tile that is two vector registers wide (12 accumulators)
+constexpr size_t kSimdMr = 6;
+
+// AVX2 + FMA micro-kernels: 6 x 8 doubles or 6 x 16 floats
+
+__attribute__((target("avx2,fma")))
+void KernelAvx2(size_t k, const double *a, const double *b, double *c, size_t ldc) {
+  __m256d acc[kSimdMr][2];
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++)
+    acc[i][0] = acc[i][1] = _mm256_setzero_pd();
+
+  for (size_t p = 0; p < k; p++, a += kSimdMr, b += 8) {
+    const __m256d kB0 = _mm256_loadu_pd(b);
+    const __m256d kB1 = _mm256_loadu_pd(b + 4);
+#pragma GCC unroll 6
+    for (size_t i = 0; i < kSimdMr; i++) {
+      const __m256d kA = _mm256_broadcast_sd(a + i);
+      acc[i][0] = _mm256_fmadd_pd(kA, kB0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_pd(kA, kB1, acc[i][1]);
+    }
+  }
+
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++) {
+    double *row = c + i * ldc;
+    _mm256_storeu_pd(row, _mm256_add_pd(_mm256_loadu_pd(row), acc[i][0]));
+    _mm256_storeu_pd(row + 4, _mm256_add_pd(_mm256_loadu_pd(row + 4), acc[i][1]));
+  }
+}
+
+__attribute__((target("avx2,fma")))
+void KernelAvx2(size_t k, const float *a, const float *b, float *c, size_t ldc) {
+  __m256 acc[kSimdMr][2];
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++)
+    acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+
+  for (size_t p = 0; p < k; p++, a += kSimdMr, b += 16) {
+    const __m256 kB0 = _mm256_loadu_ps(b);
+    const __m256 kB1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 6
+    for (size_t i = 0; i < kSimdMr; i++) {
+      const __m256 kA = _mm256_broadcast_ss(a + i);
+      acc[i][0] = _mm256_fmadd_ps(kA, kB0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(kA, kB1, acc[i][1]);
+    }
+  }
+
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++) {
+    float *row = c + i * ldc;
+    _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), acc[i][0]));
+    _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[i][1]));
+  }
+}
+
+// AVX-512 micro-kernels: 6 x 16 doubles or 6 x 32 floats
+
+__attribute__((target("avx512f")))
+void KernelAvx512(size_t k, const double *a, const double *b, double *c, size_t ldc) {
+  __m512d acc[kSimdMr][2];
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++)
+    acc[i][0] = acc[i][1] = _mm512_setzero_pd();
+
+  for (size_t p = 0; p < k; p++, a += kSimdMr, b += 16) {
+    const __m512d kB0 = _mm512_loadu_pd(b);
+    const __m512d kB1 = _mm512_loadu_pd(b + 8);
+#pragma GCC unroll 6
+    for (size_t i = 0; i < kSimdMr; i++) {
+      const __m512d kA = _mm512_set1_pd(a[i]);
+      acc[i][0] = _mm512_fmadd_pd(kA, kB0, acc[i][0]);
+      acc[i][1] = _mm512_fmadd_pd(kA, kB1, acc[i][1]);
+    }
+  }
+
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++) {
+    double *row = c + i * ldc;
+    _mm512_storeu_pd(row, _mm512_add_pd(_mm512_loadu_pd(row), acc[i][0]));
+    _mm512_storeu_pd(row + 8, _mm512_add_pd(_mm512_loadu_pd(row + 8), acc[i][1]));
+  }
+}
+
+__attribute__((target("avx512f")))
+void KernelAvx512(size_t k, const float *a, const float *b, float *c, size_t ldc) {
+  __m512 acc[kSimdMr][2];
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++)
+    acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+
+  for (size_t p = 0; p < k; p++, a += kSimdMr, b += 32) {
+    const __m512 kB0 = _mm512_loadu_ps(b);
+    const __m512 kB1 = _mm512_loadu_ps(b + 16);
+#pragma GCC unroll 6
+    for (size_t i = 0; i < kSimdMr; i++) {
+      const __m512 kA = _mm512_set1_ps(a[i]);
+      acc[i][0] = _mm512_fmadd_ps(kA, kB0, acc[i][0]);
+      acc[i][1] = _mm512_fmadd_ps(kA, kB1, acc[i][1]);
+    }
+  }
+
+#pragma GCC unroll 6
+  for (size_t i = 0; i < kSimdMr; i++) {
+    float *row = c + i * ldc;
+    _mm512_storeu_ps(row, _mm512_add_ps(_mm512_loadu_ps(row), acc[i][0]));
+    _mm512_storeu_ps(row + 16, _mm512_add_ps(_mm512_loadu_ps(row + 16), acc[i][1]));
+  }
+}
+
+#endif
+
+// Runtime kernel selection - the instruction set is picked once and shared by both element types
+
+enum class Isa { kScalar, kAvx2, kAvx512 };
+
+Isa SelectedIsa() {
+  static const Isa kIsa = [] {
+    const char *forced = std::getenv("CPPTENSOR_GEMM_KERNEL");
+    if (forced && std::strcmp(forced, "scalar") == 0)
+      return Isa::kScalar;
+
+#ifdef CPPTENSOR_X86
+    const bool kAllowAvx512 = !forced || std::strcmp(forced, "avx512") == 0;
+    if (kAllowAvx512 && __builtin_cpu_supports("avx512f"))
+      return Isa::kAvx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return Isa::kAvx2;
+#endif
+
+    return Isa::kScalar;
+  }();
+  return kIsa;
+}
+
+template<typename T>
+const MicroKernel<T> &SelectedKernel() {
+  static const MicroKernel<T> kKernel = [] {
+    constexpr size_t kLanes = 32 / sizeof(T);  // elements per 256-bit register
+    switch (SelectedIsa()) {
+#ifdef CPPTENSOR_X86
+      case Isa::kAvx512:return MicroKernel<T>{"avx512", kSimdMr, 4 * kLanes, KernelAvx512};
+      case Isa::kAvx2:return MicroKernel<T>{"avx2", kSimdMr, 2 * kLanes, KernelAvx2};
+#endif
+      default:return MicroKernel<T>{"scalar", kScalarMr, kScalarNr, KernelScalar<T>};
+    }
+  }();
+  return kKernel;
+}
+
+// Packing helpers - copy a block of op(A) (scaled by alpha) or op(B) into micro-panels, padding edges with zeros.
+// Transposed operands are read in place, so the packing step is the only pass over them.
+
+template<typename T>
+void PackA(bool trans, size_t mc, size_t kc, const T *a, size_t lda, T alpha, size_t mr, T *buf) {
+  for (size_t ir = 0; ir < mc; ir += mr) {
+    const size_t kRows = std::min(mr, mc - ir);
+    for (size_t p = 0; p < kc; p++) {
+      if (trans)
+        for (size_t i = 0; i < kRows; i++)
+          buf[i] = alpha * a[p * lda + ir + i];
+      else
+        for (size_t i = 0; i < kRows; i++)
+          buf[i] = alpha * a[(ir + i) * lda + p];
+      for (size_t i = kRows; i < mr; i++)
+        buf[i] = 0;
+      buf += mr;
+    }
+  }
+}
+
+template<typename T>
+void PackB(bool trans, size_t kc, size_t nc, const T *b, size_t ldb, size_t nr, T *buf) {
+  for (size_t jr = 0; jr < nc; jr += nr) {
+    const size_t kCols = std::min(nr, nc - jr);
+    if (trans) {
+      // Each column of op(B) is a contiguous row of B
+      for (size_t j = 0; j < kCols; j++) {
+        const T *col = b + (jr + j) * ldb;
+        for (size_t p = 0; p < kc; p++)
+          buf[p * nr + j] = col[p];
+      }
+      for (size_t j = kCols; j < nr; j++)
+        for (size_t p = 0; p < kc; p++)
+          buf[p * nr + j] = 0;
+    } else {
+      for (size_t p = 0; p < kc; p++) {
+        const T *row = b + p * ldb + jr;
+        for (size_t j = 0; j < kCols; j++)
+          buf[p * nr + j] = row[j];
+        for (size_t j = kCols; j < nr; j++)
+          buf[p * nr + j] = 0;
+      }
+    }
+    buf += kc * nr;
+  }
+}
+
+// Returns a 64-byte aligned scratch buffer with room for at least size elements (one per thread, reused)
+template<typename T>
+T *Scratch(std::vector<T> &storage, size_t size) {
+  constexpr size_t kAlign = 64 / sizeof(T);
+  if (storage.size() < size + kAlign)
+    storage.resize(size + kAlign);
+  auto address = reinterpret_cast<std::uintptr_t>(storage.data());
+  return storage.data() + (kAlign - (address / sizeof(T)) % kAlign) % kAlign;
+}
+
+// C = beta * C (with beta == 0 overwriting whatever C contained)
+template<typename T>
+void ScaleC(size_t m, size_t n, T beta, T *c, size_t ldc) {
+  if (beta == 1)
+    return;
+  for (size_t i = 0; i < m; i++) {
+    T *row = c + i * ldc;
+    if (beta == 0)
+      std::fill(row, row + n, T(0));
+    else
+      for (size_t j = 0; j < n; j++)
+        row[j] *= beta;
+  }
+}
+
+// Unpacked loops for small products, where packing costs more than it saves.
+// The loop order is picked so that the innermost loop walks memory with unit stride where possible.
+template<typename T>
+void GemmSmall(bool trans_a, bool trans_b, size_t m, size_t n, size_t k,
+               T alpha, const T *a, size_t lda,
+               const T *b, size_t ldb,
+               T *c, size_t ldc) {
+  for (size_t i = 0; i < m; i++) {
+    T *c_row = c + i * ldc;
+    if (trans_b) {
+      // C[i][j] += dot(op(A) row i, B row j)
+      for (size_t j = 0; j < n; j++) {
+        const T *b_row = b + j * ldb;
+        T sum = 0;
+        if (trans_a)
+          for (size_t p = 0; p < k; p++)
+            sum += a[p * lda + i] * b_row[p];
+        else
+          for (size_t p = 0; p < k; p++)
+            sum += a[i * lda + p] * b_row[p];
+        c_row[j] += alpha * sum;
+      }
+    } else {
+      for (size_t p = 0; p < k; p++) {
+        const T kA = alpha * (trans_a ? a[p * lda + i] : a[i * lda + p]);
+        const T *b_row = b + p * ldb;
+        for (size_t j = 0; j < n; j++)
+          c_row[j] += kA * b_row[j];
+      }
+    }
+  }
+}
+
+// Multiplies a packed mc x kc block of A by a packed kc x nc block of B into C, one micro-tile at a time
+template<typename T>
+void MacroKernel(const MicroKernel<T> &kernel, size_t mc, size_t nc, size_t kc,
+                 const T *packed_a, const T *packed_b, T *c, size_t ldc) {
+  const size_t kMr = kernel.mr, kNr = kernel.nr;
+  T tile[kMaxTile];
+
+  for (size_t jr = 0; jr < nc; jr += kNr) {
+    const size_t kCols = std::min(kNr, nc - jr);
+    const T *panel_b = packed_b + jr * kc;
+
+    for (size_t ir = 0; ir < mc; ir += kMr) {
+      const size_t kRows = std::min(kMr, mc - ir);
+      const T *panel_a = packed_a + ir * kc;
+      T *c_tile = c + ir * ldc + jr;
+
+      if (kRows == kMr && kCols == kNr) {
+        kernel.fn(kc, panel_a, panel_b, c_tile, ldc);
+      } else {
+        // Edge tile - compute into a full-size buffer and add back only the valid part
+        std::fill(tile, tile + kMr * kNr, T(0));
+        kernel.fn(kc, panel_a, panel_b, tile, kNr);
+        for (size_t i = 0; i < kRows; i++)
+          for (size_t j = 0; j < kCols; j++)
+            c_tile[i * ldc + j] += tile[i * kNr + j];
+      }
+    }
+  }
+}
+
+template<typename T>
+void GemmImpl(bool trans_a, bool trans_b,
+              size_t m, size_t n, size_t k,
+              T alpha, const T *a, size_t lda,
+              const T *b, size_t ldb,
+              T beta, T *c, size_t ldc) {
+  if (m == 0 || n == 0)
+    return;
+
+  ScaleC(m, n, beta, c, ldc);
+  if (k == 0 || alpha == 0)
+    return;
+
+  if (m * n * k <= kSmallGemm) {
+    GemmSmall(trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    return;
+  }
+
+  const MicroKernel<T> &kKernel = SelectedKernel<T>();
+  const size_t kMr = kKernel.mr, kNr = kKernel.nr;
+
+  // The packed B block is shared by all threads, while each thread packs its own blocks of A
+  thread_local std::vector<T> b_storage;
+  T *packed_b = Scratch(b_storage, (kNc + kNr) * kKc);
+  const size_t kNumBlocks = (m + kMc - 1) / kMc;
+  const bool kParallel = m * n * k >= kParallelGemm;
+  const size_t kBlockGrain = kParallel ? 1 : kNumBlocks;
+
+  for (size_t jc = 0; jc < n; jc += kNc) {
+    const size_t kNcCur = std::min(kNc, n - jc);
+    const size_t kNumPanels = (kNcCur + kNr - 1) / kNr;
+    const size_t kPanelGrain = kParallel ? kPackGrain : kNumPanels;
+
+    for (size_t pc = 0; pc < k; pc += kKc) {
+      const size_t kKcCur = std::min(kKc, k - pc);
+
+      ParallelFor(0, kNumPanels, kPanelGrain, [&](size_t first, size_t last) {
+        const size_t kCol = jc + first * kNr;
+        const size_t kCols = std::min(kNcCur, last * kNr) - first * kNr;
+        PackB(trans_b, kKcCur, kCols, b + (trans_b ? kCol * ldb + pc : pc * ldb + kCol), ldb, kNr,
+              packed_b + first * kNr * kKcCur);
+      });
+
+      ParallelFor(0, kNumBlocks, kBlockGrain, [&](size_t first, size_t last) {
+        thread_local std::vector<T> a_storage;
+        T *packed_a = Scratch(a_storage, (kMc + kMr) * kKc);
+
+        for (size_t block = first; block < last; block++) {
+          const size_t kIc = block * kMc;
+          const size_t kMcCur = std::min(kMc, m - kIc);
+          PackA(trans_a, kMcCur, kKcCur, a + (trans_a ? pc * lda + kIc : kIc * lda + pc), lda, alpha, kMr,
+                packed_a);
+          MacroKernel(kKernel, kMcCur, kNcCur, kKcCur, packed_a, packed_b, c + kIc * ldc + jc, ldc);
+        }
+      });
+    }
+  }
+}
+
+}
+
+void Gemm(bool trans_a, bool trans_b,
+          size_t m, size_t n, size_t k,
+          double alpha, const double *a, size_t lda,
+          const double *b, size_t ldb,
+          double beta, double *c, size_t ldc) {
+  GemmImpl(trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+void Gemm(bool trans_a, bool trans_b,
+          size_t m, size_t n, size_t k,
+          float alpha, const float *a, size_t lda,
+          const float *b, size_t ldb,
+          float beta, float *c, size_t ldc) {
+  GemmImpl(trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+const char *GemmKernelName() {
+  return SelectedKernel<double>().name;
+}
+
+}
@@ -0,0 +1,83 @@
+#include <atomic>
+
+#include "GraphPool.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+// Blocks are rounded up to a multiple of kClassBytes (which keeps them aligned like operator new does)
+const size_t kClassBytes = alignof(std::max_align_t);
+const size_t kNumClasses = kMaxPooledBytes / kClassBytes;
+
+std::atomic<size_t> allocations{0};
+std::atomic<size_t> heap_allocations{0};
+
+// A free block stores the pointer to the next one
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+// Free lists of the calling thread. Blocks may be freed by another thread than the one that allocated them,
+// they simply join the free lists of that thread. The lists return their blocks to the heap when the thread exits.
+struct FreeLists {
+  FreeBlock *heads[kNumClasses] = {};
+
+  ~FreeLists();
+};
+
+// Set once the free lists of the thread are destroyed, e.g. for tensors owned by static objects -
+// later blocks go straight back to the heap (a trivially destructible flag stays valid until the thread ends)
+thread_local bool lists_destroyed = false;
+thread_local FreeLists lists;
+
+FreeLists::~FreeLists() {
+  lists_destroyed = true;
+  for (auto &head : heads) {
+    while (head) {
+      FreeBlock *next = head->next;
+      ::operator delete(head);
+      head = next;
+    }
+  }
+}
+
+size_t SizeClass(size_t bytes) {
+  return (bytes + kClassBytes - 1) / kClassBytes - 1;
+}
+
+}
+
+GraphPoolStats GetGraphPoolStats() {
+  return {allocations.load(std::memory_order_relaxed), heap_allocations.load(std::memory_order_relaxed)};
+}
+
+void *PoolAllocate(size_t bytes) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (bytes == 0)
+    bytes = 1;
+  if (bytes <= kMaxPooledBytes && !lists_destroyed) {
+    FreeBlock *&head = lists.heads[SizeClass(bytes)];
+    if (head) {
+      FreeBlock *block = head;
+      head = block->next;
+      return block;
+    }
+    bytes = (SizeClass(bytes) + 1) * kClassBytes;
+  }
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return ::operator new(bytes);
+}
+
+void PoolDeallocate(void *block, size_t bytes) {
+  if (bytes == 0)
+    bytes = 1;
+  if (bytes > kMaxPooledBytes || lists_destroyed) {
+    ::operator delete(block);
+    return;
+  }
+  FreeBlock *&head = lists.heads[SizeClass(bytes)];
+  head = new(block) FreeBlock{head};
+}
+
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+
+#include "DataLoader.hpp"
+#include "Hogwild.hpp"
+#include "ThreadPool.hpp"
+
+namespace cpp_tensor {
+
+// Constructor
+
+HogwildTrainer::HogwildTrainer(Sequential &model,
+                               size_t num_workers,
+                               const MakeOptimizer &make_optimizer,
+                               size_t staleness)
+    : shared_(model.Parameters()), staleness_(staleness) {
+  for (size_t w = 0; w < num_workers; w++) {
+    Worker worker;
+    worker.model = model.Clone();
+    if (!worker.model) {
+      workers_.clear();
+      return;
+    }
+    if (staleness_ == 0) {
+      worker.arena = ParameterArena(worker.model->Parameters(), shared_);
+    } else {
+      worker.arena = ParameterArena(worker.model->Parameters());
+      worker.snapshot = Buffer(shared_.Data(), shared_.Data() + shared_.Size());
+    }
+    worker.optimizer = make_optimizer(worker.arena);
+    workers_.push_back(std::move(worker));
+  }
+}
+
+// Training
+
+size_t HogwildTrainer::Train(const Tensor &x, const Tensor &y, const Loss &loss, size_t epochs, int batch_size) {
+  const size_t kWorkers = workers_.size(), kRows = x.Shape(0);
+  std::vector<size_t> steps(kWorkers);
+  ThreadPool::Global()->Run(kWorkers, [&](size_t w) {
+    Worker &worker = workers_[w];
+    const size_t kBegin = w * kRows / kWorkers, kEnd = (w + 1) * kRows / kWorkers;
+    if (kBegin == kEnd)
+      return;
+    // (The loader refers to the shards, which must outlive it)
+    const Tensor kX = x.Slice(0, kBegin, kEnd), kY = y.Slice(0, kBegin, kEnd);
+    DataLoader loader(kX, kY, batch_size, true);
+    loader.SetSeed(w);
+    for (size_t epoch = 0; epoch < epochs; epoch++) {
+      for (auto &[x_batch, y_batch] : loader) {
+        worker.optimizer->ZeroGrad();
+        loss((*worker.model)(x_batch), y_batch).Backward();
+        worker.optimizer->Step();
+        steps[w]++;
+        if (staleness_ > 0 && steps[w] % staleness_ == 0)
+          Publish(worker);
+      }
+    }
+    if (staleness_ > 0)
+      Publish(worker);
+  });
+
+  size_t res = 0;
+  for (auto &s : steps)
+    res += s;
+  return res;
+}
+
+// Helper function
+
+void HogwildTrainer::Publish(Worker &worker) {
+  Scalar *shared = shared_.Data(), *local = worker.arena.Data(), *snapshot = worker.snapshot.data();
+  for (size_t i = 0; i < shared_.Size(); i++) {
+    shared[i] += local[i] - snapshot[i];
+    local[i] = snapshot[i] = shared[i];
+  }
+}
+
+}
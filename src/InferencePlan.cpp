@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "Gemm.hpp"
+#include "InferencePlan.hpp"
+
+namespace cpp_tensor {
+
+// Building
+
+void InferencePlan::AddLinear(const Tensor &weight, const Tensor *bias) {
+  const size_t kIn = weight.Shape(0), kOut = weight.Shape(1);
+  if (width_ == 0) {
+    // Activations before the first Gemm take its input width
+    for (auto &step : steps_)
+      step.in = step.out = kIn;
+  } else if (width_ != kIn) {
+    valid_ = false;
+  }
+
+  Step step;
+  step.in = kIn;
+  step.out = kOut;
+  step.weight = Buffer(weight.Size());
+  weight.GetTensor()->CopyTo(step.weight.data());
+  if (bias) {
+    step.bias = Buffer(bias->Size());
+    bias->GetTensor()->CopyTo(step.bias.data());
+  }
+  steps_.push_back(std::move(step));
+  width_ = kOut;
+  max_width_ = std::max({max_width_, kIn, kOut});
+}
+
+void InferencePlan::AddRelu(Scalar leaky) {
+  // Fused into the preceding Gemm if it has no activation yet
+  if (!steps_.empty() && !steps_.back().weight.empty() && !steps_.back().relu) {
+    steps_.back().relu = true;
+    steps_.back().leaky = leaky;
+    return;
+  }
+  Step step;
+  step.in = step.out = width_;
+  step.relu = true;
+  step.leaky = leaky;
+  steps_.push_back(std::move(step));
+}
+
+// Running
+
+InferencePlan::Workspace InferencePlan::MakeWorkspace() const {
+  Workspace workspace;
+  for (auto &buffer : workspace.buffers_)
+    buffer = Buffer(max_batch_ * max_width_);
+  return workspace;
+}
+
+bool InferencePlan::Run(const Scalar *input, size_t rows, Scalar *output, Workspace &workspace) const {
+  if (!IsValid() || rows > max_batch_ || workspace.buffers_[0].size() < rows * max_width_)
+    return false;
+
+  const Scalar *src = input;
+  for (size_t s = 0; s < steps_.size(); s++) {
+    const Step &kStep = steps_[s];
+    Scalar *dst = s + 1 == steps_.size() ? output : workspace.buffers_[s % 2].data();
+    const size_t kSize = rows * kStep.out;
+    if (!kStep.weight.empty())
+      Gemm(false, false, rows, kStep.out, kStep.in, 1, src, kStep.in, kStep.weight.data(), kStep.out, 0, dst, kStep.out);
+    else
+      std::copy(src, src + kSize, dst);
+
+    // Epilogue - bias and activation in a single pass over the result (a slope of 1 leaves negative values alone)
+    if (!kStep.bias.empty() || kStep.relu) {
+      const Scalar *kBias = kStep.bias.empty() ? nullptr : kStep.bias.data();
+      const Scalar kSlope = kStep.relu ? kStep.leaky : 1;
+      for (size_t i = 0; i < kSize; i += kStep.out) {
+        for (size_t j = 0; j < kStep.out; j++) {
+          const Scalar kValue = kBias ? dst[i + j] + kBias[j] : dst[i + j];
+          dst[i + j] = kValue < 0 ? kValue * kSlope : kValue;
+        }
+      }
+    }
+    src = dst;
+  }
+  return true;
+}
+
+Tensor InferencePlan::Run(const Tensor &x) const {
+  // A single row (as LinearLayer accepts it) gives a 1D result. Anything but a row or a batch of rows of
+  // InFeatures() elements is rejected like an invalid plan.
+  const size_t kDims = x.NumDimensions();
+  const bool kUnbatched = kDims == 1 && x.Size() == InFeatures();
+  const size_t kRows = kUnbatched ? 1 : kDims == 2 ? x.Shape(0) : 0;
+  if (kRows == 0 || x.Size() != kRows * InFeatures())
+    return Tensor();
+  Buffer input(x.Size());
+  x.GetTensor()->CopyTo(input.data());
+  Buffer output(kRows * OutFeatures());
+  Workspace workspace = MakeWorkspace();
+  if (!Run(input.data(), kRows, output.data(), workspace))
+    return Tensor();
+  Dims shape = kUnbatched ? Dims{OutFeatures()} : Dims{kRows, OutFeatures()};
+  return Tensor(MakeTensor(std::move(output), std::move(shape)));
+}
+
+}
@@ -14,8 +14,8 @@ Initialization Initialization::Uniform(double a, double b) {
 
     std::random_device rd;
     std::mt19937 mt(rd());
-    std::uniform_real_distribution<double> dist(a, b);
-    std::vector<double> values;
+    std::uniform_real_distribution<Scalar> dist(a, b);
+    std::vector<Scalar> values;
 
     for (int i = 0; i < size; i++)
       values.push_back(dist(mt));
@@ -31,9 +31,9 @@ Initialization Initialization::Normal(double mean, double std) {
 
     std::random_device rd;
     std::mt19937 mt(rd());
-    std::normal_distribution<double> dist(mean, std);
+    std::normal_distribution<Scalar> dist(mean, std);
 
-    std::vector<double> values;
+    std::vector<Scalar> values;
     for (int i = 0; i < size; i++)
       values.push_back(dist(mt));
     return Tensor(values, shape, true);
@@ -46,7 +46,7 @@ Initialization Initialization::Constant(double val) {
     for (auto &kS : shape)
       size *= kS;
 
-    std::vector<double> values;
+    std::vector<Scalar> values;
     for (int i = 0; i < size; i++)
       values.push_back(val);
     return Tensor(values, shape, true);
@@ -1,66 +1,213 @@
+#include <atomic>
 #include <numeric>
 #include <utility>
 
+#include "Fusion.hpp"
+#include "Gemm.hpp"
 #include "InternalTensor.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
 
 namespace cpp_tensor {
 
-bool InternalTensor::use_grad_ = true;
+// Identifies a Backward pass, so that nodes can be marked as visited without a separate set
+std::atomic<size_t> backward_epoch{0};
 
-// Constructor
+// Storage in a block of the graph pool (the elements themselves are allocated by the vector)
+SharedStorage MakeStorage(Buffer data) {
+  return std::allocate_shared<Storage>(PoolAllocator<Storage>(), std::move(data));
+}
 
-InternalTensor::InternalTensor(std::vector<double> data, std::vector<size_t> shape, bool requires_grad, bool is_leaf)
-    : data_(std::move(data)), shape_(std::move(shape)), requires_grad_(requires_grad), is_leaf_(is_leaf) {}
+// Calls fn(i, j) for every element of a tensor with the given shape, in row-major order,
+// where i is the position of the element in the 1D representation of the tensor
+// and j = offset + i0 * strides[0] + i1 * strides[1] + ... is its position in the strided buffer
+template<typename F>
+void ForEachStrided(const Dims &shape, const Dims &strides, size_t offset, F fn) {
+  size_t size = 1;
+  for (auto &s : shape)
+    size *= s;
+  if (shape.empty()) {
+    fn(0, offset);
+    return;
+  }
+  if (size == 0)
+    return;
 
-// Gradient updates
+  const size_t kDims = shape.size();
+  const size_t kInner = shape[kDims - 1], kInnerStride = strides[kDims - 1];
+  Dims index(kDims, 0);
+  size_t position = offset;
+  for (size_t i = 0; i < size; i += kInner) {
+    for (size_t j = 0; j < kInner; j++)
+      fn(i + j, position + j * kInnerStride);
+
+    // Advance the index over the outer dimensions like an odometer
+    for (size_t d = kDims - 1; d-- > 0;) {
+      position += strides[d];
+      if (++index[d] < shape[d])
+        break;
+      position -= strides[d] * shape[d];
+      index[d] = 0;
+    }
+  }
+}
 
-void InternalTensor::UpdateGrad(std::vector<double> grad) {
-  if (grad_.empty())
-    grad_ = std::move(grad);
+// Constructors
+
+InternalTensor::InternalTensor(Buffer data, Dims shape, bool requires_grad, bool is_leaf)
+    : storage_(MakeStorage(std::move(data))), shape_(std::move(shape)),
+      requires_grad_(requires_grad), is_leaf_(is_leaf) {
+  strides_ = ContiguousStrides(shape_);
+  InitLayout();
+}
+
+InternalTensor::InternalTensor(SharedStorage storage,
+                               size_t offset,
+                               Dims shape,
+                               Dims strides,
+                               bool requires_grad,
+                               bool is_leaf)
+    : storage_(std::move(storage)), offset_(offset), shape_(std::move(shape)), strides_(std::move(strides)),
+      is_leaf_(is_leaf), requires_grad_(requires_grad) {
+  InitLayout();
+}
+
+InternalTensor::InternalTensor(std::shared_ptr<const FusedProgram> program, Dims shape)
+    : shape_(std::move(shape)), fused_(std::move(program)) {
+  strides_ = ContiguousStrides(shape_);
+  InitLayout();
+}
+
+InternalTensor::~InternalTensor() {
+  // A gradient in an arena belongs to the arena (and the optimizer using it) - only the reference is dropped
+  if (grad_.InArena())
+    grad_ = GradBuffer();
   else
-    for (int i = 0; i < grad_.size(); i++)
-      grad_[i] += grad[i];
+    ResetGrad({});
+
+  // Releases the graph behind this tensor iteratively - destroying a long chain of parents
+  // recursively could overflow the stack. Parents used only by this tensor hand their own parents
+  // over to the loop before they are destroyed (backward operations hold references to them too).
+  backward_op_ = nullptr;
+  ParentList release = std::move(parents_);
+  while (!release.empty()) {
+    SharedTensor node = std::move(release.back());
+    release.pop_back();
+    if (node.use_count() == 1) {
+      node->backward_op_ = nullptr;
+      for (auto &p : node->parents_)
+        release.push_back(std::move(p));
+      node->parents_.clear();
+    }
+  }
 }
 
-// Performs Backward propagation through the computational graph created during the Forward pass.
-// If retainGraph is true, the graph is retained for further Backward passes.
+// Layout
 
-void InternalTensor::Backward(bool retain_graph) {
-  if (!requires_grad_)
-    return;
+void InternalTensor::CopyTo(Scalar *dst) {
+  const Scalar *src = DataPtr() - offset_;
+  if (contiguous_)
+    std::copy(src + offset_, src + offset_ + size_, dst);
+  else
+    ForEachStrided(shape_, strides_, offset_, [&](size_t i, size_t j) { dst[i] = src[j]; });
+}
 
-  // Process the node only if all its children have called Backward
-  // that way we ensure correct gradient accumulation
-  children_processed_++;
+Dims InternalTensor::ContiguousStrides(const Dims &shape) {
+  Dims strides(shape.size());
+  size_t stride = 1;
+  for (size_t d = shape.size(); d-- > 0;) {
+    strides[d] = stride;
+    stride *= shape[d];
+  }
+  return strides;
+}
 
-  if (children_processed_ >= num_children_) {
-    if (backward_op_)
-      backward_op_(this);
+// Gradient updates
 
-    if (!is_leaf_ && !retain_graph)
-      grad_.clear();
+void InternalTensor::SetGrad(Buffer grad) {
+  ResetGrad(std::move(grad));
+}
 
-    for (auto &p : parents_)
-      p->Backward(retain_graph);
+void InternalTensor::SetGrad(Scalar grad) {
+  if (grad_.size() != size_) {
+    ResetGrad(Buffer(size_, grad));
+    return;
+  }
+  Scalar *data = grad_.data();
+  ParallelFor(0, size_, kGrainSize, [&](size_t begin, size_t end) { std::fill(data + begin, data + end, grad); });
+}
 
-    if (!retain_graph) {
-      backward_op_ = nullptr;
-      parents_.clear();
+template<typename F>
+void InternalTensor::AccumulateGrad(F contribution) {
+  const bool kFresh = PrepareGrad();
+  Scalar *grad = grad_.data();
+  ParallelFor(0, size_, kGrainSize, [&](size_t begin, size_t end) {
+    if (kFresh) {
+      for (size_t i = begin; i < end; i++)
+        grad[i] = contribution(i);
+    } else {
+      for (size_t i = begin; i < end; i++)
+        grad[i] += contribution(i);
     }
-    
-    children_processed_ = 0;
+  });
+}
+
+void InternalTensor::UpdateGrad(Buffer grad) {
+  if (grad_.empty()) {
+    ResetGrad(std::move(grad));
+    return;
   }
+  const Scalar *kGrad = grad.data();
+  AccumulateGrad([kGrad](size_t i) { return kGrad[i]; });
 }
 
-// Friend functions for performing mathematical operations on tensors with gradient calculation support
+void InternalTensor::UpdateGrad(Scalar grad) {
+  AccumulateGrad([grad](size_t) { return grad; });
+}
 
-SharedTensor ApplyOperation(const std::vector<double> &data,
-                            const std::vector<size_t> &shape,
-                            const std::vector<SharedTensor> &parents,
-                            std::function<void(InternalTensor *)> backward_op) {
+// Lazy evaluation
+
+void InternalTensor::Materialize() {
+  // The program is moved out first, so that this tensor is no longer pending while it runs
+  const std::shared_ptr<const FusedProgram> kProgram = std::move(fused_);
+  ProfileScope profile("fused", ProfilePhase::kForward, kProgram->inputs);
+  Buffer data(size_);
+  if (kProgram->reduce)
+    data[0] = kProgram->Reduce();
+  else
+    kProgram->Evaluate(data.data());
+  storage_ = MakeStorage(std::move(data));
+
+  if (kProgram->use_grad)
+    SetOperation(kProgram->inputs, [kProgram](InternalTensor *res) { kProgram->Backward(res); }, true);
+}
+
+// Helper functions
+
+void InternalTensor::InitLayout() {
+  // Dimensions of size 1 do not constrain the layout, whatever their stride
+  size_ = 1;
+  contiguous_ = true;
+  for (size_t d = shape_.size(); d-- > 0;) {
+    if (shape_[d] != 1 && strides_[d] != size_)
+      contiguous_ = false;
+    size_ *= shape_[d];
+  }
+}
+
+size_t InternalTensor::StorageIndex(size_t index) const {
+  size_t res = offset_;
+  for (size_t d = shape_.size(); d-- > 0;) {
+    res += index % shape_[d] * strides_[d];
+    index /= shape_[d];
+  }
+  return res;
+}
+
+void InternalTensor::SetOperation(ParentList parents, BackwardFunction backward_op, bool use_grad) {
   bool requires_grad = false;
   bool is_leaf = false;
-  if (InternalTensor::use_grad_) {
+  if (use_grad) {
     for (auto &kP : parents) {
       if (kP->requires_grad_)
         requires_grad = true;
@@ -69,213 +216,480 @@ SharedTensor ApplyOperation(const std::vector<double> &data,
     }
   }
 
-  auto res = std::make_shared<InternalTensor>(data, shape, requires_grad, is_leaf);
+  requires_grad_ = requires_grad;
+  is_leaf_ = is_leaf;
   if (requires_grad) {
-    res->parents_ = parents;
-    res->backward_op_ = std::move(backward_op);
-    
-    for (auto &kP : parents) {
-      kP->num_children_++;
+    parents_ = std::move(parents);
+    backward_op_ = std::move(backward_op);
+    op_ = ProfileScope::current_op_;
+  }
+}
+
+void InternalTensor::ResetGrad(Buffer grad) {
+  if (grad_.InArena()) {
+    if (grad.empty())
+      std::fill(grad_.begin(), grad_.end(), 0);
+    else if (grad.size() == grad_.size())
+      std::copy(grad.begin(), grad.end(), grad_.begin());
+    return;
+  }
+  TrackGraphMemory((static_cast<std::ptrdiff_t>(grad.capacity()) - static_cast<std::ptrdiff_t>(grad_.capacity()))
+                   * static_cast<std::ptrdiff_t>(sizeof(Scalar)));
+  grad_ = std::move(grad);
+}
+
+void InternalTensor::MoveToArena(const SharedStorage &data, const SharedStorage &grad, size_t offset) {
+  CopyTo(data->Data() + offset);
+  if (!grad_.empty())
+    std::copy(grad_.begin(), grad_.end(), grad->Data() + offset);
+  TrackGraphMemory(-static_cast<std::ptrdiff_t>(grad_.capacity() * sizeof(Scalar)));
+  grad_ = GradBuffer(grad, offset, size_);
+
+  storage_ = data;
+  offset_ = offset;
+  strides_ = ContiguousStrides(shape_);
+  InitLayout();
+}
+
+void InternalTensor::AllocateGrad() {
+  if (grad_.empty())
+    ResetGrad(Buffer(Size(), 0));
+}
+
+bool InternalTensor::PrepareGrad() {
+  if (!grad_.empty())
+    return false;
+  ResetGrad(Buffer(Size()));
+  return true;
+}
+
+// Performs Backward propagation through the computational graph created during the Forward pass.
+// If retainGraph is true, the graph is retained for further Backward passes.
+
+void InternalTensor::Backward(bool retain_graph) {
+  if (fused_)
+    Materialize();
+  if (!requires_grad_)
+    return;
+
+  // Topological sort by an iterative depth-first search: in post-order every node comes after all of its
+  // parents, so in reverse order a node's gradient is complete (all of its children have run) when it runs.
+  // Leaves are not visited - they have no backward operation and only receive gradients.
+  // The root is referenced without ownership, the caller keeps it alive.
+  const size_t kEpoch = ++backward_epoch;
+  // (The buffers keep their capacity for the next Backward pass on this thread)
+  thread_local std::vector<SharedTensor> order;
+  thread_local std::vector<std::pair<SharedTensor, size_t>> stack;
+  stack.emplace_back(SharedTensor(SharedTensor(), this), 0);
+  visit_epoch_ = kEpoch;
+  while (!stack.empty()) {
+    InternalTensor *node = stack.back().first.get();
+    size_t &next_parent = stack.back().second;
+    if (next_parent < node->parents_.size()) {
+      const SharedTensor &kParent = node->parents_[next_parent++];
+      if (kParent->requires_grad_ && !kParent->parents_.empty() && kParent->visit_epoch_ != kEpoch) {
+        kParent->visit_epoch_ = kEpoch;
+        stack.emplace_back(kParent, 0);
+      }
+    } else {
+      order.push_back(std::move(stack.back().first));
+      stack.pop_back();
     }
   }
 
+  // Run the backward operations, releasing each node's references into the graph right after its operation
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    InternalTensor *node = it->get();
+    if (node->backward_op_ && !node->grad_.empty()) {
+      ProfileScope profile(node->op_, ProfilePhase::kBackward, node->parents_);
+      node->backward_op_(node);
+    }
+
+    if (!retain_graph) {
+      node->backward_op_ = nullptr;
+      node->parents_.clear();
+      if (!node->is_leaf_)
+        node->ResetGrad({});
+    }
+    it->reset();
+  }
+  order.clear();
+}
+
+// Friend functions for performing mathematical operations on tensors with gradient calculation support
+
+// True if the result of an operation on parents joins the graph: gradients are enabled on this thread
+// and a parent requires a gradient. Operations check it before creating their backward operation,
+// so that without a graph they neither copy their parents nor create the closure.
+template<typename... Parents>
+bool RecordsGraph(const Parents &... parents) {
+  return InternalTensor::use_grad_ && (parents->RequiresGrad() || ...);
+}
+
+SharedTensor ApplyOperation(SharedTensor res, ParentList parents, BackwardFunction backward_op) {
+  res->SetOperation(std::move(parents), std::move(backward_op));
   return res;
 }
 
+SharedTensor ApplyOperation(Buffer data,
+                            Dims shape,
+                            ParentList parents,
+                            BackwardFunction backward_op) {
+  return ApplyOperation(MakeTensor(std::move(data), std::move(shape)), std::move(parents), std::move(backward_op));
+}
+
+// Views - tensors sharing the storage of a, described by an offset and strides into that storage.
+// grad_offset and grad_strides describe the same elements within the (dense) gradient of a,
+// which is where the gradient of the view is accumulated.
+
+SharedTensor ViewInternal(const SharedTensor &a,
+                          size_t offset,
+                          Dims shape,
+                          Dims strides,
+                          size_t grad_offset,
+                          Dims grad_strides) {
+  ProfileScope profile("view", {a.get()});
+  auto res = MakeTensor(a->GetStorage(), offset, std::move(shape), std::move(strides));
+  if (!RecordsGraph(a))
+    return res;
+  return ApplyOperation(res, {a}, [a, grad_offset, grad_strides = std::move(grad_strides)](InternalTensor *res) {
+    if (a->RequiresGrad()) {
+      a->AllocateGrad();
+      ForEachStrided(res->shape_, grad_strides, grad_offset, [&](size_t i, size_t j) {
+        a->grad_[j] += res->grad_[i];
+      });
+    }
+  });
+}
+
+SharedTensor SelectInternal(const SharedTensor &a, const Dims &indices) {
+  const Dims kGradStrides = InternalTensor::ContiguousStrides(a->shape_);
+  const size_t kDims = indices.size();
+  size_t offset = a->offset_, grad_offset = 0;
+  for (size_t d = 0; d < kDims; d++) {
+    offset += indices[d] * a->strides_[d];
+    grad_offset += indices[d] * kGradStrides[d];
+  }
+
+  // Selecting a single element gives a tensor of Shape {1}
+  if (kDims == a->shape_.size())
+    return ViewInternal(a, offset, {1}, {1}, grad_offset, {1});
+  return ViewInternal(a, offset,
+                      Dims(a->shape_.begin() + kDims, a->shape_.end()),
+                      Dims(a->strides_.begin() + kDims, a->strides_.end()),
+                      grad_offset,
+                      Dims(kGradStrides.begin() + kDims, kGradStrides.end()));
+}
+
+SharedTensor SliceInternal(const SharedTensor &a, size_t dim, size_t begin, size_t end) {
+  const Dims kGradStrides = InternalTensor::ContiguousStrides(a->shape_);
+  Dims shape = a->shape_;
+  shape[dim] = end - begin;
+  return ViewInternal(a, a->offset_ + begin * a->strides_[dim], shape, a->strides_,
+                      begin * kGradStrides[dim], kGradStrides);
+}
+
+SharedTensor TransposeInternal(const SharedTensor &a, size_t dim0, size_t dim1) {
+  Dims grad_strides = InternalTensor::ContiguousStrides(a->shape_);
+  Dims shape = a->shape_, strides = a->strides_;
+  std::swap(shape[dim0], shape[dim1]);
+  std::swap(strides[dim0], strides[dim1]);
+  std::swap(grad_strides[dim0], grad_strides[dim1]);
+  return ViewInternal(a, a->offset_, shape, strides, 0, grad_strides);
+}
+
+SharedTensor ReshapeInternal(const SharedTensor &a, Dims shape) {
+  // Only a contiguous tensor can be reinterpreted with any shape, other layouts are copied first
+  const SharedTensor kSource = ContiguousInternal(a);
+  Dims strides = InternalTensor::ContiguousStrides(shape);
+  Dims grad_strides = strides;
+  return ViewInternal(kSource, kSource->offset_, std::move(shape), std::move(strides), 0, std::move(grad_strides));
+}
+
+SharedTensor ContiguousInternal(const SharedTensor &a) {
+  // Pending tensors are materialized here, before any kernel reads them
+  if (a->fused_)
+    a->Materialize();
+  if (a->contiguous_)
+    return a;
+
+  ProfileScope profile("contiguous", {a.get()});
+  Buffer data(a->Size());
+  a->CopyTo(data.data());
+  if (!RecordsGraph(a))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a}, [a](InternalTensor *res) {
+    if (a->RequiresGrad()) {
+      const Scalar *kGrad = res->grad_.data();
+      a->AccumulateGrad([kGrad](size_t i) { return kGrad[i]; });
+    }
+  });
+}
+
+// Copies the rows (sub-tensors along the first dimension) of a with the given indices to dst, one after another.
+// Used to assemble batches without creating a tensor per row.
+void GatherRowsInternal(const SharedTensor &a, const int *indices, size_t count, Scalar *dst) {
+  const size_t kRowSize = a->Size() / a->shape_[0];
+  const Scalar *src = a->DataPtr() - a->offset_;
+  const Dims kRowShape(a->shape_.begin() + 1, a->shape_.end()), kRowStrides(a->strides_.begin() + 1, a->strides_.end());
+  ParallelFor(0, count, std::max<size_t>(1, kGrainSize / kRowSize), [&](size_t begin, size_t end) {
+    for (size_t r = begin; r < end; r++) {
+      const size_t kOffset = a->offset_ + indices[r] * a->strides_[0];
+      Scalar *row = dst + r * kRowSize;
+      if (a->contiguous_)
+        std::copy(src + kOffset, src + kOffset + kRowSize, row);
+      else
+        ForEachStrided(kRowShape, kRowStrides, kOffset, [&](size_t i, size_t j) { row[i] = src[j]; });
+    }
+  });
+}
+
+// Sum of values[begin, end) - the map function for parallel reductions over data or a gradient
+// (accumulated in double precision regardless of the element type)
+double SumRange(const Scalar *values, size_t begin, size_t end) {
+  return std::accumulate(values + begin, values + end, 0.);
+}
+
 SharedTensor AddManyOneInternal(const SharedTensor &a, const SharedTensor &b) {
-  std::vector<double> data;
-  for (auto &d : a->data_)
-    data.push_back(d + b->data_[0]);
+  ProfileScope profile("add-scalar", {a.get(), b.get()});
+  Buffer data(a->Size());
+  const Scalar kB = b->DataPtr()[0];
+  ParallelFor(0, data.size(), kGrainSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      data[i] = a->DataPtr()[i] + kB;
+  });
 
-  return ApplyOperation(data, a->shape_, {a, b}, [a, b](InternalTensor *res) {
+  if (!RecordsGraph(a, b))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a, b}, [a, b](InternalTensor *res) {
+    const Scalar *kGrad = res->grad_.data();
     if (a->RequiresGrad())
-      a->UpdateGrad(res->grad_);
+      a->AccumulateGrad([kGrad](size_t i) { return kGrad[i]; });
     if (b->RequiresGrad())
-      b->UpdateGrad(std::accumulate(res->grad_.begin(), res->grad_.end(), 0.));
+      b->UpdateGrad(ParallelReduce(0, res->grad_.size(), kGrainSize, 0., [res](size_t begin, size_t end) {
+        return SumRange(res->grad_.data(), begin, end);
+      }, std::plus<>()));
   });
 }
 
 SharedTensor AddManyManyInternal(const SharedTensor &a, const SharedTensor &b) {
-  std::vector<double> data;
-  for (int i = 0; i < a->data_.size(); i++)
-    data.push_back(a->data_[i] + b->data_[i]);
+  ProfileScope profile("add", {a.get(), b.get()});
+  Buffer data(a->Size());
+  ParallelFor(0, data.size(), kGrainSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      data[i] = a->DataPtr()[i] + b->DataPtr()[i];
+  });
 
-  return ApplyOperation(data, a->shape_, {a, b}, [a, b](InternalTensor *res) {
+  if (!RecordsGraph(a, b))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a, b}, [a, b](InternalTensor *res) {
+    const Scalar *kGrad = res->grad_.data();
     if (a->RequiresGrad())
-      a->UpdateGrad(res->grad_);
+      a->AccumulateGrad([kGrad](size_t i) { return kGrad[i]; });
 
     if (b->RequiresGrad())
-      b->UpdateGrad(res->grad_);
+      b->AccumulateGrad([kGrad](size_t i) { return kGrad[i]; });
   });
 }
 
 SharedTensor AddBiasInternal(const SharedTensor &a, const SharedTensor &b) {
-  std::vector<double> data(a->Size());
-  for (int i = 0; i < data.size(); i += b->Size())
-    for (int j = 0; j < b->Size(); j++)
-      data[i + j] = a->data_[i + j] + b->data_[j];
+  ProfileScope profile("add-bias", {a.get(), b.get()});
+  // The bias is added to every row of a, where a row has b->Size() elements
+  const size_t kCols = b->Size(), kRows = a->Size() / kCols;
+  const size_t kRowGrain = std::max<size_t>(1, kGrainSize / kCols);
+  Buffer data(a->Size());
+  ParallelFor(0, kRows, kRowGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin * kCols; i < end * kCols; i += kCols)
+      for (size_t j = 0; j < kCols; j++)
+        data[i + j] = a->DataPtr()[i + j] + b->DataPtr()[j];
+  });
 
-  return ApplyOperation({data}, a->shape_, {a, b}, [a, b](InternalTensor *res) {
-    if (a->RequiresGrad())
-      a->UpdateGrad(res->grad_);
+  if (!RecordsGraph(a, b))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a, b}, [a, b, kCols, kRows, kRowGrain](InternalTensor *res) {
+    if (a->RequiresGrad()) {
+      const Scalar *kGrad = res->grad_.data();
+      a->AccumulateGrad([kGrad](size_t i) { return kGrad[i]; });
+    }
 
     if (b->RequiresGrad()) {
-      std::vector<double> b_grad(b->Size());
-      for (int i = 0; i < res->Size(); i += b->Size())
-        for (int j = 0; j < b->Size(); j++)
-          b_grad[j] += res->grad_[i + j];
-      b->UpdateGrad(b_grad);
+      // Column sums of the gradient, reduced over blocks of rows
+      auto column_sums = [res, kCols](size_t begin, size_t end) {
+        Buffer partial(kCols, 0);
+        for (size_t i = begin * kCols; i < end * kCols; i += kCols)
+          for (size_t j = 0; j < kCols; j++)
+            partial[j] += res->grad_[i + j];
+        return partial;
+      };
+      auto add = [](Buffer lhs, const Buffer &rhs) {
+        for (size_t j = 0; j < lhs.size(); j++)
+          lhs[j] += rhs[j];
+        return lhs;
+      };
+      b->UpdateGrad(ParallelReduce(0, kRows, kRowGrain, Buffer(kCols, 0), column_sums, add));
     }
   });
 }
 
 SharedTensor MultiplyManyOneInternal(const SharedTensor &a, const SharedTensor &b) {
-  std::vector<double> data;
-  for (auto &d : a->data_)
-    data.push_back(d * b->data_[0]);
+  ProfileScope profile("mul-scalar", {a.get(), b.get()});
+  Buffer data(a->Size());
+  const Scalar kB = b->DataPtr()[0];
+  ParallelFor(0, data.size(), kGrainSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      data[i] = a->DataPtr()[i] * kB;
+  });
 
-  return ApplyOperation(data, a->shape_, {a, b}, [a, b](InternalTensor *res) {
+  if (!RecordsGraph(a, b))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a, b}, [a, b](InternalTensor *res) {
     if (a->RequiresGrad()) {
-      std::vector<double> a_grad(a->data_.size());
-      for (int i = 0; i < a_grad.size(); i++)
-        a_grad[i] = res->grad_[i] * b->data_[0];
-      a->UpdateGrad(a_grad);
+      const Scalar *kGrad = res->grad_.data();
+      const Scalar kB = b->DataPtr()[0];
+      a->AccumulateGrad([kGrad, kB](size_t i) { return kGrad[i] * kB; });
     }
 
-    if (b->RequiresGrad()) {
-      double b_grad = 0;
-      for (int i = 0; i < res->grad_.size(); i++)
-        b_grad += res->grad_[i] * a->data_[i];
-      b->UpdateGrad(b_grad);
-    }
+    if (b->RequiresGrad())
+      b->UpdateGrad(ParallelReduce(0, res->grad_.size(), kGrainSize, 0., [a, res](size_t begin, size_t end) {
+        double b_grad = 0;
+        for (size_t i = begin; i < end; i++)
+          b_grad += res->grad_[i] * a->DataPtr()[i];
+        return b_grad;
+      }, std::plus<>()));
   });
 }
 
 SharedTensor MultiplyManyManyInternal(const SharedTensor &a, const SharedTensor &b) {
-  std::vector<double> data;
-  for (int i = 0; i < a->data_.size(); i++)
-    data.push_back(a->data_[i] * b->data_[i]);
+  ProfileScope profile("mul", {a.get(), b.get()});
+  Buffer data(a->Size());
+  ParallelFor(0, data.size(), kGrainSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      data[i] = a->DataPtr()[i] * b->DataPtr()[i];
+  });
 
-  return ApplyOperation(data, a->shape_, {a, b}, [a, b](InternalTensor *res) {
-    if (a->RequiresGrad()) {
-      std::vector<double> a_grad(a->data_.size());
-      for (int i = 0; i < a_grad.size(); i++)
-        a_grad[i] = res->grad_[i] * b->data_[i];
-      a->UpdateGrad(a_grad);
-    }
+  if (!RecordsGraph(a, b))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a, b}, [a, b](InternalTensor *res) {
+    const Scalar *kGrad = res->grad_.data(), *kA = a->DataPtr(), *kB = b->DataPtr();
+    if (a->RequiresGrad())
+      a->AccumulateGrad([kGrad, kB](size_t i) { return kGrad[i] * kB[i]; });
 
-    if (b->RequiresGrad()) {
-      std::vector<double> b_grad(a->data_.size());
-      for (int i = 0; i < b_grad.size(); i++)
-        b_grad[i] = res->grad_[i] * a->data_[i];
-      b->UpdateGrad(b_grad);
-    }
+    if (b->RequiresGrad())
+      b->AccumulateGrad([kGrad, kA](size_t i) { return kGrad[i] * kA[i]; });
   });
 }
 
 SharedTensor OppositeInternal(const SharedTensor &a) {
   return MultiplyManyOneInternal(a,
-                                 std::make_shared<InternalTensor>(std::vector<double>({-1}), std::vector<size_t>({})));
+                                 MakeTensor(Buffer({-1}), Dims()));
 }
 
 SharedTensor InverseInternal(const SharedTensor &a) {
   return PowInternal(a, -1);
 }
 
-std::vector<double> MatmulVectors(const std::vector<double> &a,
-                                  const std::vector<double> &b,
-                                  const size_t n,
-                                  const size_t m,
-                                  const size_t p) {
-  std::vector<double> res(n * p);
-  int iter_res = 0;
-
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < p; j++) {
-      int iter_a = i * m, iter_b = j;
-      for (int k = 0; k < m; k++) {
-        res[iter_res] = res[iter_res] + a[iter_a] * b[iter_b];
-        iter_a++, iter_b += p;
-      }
-      iter_res++;
-    }
+// How Gemm reads a 2D tensor in place: as a row-major matrix with leading dimension ld (trans = false),
+// or as the transpose of one (trans = true), e.g. for a transposed view.
+// Returns false for layouts that Gemm cannot read, e.g. a matrix selected from a transposed 3D tensor.
+bool GemmLayout(const InternalTensor &t, bool &trans, size_t &ld) {
+  const size_t kRows = t.Shape()[0], kCols = t.Shape()[1];
+  const size_t kRowStride = t.Strides()[0], kColStride = t.Strides()[1];
+  if (kColStride == 1 || kCols == 1) {
+    trans = false;
+    ld = kRows == 1 ? kCols : kRowStride;
+    return ld >= kCols;
   }
-
-  return res;
-}
-
-std::vector<double> Transpose(const std::vector<double> &a, const size_t n, const size_t m) {
-  std::vector<double> res(m * n);
-
-  for (size_t i = 0; i < n; ++i)
-    for (size_t j = 0; j < m; ++j)
-      res[j * n + i] = a[i * m + j];
-
-  return res;
+  if (kRowStride == 1 || kRows == 1) {
+    trans = true;
+    ld = kCols == 1 ? kRows : kColStride;
+    return ld >= kRows;
+  }
+  return false;
 }
 
-SharedTensor MatmulInternal(const SharedTensor &a, const SharedTensor &b) {
-  std::vector<double> data = MatmulVectors(a->data_, b->data_, a->shape_[0], a->shape_[1], b->shape_[1]);
-
-  return ApplyOperation(data, {a->shape_[0], b->shape_[1]}, {a, b}, [a, b](InternalTensor *res) {
-    const size_t kN = a->shape_[0];
-    const size_t kM = a->shape_[1];
-    const size_t kP = b->shape_[1];
-    if (a->RequiresGrad())
-      a->UpdateGrad(MatmulVectors(res->grad_, Transpose(b->data_, kM, kP), kN, kP, kM));
+SharedTensor MatmulInternal(const SharedTensor &a_view, const SharedTensor &b_view) {
+  ProfileScope profile("matmul", {a_view.get(), b_view.get()});
+  bool trans_a, trans_b;
+  size_t lda, ldb;
+  const SharedTensor a = GemmLayout(*a_view, trans_a, lda) ? a_view : ContiguousInternal(a_view);
+  const SharedTensor b = GemmLayout(*b_view, trans_b, ldb) ? b_view : ContiguousInternal(b_view);
+  GemmLayout(*a, trans_a, lda);
+  GemmLayout(*b, trans_b, ldb);
+
+  const size_t kN = a->shape_[0], kM = a->shape_[1], kP = b->shape_[1];
+  Buffer data(kN * kP);
+  Gemm(trans_a, trans_b, kN, kP, kM, 1, a->DataPtr(), lda, b->DataPtr(), ldb, 0, data.data(), kP);
+
+  if (!RecordsGraph(a, b))
+    return MakeTensor(std::move(data), Dims{kN, kP});
+  return ApplyOperation(std::move(data), {kN, kP}, {a, b},
+                        [a, b, trans_a, trans_b, lda, ldb, kN, kM, kP](InternalTensor *res) {
+    // dA = dC * B^T and dB = A^T * dC, reading the (possibly already transposed) operands in place
+    // and accumulating straight into the dense gradient buffers (beta = 1 once they exist)
+    if (a->RequiresGrad()) {
+      const bool kFresh = a->PrepareGrad();
+      Gemm(false, !trans_b, kN, kM, kP, 1, res->grad_.data(), kP, b->DataPtr(), ldb,
+           kFresh ? 0 : 1, a->grad_.data(), kM);
+    }
 
-    if (b->RequiresGrad())
-      b->UpdateGrad(MatmulVectors(Transpose(a->data_, kN, kM), res->grad_, kM, kN, kP));
+    if (b->RequiresGrad()) {
+      const bool kFresh = b->PrepareGrad();
+      Gemm(!trans_a, false, kM, kP, kN, 1, a->DataPtr(), lda, res->grad_.data(), kP,
+           kFresh ? 0 : 1, b->grad_.data(), kP);
+    }
   });
 }
 
 SharedTensor PowInternal(const SharedTensor &a, int exponent) {
-  std::vector<double> data(a->data_.size(), 1);
-
-  int exp = exponent;
-  while (exp < 0) {
-    for (int i = 0; i < data.size(); i++)
-      data[i] /= a->data_[i];
-    exp++;
-  }
-
-  while (exp > 0) {
-    for (int i = 0; i < data.size(); i++)
-      data[i] *= a->data_[i];
-    exp--;
-  }
+  ProfileScope profile("pow", {a.get()});
+  Buffer data(a->Size());
+  ParallelFor(0, data.size(), kGrainSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      data[i] = IntegerPow(a->DataPtr()[i], exponent);
+  });
 
-  return ApplyOperation(data, a->shape_, {a}, [a, exponent, data](InternalTensor *res) { // &?
+  if (!RecordsGraph(a))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a}, [a, exponent](InternalTensor *res) {
     if (a->RequiresGrad()) {
-      std::vector<double> a_grad(a->data_.size());
-      for (int i = 0; i < a_grad.size(); i++)
-        a_grad[i] = res->grad_[i] * (exponent * (data[i] / a->data_[i]));
-      a->UpdateGrad(a_grad);
+      // d(x^n)/dx = n * x^(n - 1), evaluated directly so that x = 0 does not produce 0 / 0
+      const Scalar *kGrad = res->grad_.data(), *kA = a->DataPtr();
+      a->AccumulateGrad([kGrad, kA, exponent](size_t i) {
+        return kGrad[i] * (exponent * IntegerPow(kA[i], exponent - 1));
+      });
     }
   });
 }
 
 SharedTensor SumInternal(const SharedTensor &a) {
-  double data = std::accumulate(a->data_.begin(), a->data_.end(), 0.);
-
-  return ApplyOperation({data}, {}, {a}, [a, data](InternalTensor *res) {
+  ProfileScope profile("sum", {a.get()});
+  Scalar data = ParallelReduce(0, a->Size(), kGrainSize, 0., [&a](size_t begin, size_t end) {
+    return SumRange(a->DataPtr(), begin, end);
+  }, std::plus<>());
+
+  if (!RecordsGraph(a))
+    return MakeTensor(Buffer({data}), Dims());
+  return ApplyOperation({data}, {}, {a}, [a](InternalTensor *res) {
     if (a->RequiresGrad())
-      a->UpdateGrad(std::vector<double>(a->data_.size(), res->grad_[0]));
+      a->UpdateGrad(res->grad_[0]);
   });
 }
 
 SharedTensor ReluInternal(const SharedTensor &a, double leaky) {
-  std::vector<double> data = a->data_;
-  for (auto &d : data)
-    if (d < 0)
-      d *= leaky;
+  ProfileScope profile("relu", {a.get()});
+  const Scalar kLeaky = leaky;
+  Buffer data(a->Size());
+  ParallelFor(0, data.size(), kGrainSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      data[i] = a->DataPtr()[i] < 0 ? a->DataPtr()[i] * kLeaky : a->DataPtr()[i];
+  });
 
-  return ApplyOperation(data, a->shape_, {a}, [a, leaky](InternalTensor *res) {
+  if (!RecordsGraph(a))
+    return MakeTensor(std::move(data), a->shape_);
+  return ApplyOperation(std::move(data), a->shape_, {a}, [a, kLeaky](InternalTensor *res) {
     if (a->RequiresGrad()) {
-      std::vector<double> a_grad(a->data_.size());
-      for (int i = 0; i < a_grad.size(); i++)
-        a_grad[i] = res->grad_[i] * (a->data_[i] < 0 ? leaky : 1);
-      a->UpdateGrad(a_grad);
+      const Scalar *kGrad = res->grad_.data(), *kA = a->DataPtr();
+      a->AccumulateGrad([kGrad, kA, kLeaky](size_t i) { return kGrad[i] * (kA[i] < 0 ? kLeaky : 1); });
     }
   });
 }
@@ -12,11 +12,16 @@ LinearLayer::LinearLayer(size_t in_features, size_t out_features, Initialization
   if (is_bias) bias_ = init({out_features});
 }
 
+LinearLayer::LinearLayer(Tensor weight, Tensor bias, bool is_bias)
+    : weight_(std::move(weight)), in_features_(weight_.Shape(0)), out_features_(weight_.Shape(1)), is_bias_(is_bias) {
+  if (is_bias) bias_ = std::move(bias);
+}
+
 // LinearLayer - Overloaded virtual methods
 
 Tensor LinearLayer::Forward(const Tensor &x) const &{
   if (x.Size() == in_features_) {  // unbatched
-    auto res = x.Clone(false).Reshape({1, in_features_}).Matmul(weight_).Flatten();
+    auto res = x.Reshape({1, in_features_}).Matmul(weight_).Flatten();
     if (is_bias_) res = res + bias_;
     return res;
   } else {  // batched
@@ -26,6 +31,15 @@ Tensor LinearLayer::Forward(const Tensor &x) const &{
   }
 }
 
+bool LinearLayer::AddToCheckpoint(std::vector<CheckpointModule> &records) const &{
+  records.push_back({CheckpointModule::kLinear, is_bias_, in_features_, out_features_, 0, 0});
+  return true;
+}
+
+std::unique_ptr<Module> LinearLayer::Clone() const &{
+  return std::make_unique<LinearLayer>(weight_.Clone(), bias_.Clone(), is_bias_);
+}
+
 std::vector<SharedTensor> LinearLayer::Parameters() const &{
   std::vector<SharedTensor> parameters = {weight_.GetTensor()};
   if (is_bias_) parameters.push_back(bias_.GetTensor());
@@ -50,4 +64,36 @@ Tensor Sequential::Forward(const Tensor &x) const &{
   return res;
 }
 
-}
\ No newline at end of file
+void Sequential::AddToPlan(InferencePlan &plan) const &{
+  for (auto &kModule : modules_)
+    kModule->AddToPlan(plan);
+}
+
+bool Sequential::AddToCheckpoint(std::vector<CheckpointModule> &records) const &{
+  records.push_back({CheckpointModule::kSequential, 0, 0, 0, 0, modules_.size()});
+  for (auto &kModule : modules_)
+    if (!kModule->AddToCheckpoint(records))
+      return false;
+  return true;
+}
+
+std::unique_ptr<Module> Sequential::Clone() const &{
+  auto res = std::make_unique<Sequential>();
+  for (auto &kModule : modules_) {
+    auto clone = kModule->Clone();
+    if (!clone)
+      return nullptr;
+    res->modules_.push_back(std::move(clone));
+  }
+  return res;
+}
+
+// Sequential - Inference
+
+InferencePlan Sequential::Freeze(size_t max_batch) const {
+  InferencePlan plan(max_batch);
+  AddToPlan(plan);
+  return plan;
+}
+
+}
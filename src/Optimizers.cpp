@@ -1,21 +1,305 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPPTENSOR_X86 1
+#endif
+
 #include "Optimizers.hpp"
 #include "Tensor.hpp"
+#include "ThreadPool.hpp"
 
 namespace cpp_tensor {
 
-// Optimizer operations
+namespace {
 
-void SGD::Step() {
-  Tensor::SetUseGrad(false);
-  for (auto &p : parameters_)
-    for (int i = 0; i < p->Size(); i++)
-      p->Data(i) -= lr_ * p->Grad(i);
-  Tensor::SetUseGrad(true);
+// Coefficients of a step, in the precision of the elements
+
+struct SgdCoefficients {
+  Scalar lr;
+  Scalar momentum;
+  bool nesterov;
+};
+
+struct AdamCoefficients {
+  Scalar step_size;  // lr / (1 - beta1^t)
+  Scalar beta1;
+  Scalar beta2;
+  Scalar one_minus_beta1;
+  Scalar one_minus_beta2;
+  Scalar inv_bias2;  // 1 / sqrt(1 - beta2^t)
+  Scalar eps;
+  Scalar l2;  // added to the gradient (Adam)
+  Scalar decay;  // factor of the parameters before the update (AdamW)
+};
+
+// Portable kernels (also used for the elements after the last full vector)
+
+void SgdScalar(Scalar *p, const Scalar *g, Scalar *buf, size_t n, const SgdCoefficients &c) {
+  if (!buf) {
+    for (size_t i = 0; i < n; i++)
+      p[i] -= c.lr * g[i];
+    return;
+  }
+  for (size_t i = 0; i < n; i++) {
+    const Scalar kBuf = c.momentum * buf[i] + g[i];
+    buf[i] = kBuf;
+    p[i] -= c.lr * (c.nesterov ? g[i] + c.momentum * kBuf : kBuf);
+  }
+}
+
+void AdamScalar(Scalar *p, const Scalar *g, Scalar *m, Scalar *v, size_t n, const AdamCoefficients &c) {
+  for (size_t i = 0; i < n; i++) {
+    const Scalar kG = g[i] + c.l2 * p[i];
+    m[i] = c.beta1 * m[i] + c.one_minus_beta1 * kG;
+    v[i] = c.beta2 * v[i] + c.one_minus_beta2 * kG * kG;
+    p[i] = c.decay * p[i] - c.step_size * m[i] / (std::sqrt(v[i]) * c.inv_bias2 + c.eps);
+  }
+}
+
+#ifdef CPPTENSOR_X86
+
+// AVX2 + FMA kernels, written once for both precisions on top of these wrappers
+
+template<typename T>
+struct Avx2;
+
+template<>
+struct Avx2<double> {
+  using V = __m256d;
+  static constexpr size_t kWidth = 4;
+  __attribute__((target("avx2,fma"))) static V Load(const double *p) { return _mm256_loadu_pd(p); }
+  __attribute__((target("avx2,fma"))) static void Store(double *p, V a) { _mm256_storeu_pd(p, a); }
+  __attribute__((target("avx2,fma"))) static V Set(double a) { return _mm256_set1_pd(a); }
+  __attribute__((target("avx2,fma"))) static V Add(V a, V b) { return _mm256_add_pd(a, b); }
+  __attribute__((target("avx2,fma"))) static V Mul(V a, V b) { return _mm256_mul_pd(a, b); }
+  __attribute__((target("avx2,fma"))) static V Div(V a, V b) { return _mm256_div_pd(a, b); }
+  __attribute__((target("avx2,fma"))) static V Sqrt(V a) { return _mm256_sqrt_pd(a); }
+  __attribute__((target("avx2,fma"))) static V Fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+  __attribute__((target("avx2,fma"))) static V Fnmadd(V a, V b, V c) { return _mm256_fnmadd_pd(a, b, c); }
+};
+
+template<>
+struct Avx2<float> {
+  using V = __m256;
+  static constexpr size_t kWidth = 8;
+  __attribute__((target("avx2,fma"))) static V Load(const float *p) { return _mm256_loadu_ps(p); }
+  __attribute__((target("avx2,fma"))) static void Store(float *p, V a) { _mm256_storeu_ps(p, a); }
+  __attribute__((target("avx2,fma"))) static V Set(float a) { return _mm256_set1_ps(a); }
+  __attribute__((target("avx2,fma"))) static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+  __attribute__((target("avx2,fma"))) static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  __attribute__((target("avx2,fma"))) static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+  __attribute__((target("avx2,fma"))) static V Sqrt(V a) { return _mm256_sqrt_ps(a); }
+  __attribute__((target("avx2,fma"))) static V Fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  __attribute__((target("avx2,fma"))) static V Fnmadd(V a, V b, V c) { return _mm256_fnmadd_ps(a, b, c); }
+};
+
+__attribute__((target("avx2,fma")))
+void SgdAvx2(Scalar *p, const Scalar *g, Scalar *buf, size_t n, const SgdCoefficients &c) {
+  using S = Avx2<Scalar>;
+  const auto kLr = S::Set(c.lr), kMomentum = S::Set(c.momentum);
+  size_t i = 0;
+  if (!buf) {
+    for (; i + S::kWidth <= n; i += S::kWidth)
+      S::Store(p + i, S::Fnmadd(kLr, S::Load(g + i), S::Load(p + i)));
+  } else {
+    for (; i + S::kWidth <= n; i += S::kWidth) {
+      const auto kG = S::Load(g + i);
+      const auto kBuf = S::Fmadd(kMomentum, S::Load(buf + i), kG);
+      S::Store(buf + i, kBuf);
+      const auto kDirection = c.nesterov ? S::Fmadd(kMomentum, kBuf, kG) : kBuf;
+      S::Store(p + i, S::Fnmadd(kLr, kDirection, S::Load(p + i)));
+    }
+  }
+  SgdScalar(p + i, g + i, buf ? buf + i : nullptr, n - i, c);
+}
+
+__attribute__((target("avx2,fma")))
+void AdamAvx2(Scalar *p, const Scalar *g, Scalar *m, Scalar *v, size_t n, const AdamCoefficients &c) {
+  using S = Avx2<Scalar>;
+  const auto kStepSize = S::Set(c.step_size), kBeta1 = S::Set(c.beta1), kBeta2 = S::Set(c.beta2);
+  const auto kOneMinusBeta1 = S::Set(c.one_minus_beta1), kOneMinusBeta2 = S::Set(c.one_minus_beta2);
+  const auto kInvBias2 = S::Set(c.inv_bias2), kEps = S::Set(c.eps), kL2 = S::Set(c.l2), kDecay = S::Set(c.decay);
+  size_t i = 0;
+  for (; i + S::kWidth <= n; i += S::kWidth) {
+    const auto kP = S::Load(p + i);
+    const auto kG = S::Fmadd(kL2, kP, S::Load(g + i));
+    const auto kM = S::Fmadd(kBeta1, S::Load(m + i), S::Mul(kOneMinusBeta1, kG));
+    const auto kV = S::Fmadd(kBeta2, S::Load(v + i), S::Mul(kOneMinusBeta2, S::Mul(kG, kG)));
+    S::Store(m + i, kM);
+    S::Store(v + i, kV);
+    const auto kDenominator = S::Fmadd(S::Sqrt(kV), kInvBias2, kEps);
+    S::Store(p + i, S::Fnmadd(kStepSize, S::Div(kM, kDenominator), S::Mul(kDecay, kP)));
+  }
+  AdamScalar(p + i, g + i, m + i, v + i, n - i, c);
+}
+
+bool UseAvx2() {
+  static const bool kAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return kAvx2;
+}
+
+#endif
+
+void SgdKernel(Scalar *p, const Scalar *g, Scalar *buf, size_t n, const SgdCoefficients &c) {
+#ifdef CPPTENSOR_X86
+  if (UseAvx2())
+    return SgdAvx2(p, g, buf, n, c);
+#endif
+  SgdScalar(p, g, buf, n, c);
 }
 
-void SGD::ZeroGrad() {
+void AdamKernel(Scalar *p, const Scalar *g, Scalar *m, Scalar *v, size_t n, const AdamCoefficients &c) {
+#ifdef CPPTENSOR_X86
+  if (UseAvx2())
+    return AdamAvx2(p, g, m, v, n, c);
+#endif
+  AdamScalar(p, g, m, v, n, c);
+}
+
+}
+
+// Optimizer - Constructors
+
+Optimizer::Optimizer(std::vector<SharedTensor> parameters) : parameters_(std::move(parameters)) {
+  for (auto &p : parameters_) {
+    offsets_.push_back(state_size_);
+    state_size_ += p->Size();
+  }
+}
+
+Optimizer::Optimizer(ParameterArena arena)
+    : parameters_(arena.Parameters()), arena_(std::move(arena)), state_size_(arena_.Size()) {}
+
+// Optimizer - Optimizer operations
+
+void Optimizer::ZeroGrad() {
+  if (arena_.Size() > 0) {
+    arena_.ZeroGrad();
+    return;
+  }
   for (auto &p : parameters_)
     p->SetGrad(0);
 }
 
-}
\ No newline at end of file
+// Optimizer - Helper functions
+
+template<typename F>
+void Optimizer::ForEachRange(F update) {
+  NoGradGuard no_grad;
+  if (arena_.Size() > 0) {
+    Scalar *data = arena_.Data();
+    const Scalar *kGrad = arena_.Grad();
+    ParallelFor(0, arena_.Size(), kGrainSize, [&](size_t begin, size_t end) {
+      update(data + begin, kGrad + begin, begin, end - begin);
+    });
+    return;
+  }
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    InternalTensor &p = *parameters_[i];
+    if (!p.HasGrad())
+      continue;
+    Scalar *data = p.DataPtr();
+    const Scalar *kGrad = &p.Grad(0);
+    ParallelFor(0, p.Size(), kGrainSize, [&](size_t begin, size_t end) {
+      update(data + begin, kGrad + begin, offsets_[i] + begin, end - begin);
+    });
+  }
+}
+
+void Optimizer::ResetState(size_t count) {
+  state_.clear();
+  for (size_t i = 0; i < count; i++)
+    state_.push_back(MakeTensor(Buffer(state_size_, 0), Dims{state_size_}));
+}
+
+bool Optimizer::RestoreState(const std::vector<SharedTensor> &buffers) {
+  for (auto &b : buffers)
+    if (b->Size() != state_size_)
+      return false;
+  ResetState(buffers.size());
+  for (size_t i = 0; i < buffers.size(); i++)
+    buffers[i]->CopyTo(State(i));
+  return true;
+}
+
+// SGD
+
+SGD::SGD(std::vector<SharedTensor> parameters, double lr, double momentum, bool nesterov)
+    : Optimizer(std::move(parameters)), lr_(lr), momentum_(momentum), nesterov_(nesterov) {
+  ResetState(momentum_ != 0 ? 1 : 0);
+}
+
+SGD::SGD(ParameterArena arena, double lr, double momentum, bool nesterov)
+    : Optimizer(std::move(arena)), lr_(lr), momentum_(momentum), nesterov_(nesterov) {
+  ResetState(momentum_ != 0 ? 1 : 0);
+}
+
+void SGD::Step() {
+  const SgdCoefficients kCoefficients = {static_cast<Scalar>(lr_), static_cast<Scalar>(momentum_), nesterov_};
+  Scalar *momentum = state_.empty() ? nullptr : State(0);
+  ForEachRange([&](Scalar *data, const Scalar *grad, size_t state, size_t size) {
+    SgdKernel(data, grad, momentum ? momentum + state : nullptr, size, kCoefficients);
+  });
+}
+
+bool SGD::SetState(const std::vector<double> &hyperparameters, const std::vector<SharedTensor> &buffers) {
+  if (hyperparameters.size() != 3 || buffers.size() != (hyperparameters[1] != 0 ? 1 : 0) || !RestoreState(buffers))
+    return false;
+  lr_ = hyperparameters[0];
+  momentum_ = hyperparameters[1];
+  nesterov_ = hyperparameters[2] != 0;
+  return true;
+}
+
+// Adam
+
+Adam::Adam(std::vector<SharedTensor> parameters, double lr, double beta1, double beta2, double eps, double weight_decay)
+    : Optimizer(std::move(parameters)), lr_(lr), beta1_(beta1), beta2_(beta2), eps_(eps), weight_decay_(weight_decay) {
+  ResetState(2);
+}
+
+Adam::Adam(ParameterArena arena, double lr, double beta1, double beta2, double eps, double weight_decay)
+    : Optimizer(std::move(arena)), lr_(lr), beta1_(beta1), beta2_(beta2), eps_(eps), weight_decay_(weight_decay) {
+  ResetState(2);
+}
+
+void Adam::Step() {
+  steps_++;
+  AdamCoefficients coefficients;
+  coefficients.step_size = lr_ / (1 - std::pow(beta1_, steps_));
+  coefficients.beta1 = beta1_;
+  coefficients.beta2 = beta2_;
+  coefficients.one_minus_beta1 = 1 - beta1_;
+  coefficients.one_minus_beta2 = 1 - beta2_;
+  coefficients.inv_bias2 = 1 / std::sqrt(1 - std::pow(beta2_, steps_));
+  coefficients.eps = eps_;
+  coefficients.l2 = decoupled_ ? 0 : weight_decay_;
+  coefficients.decay = decoupled_ ? 1 - lr_ * weight_decay_ : 1;
+
+  Scalar *m = State(0), *v = State(1);
+  ForEachRange([&](Scalar *data, const Scalar *grad, size_t state, size_t size) {
+    AdamKernel(data, grad, m + state, v + state, size, coefficients);
+  });
+}
+
+std::vector<double> Adam::Hyperparameters() const {
+  return {lr_, beta1_, beta2_, eps_, weight_decay_, decoupled_ ? 1. : 0., static_cast<double>(steps_)};
+}
+
+bool Adam::SetState(const std::vector<double> &hyperparameters, const std::vector<SharedTensor> &buffers) {
+  // The stored state must come from the same kind of Adam
+  if (hyperparameters.size() != 7 || (hyperparameters[5] != 0) != decoupled_ || buffers.size() != 2
+      || !RestoreState(buffers))
+    return false;
+  lr_ = hyperparameters[0];
+  beta1_ = hyperparameters[1];
+  beta2_ = hyperparameters[2];
+  eps_ = hyperparameters[3];
+  weight_decay_ = hyperparameters[4];
+  steps_ = static_cast<size_t>(hyperparameters[6]);
+  return true;
+}
+
+}
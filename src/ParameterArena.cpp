@@ -0,0 +1,54 @@
+#include <algorithm>
+
+#include "ParameterArena.hpp"
+
+namespace cpp_tensor {
+
+// Constructors
+
+ParameterArena::ParameterArena(std::vector<SharedTensor> parameters) {
+  Bind(std::move(parameters), nullptr);
+}
+
+ParameterArena::ParameterArena(std::vector<SharedTensor> parameters, const ParameterArena &shared) {
+  if (!Bind(std::move(parameters), &shared))
+    *this = ParameterArena();
+}
+
+void ParameterArena::ZeroGrad() const {
+  std::fill(Grad(), Grad() + Size(), 0);
+}
+
+// Helper function
+
+bool ParameterArena::Bind(std::vector<SharedTensor> parameters, const ParameterArena *shared) {
+  // A parameter shared by several modules is moved once
+  for (auto &p : parameters)
+    if (std::find(parameters_.begin(), parameters_.end(), p) == parameters_.end())
+      parameters_.push_back(std::move(p));
+
+  const size_t kAlignment = kBufferAlignment / sizeof(Scalar);
+  std::vector<size_t> offsets;
+  size_t size = 0;
+  for (auto &p : parameters_) {
+    offsets.push_back(size);
+    size = (size + p->Size() + kAlignment - 1) / kAlignment * kAlignment;
+  }
+  if (shared) {
+    if (shared->parameters_.size() != parameters_.size() || shared->Size() != size)
+      return false;
+    for (size_t i = 0; i < parameters_.size(); i++)
+      if (shared->parameters_[i]->Shape() != parameters_[i]->Shape())
+        return false;
+  }
+  if (size == 0)
+    return true;
+
+  data_ = shared ? shared->data_ : std::make_shared<Storage>(Buffer(size, 0));
+  grad_ = std::make_shared<Storage>(Buffer(size, 0));
+  for (size_t i = 0; i < parameters_.size(); i++)
+    parameters_[i]->MoveToArena(data_, grad_, offsets[i]);
+  return true;
+}
+
+}
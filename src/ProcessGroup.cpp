@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Buffer.hpp"
+#include "ProcessGroup.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+constexpr uint64_t kReady = 0x4350505447525550;  // "CPPTGRUP"
+
+// Time the other processes wait for rank 0 to create the segment
+constexpr auto kJoinTimeout = std::chrono::seconds(30);
+
+size_t RoundUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool ProcessExists(uint64_t pid) {
+  return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+}
+
+}
+
+// The counters live in the segment - atomics on lock-free integers work across processes
+struct ProcessGroup::Header {
+  std::atomic<uint64_t> ready;  // kReady once rank 0 has initialized the segment
+  uint64_t world_size;
+  uint64_t size;
+  uint64_t creator;  // the process id of rank 0 - a segment whose creator has exited is stale
+  alignas(kBufferAlignment) std::atomic<uint64_t> arrivals;  // at barriers, by all processes
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the counters of a process group must be lock-free");
+
+// Constructor and destructor
+
+ProcessGroup::ProcessGroup(const std::string &name, size_t rank, size_t world_size, size_t size)
+    : name_(name), rank_(rank), world_size_(world_size), size_(size) {
+  if (rank >= world_size)
+    return;
+  stride_ = RoundUp(size, kBufferAlignment / sizeof(Scalar));
+  length_ = RoundUp(sizeof(Header), kBufferAlignment) + (world_size + 1) * stride_ * sizeof(Scalar);
+
+  if (rank == 0) {
+    shm_unlink(name.c_str());
+    const int kFd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (kFd < 0)
+      return;
+    void *mapping = ftruncate(kFd, length_) == 0
+        ? mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, kFd, 0) : MAP_FAILED;
+    close(kFd);
+    if (mapping == MAP_FAILED)
+      return;
+    mapping_ = mapping;
+    auto *header = new (mapping) Header();
+    header->world_size = world_size;
+    header->size = size;
+    header->creator = getpid();
+    header->ready.store(kReady, std::memory_order_release);
+    header_ = header;
+    return;
+  }
+
+  // The other processes wait until the segment of a live rank 0 is ready. A segment left by a crashed run
+  // (whose creator no longer exists) is skipped - rank 0 replaces it.
+  const auto kDeadline = std::chrono::steady_clock::now() + kJoinTimeout;
+  while (std::chrono::steady_clock::now() < kDeadline) {
+    const int kFd = shm_open(name.c_str(), O_RDWR, 0600);
+    struct stat st = {};
+    void *mapping = MAP_FAILED;
+    if (kFd >= 0) {
+      if (fstat(kFd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header))
+        mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, kFd, 0);
+      close(kFd);
+    }
+    if (mapping != MAP_FAILED) {
+      auto *header = static_cast<Header *>(mapping);
+      if (header->ready.load(std::memory_order_acquire) == kReady && ProcessExists(header->creator)) {
+        // The group of this name - joined only if it was created for this group size and buffer size
+        if (static_cast<size_t>(st.st_size) == length_ && header->world_size == world_size && header->size == size) {
+          mapping_ = mapping;
+          header_ = header;
+        } else {
+          munmap(mapping, st.st_size);
+        }
+        return;
+      }
+      munmap(mapping, st.st_size);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+ProcessGroup::~ProcessGroup() {
+  if (mapping_)
+    munmap(mapping_, length_);
+  if (rank_ == 0 && mapping_)
+    shm_unlink(name_.c_str());
+}
+
+// Collectives
+
+void ProcessGroup::AllReduce(Scalar *data) {
+  std::copy(data, data + size_, Slot(rank_));
+  Barrier();
+
+  // Reduce-scatter: this process reduces its chunk of every slot (whole cache lines) into the reduced buffer
+  const size_t kChunk = RoundUp((size_ + world_size_ - 1) / world_size_, kBufferAlignment / sizeof(Scalar));
+  const size_t kBegin = std::min(size_, rank_ * kChunk), kEnd = std::min(size_, kBegin + kChunk);
+  Scalar *reduced = Slot(world_size_);
+  const Scalar kScale = Scalar(1) / world_size_;
+  std::copy(Slot(0) + kBegin, Slot(0) + kEnd, reduced + kBegin);
+  for (size_t r = 1; r < world_size_; r++) {
+    const Scalar *kSlot = Slot(r);
+    for (size_t i = kBegin; i < kEnd; i++)
+      reduced[i] += kSlot[i];
+  }
+  for (size_t i = kBegin; i < kEnd; i++)
+    reduced[i] *= kScale;
+  Barrier();
+
+  // All-gather: the reduced buffer is only written again after the first barrier of the next collective,
+  // which every process reaches after this copy
+  std::copy(reduced, reduced + size_, data);
+}
+
+void ProcessGroup::Broadcast(Scalar *data, size_t root) {
+  if (rank_ == root)
+    std::copy(data, data + size_, Slot(root));
+  Barrier();
+  if (rank_ != root)
+    std::copy(Slot(root), Slot(root) + size_, data);
+  Barrier();
+}
+
+void ProcessGroup::Barrier() {
+  const uint64_t kTarget = ++barriers_ * world_size_;
+  header_->arrivals.fetch_add(1, std::memory_order_acq_rel);
+  while (header_->arrivals.load(std::memory_order_acquire) < kTarget)
+    std::this_thread::yield();
+}
+
+// Helper function
+
+Scalar *ProcessGroup::Slot(size_t rank) const {
+  char *slots = static_cast<char *>(mapping_) + RoundUp(sizeof(Header), kBufferAlignment);
+  return reinterpret_cast<Scalar *>(slots) + rank * stride_;
+}
+
+}
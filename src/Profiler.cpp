@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "Buffer.hpp"
+#include "Profiler.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+std::mutex events_mutex;
+std::vector<ProfileEvent> events;
+std::atomic<uint64_t> start_ns{0};  // of the profiler, on the steady clock
+std::atomic<uint32_t> num_threads{0};
+
+uint64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t ThreadId() {
+  thread_local const uint32_t kId = num_threads.fetch_add(1, std::memory_order_relaxed);
+  return kId;
+}
+
+const char *PhaseName(ProfilePhase phase) {
+  return phase == ProfilePhase::kForward ? "forward" : "backward";
+}
+
+// The string as a JSON string literal (quotes, backslashes and control characters escaped)
+std::string JsonString(const std::string &value) {
+  std::string res = "\"";
+  for (char c : value) {
+    if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+      res += escaped;
+      continue;
+    }
+    if (c == '"' || c == '\\')
+      res += '\\';
+    res += c;
+  }
+  return res + '"';
+}
+
+void AppendShape(std::string &shapes, const Dims &shape) {
+  if (!shapes.empty())
+    shapes += ' ';
+  shapes += '[';
+  for (size_t d = 0; d < shape.size(); d++) {
+    if (d > 0)
+      shapes += ", ";
+    shapes += std::to_string(shape[d]);
+  }
+  shapes += ']';
+}
+
+}
+
+// Control
+
+void StartProfiler() {
+  std::lock_guard<std::mutex> lock(events_mutex);
+  events.clear();
+  start_ns.store(NowNs(), std::memory_order_relaxed);
+  ProfileScope::enabled_.store(true, std::memory_order_release);
+}
+
+void StopProfiler() {
+  ProfileScope::enabled_.store(false, std::memory_order_release);
+}
+
+// Results
+
+std::vector<ProfileEvent> GetProfileEvents() {
+  std::lock_guard<std::mutex> lock(events_mutex);
+  return events;
+}
+
+std::vector<ProfileSummaryRow> GetProfileSummary() {
+  std::map<std::pair<std::string, ProfilePhase>, ProfileSummaryRow> rows;
+  for (auto &event : GetProfileEvents()) {
+    ProfileSummaryRow &row = rows[{event.op, event.phase}];
+    row.op = event.op;
+    row.phase = event.phase;
+    row.calls++;
+    row.total_ns += event.duration_ns;
+    row.bytes_allocated += event.bytes_allocated;
+  }
+  std::vector<ProfileSummaryRow> summary;
+  for (auto &[key, row] : rows)
+    summary.push_back(row);
+  std::stable_sort(summary.begin(), summary.end(), [](const ProfileSummaryRow &a, const ProfileSummaryRow &b) {
+    return a.total_ns > b.total_ns;
+  });
+  return summary;
+}
+
+void PrintProfileSummary(std::ostream &out) {
+  const std::vector<ProfileSummaryRow> kSummary = GetProfileSummary();
+  uint64_t total_ns = 0;
+  for (auto &row : kSummary)
+    total_ns += row.total_ns;
+
+  const auto kFlags = out.flags();
+  const auto kPrecision = out.precision();
+  out << std::left << std::setw(14) << "op" << std::setw(10) << "phase" << std::right << std::setw(10) << "calls"
+      << std::setw(12) << "total ms" << std::setw(12) << "mean us" << std::setw(8) << "%" << std::setw(14)
+      << "KB allocated" << '\n';
+  out << std::fixed;
+  for (auto &row : kSummary) {
+    out << std::left << std::setw(14) << row.op << std::setw(10) << PhaseName(row.phase) << std::right
+        << std::setw(10) << row.calls << std::setprecision(3) << std::setw(12) << row.total_ns * 1e-6
+        << std::setw(12) << row.total_ns * 1e-3 / row.calls << std::setprecision(1) << std::setw(8)
+        << (total_ns ? 100. * row.total_ns / total_ns : 0.) << std::setw(14) << row.bytes_allocated / 1024. << '\n';
+  }
+  out.flags(kFlags);
+  out.precision(kPrecision);
+}
+
+bool SaveChromeTrace(const std::string &path) {
+  const std::vector<ProfileEvent> kEvents = GetProfileEvents();
+  std::ofstream file(path);
+  file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::fixed << std::setprecision(3);
+  for (size_t e = 0; e < kEvents.size(); e++) {
+    // Complete events ("X"), with times in microseconds
+    const ProfileEvent &kEvent = kEvents[e];
+    file << (e == 0 ? "\n" : ",\n") << "{\"name\": " << JsonString(kEvent.op) << ", \"cat\": \""
+         << PhaseName(kEvent.phase) << "\", \"ph\": \"X\", \"ts\": " << kEvent.start_ns * 1e-3 << ", \"dur\": "
+         << kEvent.duration_ns * 1e-3 << ", \"pid\": 0, \"tid\": " << kEvent.thread << ", \"args\": {\"shapes\": " << JsonString(kEvent.shapes)
+         << ", \"bytes_allocated\": " << kEvent.bytes_allocated << "}}";
+  }
+  file << "\n]}\n";
+  return file.good();
+}
+
+// ProfileScope - Helper functions
+
+struct ProfileScope::Record {
+  ProfileEvent event;
+  size_t start_bytes;
+};
+
+std::string ProfileScope::Shapes(std::initializer_list<const InternalTensor *> inputs) {
+  std::string shapes;
+  for (auto *input : inputs)
+    AppendShape(shapes, input->Shape());
+  return shapes;
+}
+
+std::string ProfileScope::Shapes(const ParentList &inputs) {
+  std::string shapes;
+  for (auto &input : inputs)
+    AppendShape(shapes, input->Shape());
+  return shapes;
+}
+
+void ProfileScope::Begin(const char *op, ProfilePhase phase, std::string shapes) {
+  record_ = new Record{{op ? op : "unknown", phase, std::move(shapes), 0, 0, 0, ThreadId()}, ThreadAllocatedBytes()};
+  record_->event.start_ns = NowNs();
+}
+
+void ProfileScope::End() {
+  const uint64_t kEnd = NowNs();
+  const uint64_t kStart = start_ns.load(std::memory_order_relaxed);
+  ProfileEvent &event = record_->event;
+  event.duration_ns = kEnd - event.start_ns;
+  event.start_ns = event.start_ns > kStart ? event.start_ns - kStart : 0;
+  event.bytes_allocated = ThreadAllocatedBytes() - record_->start_bytes;
+  {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.push_back(std::move(event));
+  }
+  delete record_;
+}
+
+}
@@ -0,0 +1,30 @@
+#include <atomic>
+
+#include "Storage.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+std::atomic<size_t> current_bytes{0};
+std::atomic<size_t> peak_bytes{0};
+
+}
+
+// Memory statistics
+
+GraphMemoryStats GetGraphMemoryStats() {
+  return {current_bytes.load(std::memory_order_relaxed), peak_bytes.load(std::memory_order_relaxed)};
+}
+
+void ResetPeakGraphMemory() {
+  peak_bytes.store(current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void TrackGraphMemory(std::ptrdiff_t bytes) {
+  const size_t kCurrent = current_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  size_t peak = peak_bytes.load(std::memory_order_relaxed);
+  while (kCurrent > peak && !peak_bytes.compare_exchange_weak(peak, kCurrent, std::memory_order_relaxed)) {}
+}
+
+}
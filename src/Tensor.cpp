@@ -1,54 +1,44 @@
 #include <random>
 #include <utility>
 
+#include "Fusion.hpp"
 #include "Tensor.hpp"
 
 namespace cpp_tensor {
 
 // Constructors
 
-Tensor::Tensor(double value, bool requires_grad) {
-  tensor_ = std::make_shared<InternalTensor>(std::vector<double>({value}), std::vector<size_t>(), requires_grad, true);
-  CalculateStrides();
+Tensor::Tensor(Scalar value, bool requires_grad) {
+  tensor_ = MakeTensor(Buffer({value}), Dims(), requires_grad, true);
 }
 
-Tensor::Tensor(std::vector<double> values, bool requires_grad) {
-  tensor_ =
-      std::make_shared<InternalTensor>(std::move(values), std::vector<size_t>({values.size()}), requires_grad, true);
-  CalculateStrides();
+Tensor::Tensor(std::vector<Scalar> values, bool requires_grad) {
+  tensor_ = MakeTensor(Buffer(values.begin(), values.end()), Dims({values.size()}), requires_grad, true);
 }
 
-Tensor::Tensor(std::vector<double> values, std::vector<size_t> shape, bool requires_grad) {
-  tensor_ = std::make_shared<InternalTensor>(std::move(values), std::move(shape), requires_grad, true);
-  CalculateStrides();
+Tensor::Tensor(std::vector<Scalar> values, std::vector<size_t> shape, bool requires_grad) {
+  tensor_ = MakeTensor(Buffer(values.begin(), values.end()), Dims(shape.begin(), shape.end()), requires_grad, true);
 }
 
-Tensor::Tensor(double value, std::vector<size_t> shape, bool requires_grad) {
+Tensor::Tensor(Scalar value, std::vector<size_t> shape, bool requires_grad) {
   size_t size = 1;
-  std::vector<double> values;
   for (auto &s : shape)
     size *= s;
-
-  values.reserve(size);
-  for (int i = 0; i < size; i++)
-    values.push_back(value);
-  tensor_ = std::make_shared<InternalTensor>(values, std::move(shape), requires_grad, true);
-  CalculateStrides();
+  tensor_ = MakeTensor(Buffer(size, value), Dims(shape.begin(), shape.end()), requires_grad, true);
 }
 
-Tensor::Tensor(SharedTensor &&tensor) : tensor_(std::move(tensor)) {
-  CalculateStrides();
-}
+Tensor::Tensor(SharedTensor &&tensor) : tensor_(std::move(tensor)) {}
 
 // Static functions
 
 Tensor Tensor::Concat(const std::vector<Tensor> &tensors) {
-  std::vector<double> data;
-  for (auto &kT : tensors)
-    data.insert(data.end(), kT.tensor_->data_.begin(), kT.tensor_->data_.end());
-  std::vector<size_t> shape = {tensors.size()};
+  const size_t kSize = tensors.begin()->Size();
+  Buffer data(tensors.size() * kSize);
+  for (size_t i = 0; i < tensors.size(); i++)
+    tensors[i].tensor_->CopyTo(data.data() + i * kSize);
+  Dims shape = {tensors.size()};
   shape.insert(shape.end(), tensors.begin()->tensor_->shape_.begin(), tensors.begin()->tensor_->shape_.end());
-  return Tensor(data, shape);
+  return Tensor(MakeTensor(std::move(data), std::move(shape), false, true));
 }
 
 std::array<Tensor, 4> Tensor::TrainTestSplit(const Tensor &x, const Tensor &y, double ratio) {
@@ -78,55 +68,58 @@ std::array<Tensor, 4> Tensor::TrainTestSplit(const Tensor &x, const Tensor &y, d
 
 // Data access
 
-double Tensor::Value(const std::vector<int> &indices) const {
-  int index = 0;
-  for (int i = 0; i < indices.size(); i++)
-    index += indices[i] * strides_[i];
-  return tensor_->data_[index];
+Scalar Tensor::Value(const std::vector<int> &indices) const {
+  size_t index = 0;
+  for (size_t i = 0; i < indices.size(); i++)
+    index += indices[i] * tensor_->strides_[i];
+  return tensor_->DataPtr()[index];
 }
 
 Tensor Tensor::ValueTensor(const std::vector<int> &indices) const {
-  int index = 0;
-  for (int i = 0; i < indices.size(); i++)
-    index += indices[i] * strides_[i];
+  return Tensor(SelectInternal(tensor_, Dims(indices.begin(), indices.end())));
+}
 
-  std::vector<size_t> shape_t;
-  if (indices.size() == tensor_->shape_.size())
-    shape_t = {1};
-  else
-    shape_t = std::vector<size_t>(tensor_->shape_.begin() + indices.size(), tensor_->shape_.end());
+// Views
 
-  int next_id = index + strides_[indices.size() - 1];
-  const std::vector<double> kTensorT(tensor_->data_.begin() + index, tensor_->data_.begin() + next_id);
-  return Tensor(kTensorT, shape_t);
+Tensor Tensor::Slice(size_t dim, size_t begin, size_t end) const &{
+  return Tensor(SliceInternal(tensor_, dim, begin, end));
 }
 
-// Tensor operations
+Tensor Tensor::Transpose(size_t dim0, size_t dim1) const &{
+  return Tensor(TransposeInternal(tensor_, dim0, dim1));
+}
 
-void Tensor::Backward(bool retain_graph) {
-  tensor_->SetGrad(1);
-  tensor_->Backward(retain_graph);
+Tensor Tensor::Reshape(std::vector<size_t> new_shape) const &{
+  return Tensor(ReshapeInternal(tensor_, Dims(new_shape.begin(), new_shape.end())));
 }
 
-Tensor Tensor::Reshape(std::vector<size_t> new_shape) {
-  tensor_->shape_ = std::move(new_shape);
-  CalculateStrides();
-  return *this;
+Tensor Tensor::Flatten() const &{
+  return Tensor(ReshapeInternal(tensor_, {Size()}));
 }
 
-Tensor Tensor::Flatten() {
-  tensor_->shape_ = {Size()};
-  CalculateStrides();
-  return *this;
+Tensor Tensor::Contiguous() const &{
+  return Tensor(ContiguousInternal(tensor_));
+}
+
+// Tensor operations
+
+void Tensor::Backward(bool retain_graph) {
+  tensor_->SetGrad(1);
+  tensor_->Backward(retain_graph);
 }
 
 Tensor Tensor::Clone(bool deep_copy) const &{
   if (!deep_copy)
     return Tensor(SharedTensor(tensor_));
-  return Tensor(tensor_->data_, tensor_->shape_, tensor_->requires_grad_);
+  Buffer data(Size());
+  tensor_->CopyTo(data.data());
+  return Tensor(MakeTensor(std::move(data), tensor_->shape_, tensor_->requires_grad_, true));
 }
 
 // Mathematical operations
+// The elementwise kernels read their inputs densely, so views that are not contiguous are copied first
+// (ContiguousInternal returns contiguous tensors unchanged). Matmul reads strided views in place.
+// In lazy mode the elementwise operations and reductions are recorded for fusion instead.
 
 Tensor Tensor::operator+(const Tensor &other) const &{
   // The implementation of this function is slightly different compared to other operators.
@@ -135,82 +128,90 @@ Tensor Tensor::operator+(const Tensor &other) const &{
   // (I could implement such functionality for other functions and rename them,
   // but for now it is used only for adding the bias.)
   // Additionally, note that if one tensor has a Size of 1, it does not matter which function is called.
+  if (InternalTensor::lazy_)
+    return Tensor(FusedBinary(FusedOp::kAdd, tensor_, other.tensor_));
+  const SharedTensor kA = ContiguousInternal(tensor_), kB = ContiguousInternal(other.tensor_);
 
   if (other.Size() == 1)
-    return Tensor(AddManyOneInternal(this->tensor_, other.tensor_));
+    return Tensor(AddManyOneInternal(kA, kB));
   if (this->Size() == 1)
-    return Tensor(AddManyOneInternal(other.tensor_, this->tensor_));
+    return Tensor(AddManyOneInternal(kB, kA));
   if (this->NumDimensions() > other.NumDimensions())
-    return Tensor(AddBiasInternal(tensor_, other.tensor_));
+    return Tensor(AddBiasInternal(kA, kB));
   if (this->NumDimensions() < other.NumDimensions())
-    return Tensor(AddBiasInternal(other.tensor_, tensor_));
+    return Tensor(AddBiasInternal(kB, kA));
 
-  return AddManyManyInternal(this->tensor_, other.tensor_);
+  return AddManyManyInternal(kA, kB);
 }
 
 Tensor Tensor::operator-(const Tensor &other) const &{
+  if (InternalTensor::lazy_)
+    return Tensor(FusedBinary(FusedOp::kAdd, tensor_, FusedUnary(FusedOp::kScale, other.tensor_, -1)));
+  const SharedTensor kA = ContiguousInternal(tensor_), kB = ContiguousInternal(other.tensor_);
+
   if (other.Size() == 1)
-    return Tensor(AddManyOneInternal(this->tensor_, OppositeInternal(other.tensor_)));
+    return Tensor(AddManyOneInternal(kA, OppositeInternal(kB)));
   if (this->Size() == 1)
-    return Tensor(AddManyOneInternal(OppositeInternal(other.tensor_), this->tensor_));
+    return Tensor(AddManyOneInternal(OppositeInternal(kB), kA));
 
-  return AddManyManyInternal(this->tensor_, OppositeInternal(other.tensor_));
+  return AddManyManyInternal(kA, OppositeInternal(kB));
 }
 
 Tensor Tensor::operator*(const Tensor &other) const &{
+  if (InternalTensor::lazy_)
+    return Tensor(FusedBinary(FusedOp::kMultiply, tensor_, other.tensor_));
+  const SharedTensor kA = ContiguousInternal(tensor_), kB = ContiguousInternal(other.tensor_);
+
   if (other.Size() == 1)
-    return Tensor(MultiplyManyOneInternal(this->tensor_, other.tensor_));
+    return Tensor(MultiplyManyOneInternal(kA, kB));
   if (this->Size() == 1)
-    return Tensor(MultiplyManyOneInternal(other.tensor_, this->tensor_));
+    return Tensor(MultiplyManyOneInternal(kB, kA));
 
-  return MultiplyManyManyInternal(this->tensor_, other.tensor_);
+  return MultiplyManyManyInternal(kA, kB);
 }
 
 Tensor Tensor::operator/(const Tensor &other) const &{
+  if (InternalTensor::lazy_)
+    return Tensor(FusedBinary(FusedOp::kMultiply, tensor_, FusedUnary(FusedOp::kPow, other.tensor_, 1, -1)));
+  const SharedTensor kA = ContiguousInternal(tensor_), kB = ContiguousInternal(other.tensor_);
+
   if (other.Size() == 1)
-    return Tensor(MultiplyManyOneInternal(this->tensor_, InverseInternal(other.tensor_)));
+    return Tensor(MultiplyManyOneInternal(kA, InverseInternal(kB)));
   if (this->Size() == 1)
-    return Tensor(MultiplyManyOneInternal(InverseInternal(other.tensor_), this->tensor_));
+    return Tensor(MultiplyManyOneInternal(InverseInternal(kB), kA));
 
-  return MultiplyManyManyInternal(this->tensor_, InverseInternal(other.tensor_));
+  return MultiplyManyManyInternal(kA, InverseInternal(kB));
 }
 
 Tensor Tensor::Matmul(const Tensor &other) const &{
-  return Tensor(MatmulInternal(this->tensor_, other.tensor_)); // this-> ? czm
+  return Tensor(MatmulInternal(this->tensor_, other.tensor_));
 }
 
 Tensor Tensor::Sum() const &{
-  return Tensor(SumInternal(tensor_));
+  if (InternalTensor::lazy_)
+    return Tensor(FusedSum(tensor_));
+  return Tensor(SumInternal(ContiguousInternal(tensor_)));
 }
 
 Tensor Tensor::Mean() const &{
-  return Tensor(MultiplyManyOneInternal(SumInternal(tensor_),
-                                        std::make_shared<InternalTensor>(
-                                            std::vector<double>({1.0 / Size()}), std::vector<size_t>({}))));
+  if (InternalTensor::lazy_)
+    return Tensor(FusedSum(tensor_, Scalar(1.0 / Size())));
+  return Tensor(MultiplyManyOneInternal(SumInternal(ContiguousInternal(tensor_)),
+                                        MakeTensor(Buffer({Scalar(1.0 / Size())}), Dims())));
 }
 
 Tensor Tensor::Pow(int exponent) const &{
-  return Tensor(PowInternal(tensor_, exponent));
+  if (InternalTensor::lazy_)
+    return Tensor(FusedUnary(FusedOp::kPow, tensor_, 1, exponent));
+  return Tensor(PowInternal(ContiguousInternal(tensor_), exponent));
 }
 
 // Activation functions
 
 Tensor Tensor::Relu(double leaky) const &{
-  return Tensor(ReluInternal(tensor_, leaky));
-}
-
-// Helper function
-
-void Tensor::CalculateStrides() {
-  size_t stride = 1;
-  for (int i = tensor_->shape_.size() - 1; i >= 0; --i) {
-    strides_.push_back(stride);
-    stride *= tensor_->shape_[i];
-  }
-
-  std::reverse(strides_.begin(), strides_.end());
-  if (strides_.empty())
-    strides_ = {1};
+  if (InternalTensor::lazy_)
+    return Tensor(FusedUnary(FusedOp::kRelu, tensor_, leaky));
+  return Tensor(ReluInternal(ContiguousInternal(tensor_), leaky));
 }
 
 }
\ No newline at end of file
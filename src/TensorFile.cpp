@@ -0,0 +1,122 @@
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TensorFile.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+TensorFileHeader MakeHeader(const std::vector<size_t> &shape) {
+  TensorFileHeader header = {};
+  std::memcpy(header.magic, kTensorFileMagic, sizeof(header.magic));
+  header.version = kTensorFileVersion;
+  header.dtype = static_cast<uint8_t>(kDType);
+  header.num_dims = shape.size();
+  for (size_t d = 0; d < shape.size(); d++)
+    header.shape[d] = shape[d];
+  header.data_offset = kTensorFileAlignment;
+  return header;
+}
+
+}
+
+// TensorFileWriter
+
+TensorFileWriter::TensorFileWriter(const std::string &path, std::vector<size_t> row_shape)
+    : row_shape_(std::move(row_shape)) {
+  if (row_shape_.size() + 1 > kMaxTensorFileDims)
+    return;
+  for (auto &s : row_shape_)
+    row_size_ *= s;
+
+  // The header is completed by Close(), the elements start after the padding
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  const std::vector<char> kPadding(kTensorFileAlignment, 0);
+  file_.write(kPadding.data(), kPadding.size());
+}
+
+void TensorFileWriter::AppendRows(const Scalar *rows, size_t count) {
+  file_.write(reinterpret_cast<const char *>(rows), count * row_size_ * sizeof(Scalar));
+  num_rows_ += count;
+}
+
+bool TensorFileWriter::Close() {
+  if (!file_.is_open())
+    return false;
+  std::vector<size_t> shape = {num_rows_};
+  shape.insert(shape.end(), row_shape_.begin(), row_shape_.end());
+  const TensorFileHeader kHeader = MakeHeader(shape);
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char *>(&kHeader), sizeof(kHeader));
+  const bool kGood = file_.good();
+  file_.close();
+  return kGood;
+}
+
+bool WriteTensorFile(const std::string &path, const Tensor &tensor) {
+  // A 0D tensor is written as a single row
+  const std::vector<size_t> kShape = tensor.Shape();
+  const size_t kRows = kShape.empty() ? 1 : kShape[0];
+  TensorFileWriter writer(path, std::vector<size_t>(kShape.begin() + (kShape.empty() ? 0 : 1), kShape.end()));
+  if (!writer.IsOpen())
+    return false;
+
+  Buffer data(tensor.Size());
+  tensor.GetTensor()->CopyTo(data.data());
+  writer.AppendRows(data.data(), kRows);
+  return writer.Close();
+}
+
+// MappedDataset
+
+MappedDataset::MappedDataset(const std::string &path) {
+  const int kFd = open(path.c_str(), O_RDONLY);
+  if (kFd < 0)
+    return;
+  struct stat st = {};
+  TensorFileHeader header = {};
+  const bool kReadable = fstat(kFd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(header)
+      && pread(kFd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+
+  // The elements must lie within the file - every partial product of the shape is bounded by its length,
+  // so that a crafted shape cannot overflow
+  const size_t kFileLength = kReadable ? st.st_size : 0;
+  size_t size = 1;
+  bool fits = kReadable && header.data_offset <= kFileLength;
+  for (size_t d = 0; fits && d < header.num_dims && d < kMaxTensorFileDims; d++) {
+    fits = header.shape[d] <= kFileLength && (header.shape[d] == 0 || size <= kFileLength / header.shape[d]);
+    size *= fits ? header.shape[d] : 1;
+  }
+  const bool kValid = fits && std::memcmp(header.magic, kTensorFileMagic, sizeof(header.magic)) == 0
+      && header.version == kTensorFileVersion && header.dtype == static_cast<uint8_t>(kDType)
+      && header.num_dims >= 1 && header.num_dims <= kMaxTensorFileDims
+      && header.data_offset % kTensorFileAlignment == 0
+      && size <= (kFileLength - header.data_offset) / sizeof(Scalar);
+  if (!kValid) {
+    close(kFd);
+    return;
+  }
+
+  // The mapping stays valid after the descriptor is closed, and lives as long as the storage referencing it
+  const size_t kLength = header.data_offset + size * sizeof(Scalar);
+  void *mapping = mmap(nullptr, kLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, kFd, 0);
+  close(kFd);
+  if (mapping == MAP_FAILED)
+    return;
+  std::shared_ptr<void> owner(mapping, [kLength](void *p) { munmap(p, kLength); });
+
+  Scalar *elements = reinterpret_cast<Scalar *>(static_cast<char *>(mapping) + header.data_offset);
+  Dims shape(header.shape, header.shape + header.num_dims);
+  Dims strides = InternalTensor::ContiguousStrides(shape);
+  data_ = Tensor(MakeTensor(std::make_shared<Storage>(elements, size, std::move(owner)), 0,
+                            std::move(shape), std::move(strides)));
+  is_open_ = true;
+}
+
+}
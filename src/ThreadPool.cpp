@@ -0,0 +1,181 @@
+#include <cstdlib>
+#include <memory>
+
+#include <pthread.h>
+
+#include "Buffer.hpp"
+#include "ThreadPool.hpp"
+
+namespace cpp_tensor {
+
+namespace {
+
+thread_local bool in_parallel_region = false;
+
+std::mutex global_mutex;
+std::shared_ptr<ThreadPool> global_pool;
+std::atomic<size_t> num_threads{0};  // 0 means "not configured yet"
+// Incremented whenever global_pool is replaced, which invalidates the pools cached by the threads
+std::atomic<size_t> global_version{0};
+
+// Each thread keeps the last global pool it used, so that looking it up takes no lock
+thread_local std::shared_ptr<ThreadPool> cached_pool;
+thread_local size_t cached_version = 0;
+
+// In a forked child only the forking thread exists, so the inherited pool has no workers: it is leaked (joining
+// its threads or destroying its mutexes is undefined) and the next Global() creates a new one. global_mutex is
+// held across fork, so that the child never inherits it locked.
+void LockBeforeFork() {
+  global_mutex.lock();
+}
+
+void UnlockAfterFork() {
+  global_mutex.unlock();
+}
+
+void ResetPoolInChild() {
+  if (global_pool)
+    new std::shared_ptr<ThreadPool>(std::move(global_pool));
+  if (cached_pool)
+    new std::shared_ptr<ThreadPool>(std::move(cached_pool));
+  global_version++;
+  global_mutex.unlock();
+}
+
+const int kAtFork = pthread_atfork(LockBeforeFork, UnlockAfterFork, ResetPoolInChild);
+
+size_t DefaultNumThreads() {
+  if (const char *env = std::getenv("CPPTENSOR_NUM_THREADS")) {
+    long value = std::strtol(env, nullptr, 10);
+    if (value > 0)
+      return value;
+  }
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+}
+
+// Number of threads
+
+void SetNumThreads(size_t threads) {
+  num_threads = std::max<size_t>(1, threads);
+}
+
+size_t GetNumThreads() {
+  size_t threads = num_threads.load(std::memory_order_relaxed);
+  if (threads == 0) {
+    size_t expected = 0;
+    threads = DefaultNumThreads();
+    if (!num_threads.compare_exchange_strong(expected, threads))
+      threads = expected;
+  }
+  return threads;
+}
+
+// ThreadPool - Constructor and destructor
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  for (size_t i = 1; i < num_threads; i++)
+    workers_.emplace_back([this] { WorkerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto &worker : workers_)
+    worker.join();
+}
+
+// ThreadPool - Running a parallel region
+
+void ThreadPool::Run(size_t num_tasks, const std::function<void(size_t)> &task) {
+  std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+  if (workers_.empty() || num_tasks <= 1 || in_parallel_region || !run_lock.owns_lock()) {
+    for (size_t i = 0; i < num_tasks; i++)
+      task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    worker_allocated_bytes_ = 0;
+    active_workers_ = workers_.size();
+    generation_++;
+  }
+  start_cv_.notify_all();
+
+  RunTasks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return active_workers_ == 0; });
+  task_ = nullptr;
+  // The buffers allocated by the workers count for the thread that ran the region (see ThreadAllocatedBytes)
+  ChargeThreadAllocatedBytes(worker_allocated_bytes_);
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::Global() {
+  const size_t kThreads = GetNumThreads();
+  // Threads of a pool never cache it, since their cached pointer could keep their own pool alive
+  if (!in_parallel_region && cached_pool && cached_version == global_version.load(std::memory_order_acquire)
+      && cached_pool->NumThreads() == kThreads)
+    return cached_pool;
+
+  std::shared_ptr<ThreadPool> pool;
+  size_t version;
+  {
+    std::lock_guard<std::mutex> lock(global_mutex);
+    if (!global_pool || global_pool->NumThreads() != kThreads) {
+      global_pool = std::make_shared<ThreadPool>(kThreads);
+      global_version++;
+    }
+    pool = global_pool;
+    version = global_version.load(std::memory_order_relaxed);
+  }
+  if (!in_parallel_region) {
+    cached_pool = pool;
+    cached_version = version;
+  }
+  return pool;
+}
+
+bool ThreadPool::InParallelRegion() {
+  return in_parallel_region;
+}
+
+// ThreadPool - Helper functions
+
+void ThreadPool::WorkerLoop() {
+  size_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+      if (stop_)
+        return;
+      seen_generation = generation_;
+    }
+
+    const size_t kAllocatedBytes = ThreadAllocatedBytes();
+    RunTasks();
+    worker_allocated_bytes_ += ThreadAllocatedBytes() - kAllocatedBytes;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_workers_ == 0)
+      done_cv_.notify_one();
+  }
+}
+
+void ThreadPool::RunTasks() {
+  in_parallel_region = true;
+  for (size_t i = next_task_++; i < num_tasks_; i = next_task_++)
+    (*task_)(i);
+  in_parallel_region = false;
+}
+
+}
@@ -182,6 +182,103 @@ bool test_reference_counting_behavior() {
     return std::abs(grad - expected_grad) < EPSILON;
 }
 
+bool test_matmul_backward() {
+    auto a = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}, {2, 3}, true);
+    auto b = Tensor({1.0, -1.0, 2.0, 0.5, -2.0, 1.0}, {3, 2}, true);
+    auto z = a.Matmul(b).Sum();
+
+    z.Backward();
+
+    // dA = 1 * B^T (row sums of B), dB = A^T * 1 (column sums of A)
+    const double expected_a[] = {0.0, 2.5, -1.0, 0.0, 2.5, -1.0};
+    const double expected_b[] = {5.0, 5.0, 7.0, 7.0, 9.0, 9.0};
+    bool pass = true;
+    for (int i = 0; i < 6; i++)
+        pass = pass && std::abs(a.GetTensor()->Grad(i) - expected_a[i]) < EPSILON
+                    && std::abs(b.GetTensor()->Grad(i) - expected_b[i]) < EPSILON;
+    return pass;
+}
+
+bool test_power_at_zero() {
+    auto x = Tensor({0.0, 3.0}, true);
+    auto z = x.Pow(2).Sum();
+
+    z.Backward();
+
+    return std::abs(x.GetTensor()->Grad(0) - 0.0) < EPSILON && std::abs(x.GetTensor()->Grad(1) - 6.0) < EPSILON;
+}
+
+bool test_deep_graph() {
+    // Long enough to overflow the stack with a recursive Backward or a recursive destruction of the graph
+    auto x = Tensor(1.0, true);
+    auto y = x;
+    for (int i = 0; i < 200000; i++)
+        y = y + Tensor(1.0);
+    y.Backward();
+
+    auto z = x;
+    for (int i = 0; i < 200000; i++)
+        z = z * Tensor(1.0);
+    z = Tensor();  // released without a Backward pass
+
+    return std::abs(x.GetTensor()->Grad(0) - 1.0) < EPSILON;
+}
+
+bool test_unused_branch() {
+    auto p = Tensor(1.5, true);
+    auto x = p * Tensor(2.0);
+    auto y = x * Tensor(3.0);
+    auto unused = x + Tensor(1.0);  // a child of x that does not lead to y
+
+    y.Backward();
+
+    return std::abs(p.GetTensor()->Grad(0) - 6.0) < EPSILON;
+}
+
+bool test_graph_memory_released() {
+    const size_t kSize = 1 << 16;
+    const size_t kBefore = GetGraphMemoryStats().current_bytes;
+    bool pass;
+    {
+        auto x = Tensor(1.0, {kSize}, true);
+        const size_t kLeaf = GetGraphMemoryStats().current_bytes;
+        ResetPeakGraphMemory();
+
+        auto loss = ((x * x + x) * x).Pow(2).Sum();
+        const size_t kForward = GetGraphMemoryStats().current_bytes;
+        loss.Backward();
+
+        // Four intermediate activations are alive after the Forward pass, and only the leaf's gradient
+        // (and the loss) after the Backward pass
+        const auto kStats = GetGraphMemoryStats();
+        pass = kForward >= kLeaf + 4 * kSize * sizeof(Scalar)
+            && kStats.current_bytes <= kLeaf + kSize * sizeof(Scalar) + 64
+            && kStats.peak_bytes >= kForward && std::abs(x.GetTensor()->Grad(0) - 20.0) < EPSILON;
+    }
+    return pass && GetGraphMemoryStats().current_bytes == kBefore;
+}
+
+bool test_accumulate_across_passes() {
+    // Gradients are created by the first pass and accumulated into by the second one
+    auto x = Tensor({1.0, -2.0, 3.0}, true);
+    auto w = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}, {3, 2}, true);
+    for (int pass = 0; pass < 2; pass++) {
+        auto loss = (x * x).Relu(0.1) + x.Pow(3);
+        (loss.Sum() + x.Reshape({1, 3}).Matmul(w).Sum()).Backward();
+    }
+
+    // d/dx = 2 * (2x + 3x^2 + row sums of w), d/dw = 2 * x (repeated over the columns)
+    const std::vector<double> kXGrad = {2 * (5 + 3), 2 * (8 + 7), 2 * (33 + 11)};
+    const std::vector<double> kWGrad = {2, 2, -4, -4, 6, 6};
+    for (size_t i = 0; i < kXGrad.size(); i++)
+        if (std::abs(x.GetTensor()->Grad(i) - kXGrad[i]) > EPSILON)
+            return false;
+    for (size_t i = 0; i < kWGrad.size(); i++)
+        if (std::abs(w.GetTensor()->Grad(i) - kWGrad[i]) > EPSILON)
+            return false;
+    return true;
+}
+
 int main() {
     struct Test {
         std::string name;
@@ -201,7 +298,13 @@ int main() {
         {"Multiple backward passes with retain_graph", test_retain_graph_multiple_backward},
         {"Counting backward operations", test_non_additive_side_effect},
         {"Gradient clearing with shared tensors", test_gradient_clearing_issue},
-        {"Reference counting behavior", test_reference_counting_behavior}
+        {"Reference counting behavior", test_reference_counting_behavior},
+        {"Matmul backward (dA = dC*B^T, dB = A^T*dC)", test_matmul_backward},
+        {"Power gradient at zero (y = x^2, x = 0)", test_power_at_zero},
+        {"Deep graph (200000 nodes)", test_deep_graph},
+        {"Child that does not lead to the output", test_unused_branch},
+        {"Graph memory released by Backward", test_graph_memory_released},
+        {"Gradients accumulated across Backward passes", test_accumulate_across_passes}
     };
 
     int passed = 0;
@@ -0,0 +1,121 @@
+// Test to verify that the caching allocator recycles tensor buffers and keeps its statistics
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Buffer.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+bool test_reuse_and_stats() {
+    EmptyBufferCache();
+    const BufferCacheStats kStart = GetBufferCacheStats();
+
+    auto *buffer = new Buffer(100);  // 100 elements round up to the next power of two bytes
+    const size_t kBytes = 128 * sizeof(Scalar);
+    const BufferCacheStats kAllocated = GetBufferCacheStats();
+    delete buffer;
+    const BufferCacheStats kFreed = GetBufferCacheStats();
+    Buffer reused(120);
+    const BufferCacheStats kReused = GetBufferCacheStats();
+    EmptyBufferCache();
+
+    return kAllocated.bytes_in_use == kStart.bytes_in_use + kBytes && kAllocated.misses == kStart.misses + 1
+        && kFreed.bytes_in_use == kStart.bytes_in_use && kFreed.bytes_cached == kBytes
+        && kReused.hits == kStart.hits + 1 && kReused.bytes_cached == 0
+        && kReused.peak_bytes_in_use >= kStart.bytes_in_use + kBytes
+        && GetBufferCacheStats().bytes_cached == 0;
+}
+
+bool test_alignment() {
+    for (size_t size : {1, 3, 17, 1000, 4097}) {
+        Tensor t(random_values(size, 1), std::vector<size_t>{size});
+        auto sum = (t + t).Sum();
+        for (auto &tensor : {t, t + t, sum})
+            if (reinterpret_cast<std::uintptr_t>(tensor.GetTensor()->DataPtr()) % kBufferAlignment != 0)
+                return false;
+    }
+    return true;
+}
+
+bool steady_state_hits_cache(bool lazy) {
+    Sequential model;
+    model.AddModule<LinearLayer>(4, 16);
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(16, 2);
+    SGD optimizer(model.Parameters(), 1e-3);
+    MSELoss criterion;
+    Tensor x(random_values(256, 1), {64, 4}), y(random_values(128, 2), {64, 2});
+
+    Tensor::SetLazy(lazy);
+    auto step = [&] {
+        criterion(model(x), y).Backward();
+        optimizer.Step();
+        optimizer.ZeroGrad();
+    };
+
+    // (The parameters have no gradients during the first step, from the second one on they hold them throughout)
+    step();
+    step();
+    const BufferCacheStats kBefore = GetBufferCacheStats();
+    for (int i = 0; i < 10; i++)
+        step();
+    const BufferCacheStats kAfter = GetBufferCacheStats();
+    Tensor::SetLazy(false);
+
+    return kAfter.misses == kBefore.misses && kAfter.hits > kBefore.hits
+        && kAfter.bytes_in_use == kBefore.bytes_in_use;
+}
+
+bool test_steady_state_training() {
+    return steady_state_hits_cache(false);
+}
+
+bool test_steady_state_fused_training() {
+    return steady_state_hits_cache(true);
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Freed buffers are reused by size class", test_reuse_and_stats},
+        {"Tensor data is aligned", test_alignment},
+        {"Training steps are served from the cache", test_steady_state_training},
+        {"Fused training steps are served from the cache", test_steady_state_fused_training}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
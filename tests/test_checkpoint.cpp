@@ -0,0 +1,165 @@
+// Test to verify that checkpoints restore models and optimizer states, with and without copying the parameters
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Checkpoint.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+const std::string kPath = "test_checkpoint.ckpt";
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+void make_model(Sequential &model) {
+    model.AddModule<LinearLayer>(4, 8);
+    model.AddModule<ReLU>(0.1);
+    Sequential block;
+    block.AddModule<LinearLayer>(8, 8, Initialization::Uniform(), false);
+    block.AddModule<ReLU>();
+    model.AddModule<Sequential>(std::move(block));
+    model.AddModule<LinearLayer>(8, 2);
+}
+
+// A module without a checkpoint record
+class Identity : public Module {
+ public:
+    std::vector<SharedTensor> Parameters() const & override { return {}; }
+    Tensor Forward(const Tensor &x) const & override { return x; }
+};
+
+bool equal(const Tensor &a, const Tensor &b) {
+    bool pass = a.Shape() == b.Shape();
+    for (size_t i = 0; pass && i < a.Size(); i++)
+        pass = a[i] == b[i];
+    return pass;
+}
+
+bool test_round_trip() {
+    Sequential model;
+    make_model(model);
+    const Tensor kX(random_values(6 * 4, 1), {6, 4});
+    bool pass = SaveCheckpoint(kPath, model);
+
+    Checkpoint checkpoint(kPath);
+    Sequential mapped, copied;
+    pass = pass && checkpoint.IsOpen() && !checkpoint.HasOptimizerState()
+        && checkpoint.LoadModel(mapped) && checkpoint.LoadModel(copied, false);
+    // The modules are appended to the model as they were saved, without a nested Sequential
+    std::vector<CheckpointModule> saved, loaded;
+    pass = pass && model.AddToCheckpoint(saved) && mapped.AddToCheckpoint(loaded) && saved.size() == loaded.size();
+    for (size_t m = 0; pass && m < saved.size(); m++)
+        pass = saved[m].kind == loaded[m].kind && saved[m].num_children == loaded[m].num_children;
+    NoGradGuard no_grad;
+    pass = pass && equal(mapped(kX), model(kX)) && equal(copied(kX), model(kX))
+        && mapped.Parameters().size() == model.Parameters().size();
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+bool test_empty_model() {
+    Sequential model, loaded;
+    bool pass = SaveCheckpoint(kPath, model) && Checkpoint(kPath).LoadModel(loaded) && loaded.Parameters().empty();
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+bool test_training_mapped_model() {
+    Sequential model;
+    make_model(model);
+    SGD optimizer(model.Parameters(), 0.25);
+    bool pass = SaveCheckpoint(kPath, model, &optimizer);
+
+    // The mapping is private: training updates the loaded parameters, never the file
+    Sequential loaded;
+    {
+        Checkpoint checkpoint(kPath);
+        pass = pass && checkpoint.LoadModel(loaded) && checkpoint.HasOptimizerState();
+    }
+    SGD resumed(loaded.Parameters(), 1);
+    pass = pass && Checkpoint(kPath).LoadOptimizer(resumed);
+
+    const Tensor kX(random_values(6 * 4, 2), {6, 4}), kY(random_values(6 * 2, 3), {6, 2});
+    auto train = [&](const Sequential &m, SGD &opt) {
+        opt.ZeroGrad();
+        MSELoss()(m(kX), kY).Backward();
+        opt.Step();
+    };
+    for (int step = 0; step < 3; step++) {
+        train(model, optimizer);
+        train(loaded, resumed);
+    }
+    Sequential original;
+    pass = pass && Checkpoint(kPath).LoadModel(original);
+    NoGradGuard no_grad;
+    pass = pass && equal(loaded(kX), model(kX)) && !equal(original(kX), model(kX));
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+bool test_invalid_files() {
+    Sequential model;
+    make_model(model);
+    model.AddModule<Identity>();
+    bool pass = !SaveCheckpoint(kPath, model) && !Checkpoint("missing.ckpt").IsOpen();
+
+    // Wrong magic, and a table that does not fit in the file
+    std::ofstream(kPath, std::ios::binary) << std::string(4096, 'x');
+    pass = pass && !Checkpoint(kPath).IsOpen();
+    CheckpointHeader header = {};
+    std::copy(kCheckpointMagic, kCheckpointMagic + 8, header.magic);
+    header.version = kCheckpointVersion;
+    header.dtype = static_cast<uint8_t>(kDType);
+    header.num_modules = 1000;
+    header.data_offset = 4096;
+    std::ofstream file(kPath, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header)) << std::string(4096, '\0');
+    file.close();
+    pass = pass && !Checkpoint(kPath).IsOpen();
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Saved model loads with the same outputs (mapped and copied)", test_round_trip},
+        {"Empty model round trip", test_empty_model},
+        {"Training resumes from a mapped model and optimizer state", test_training_mapped_model},
+        {"Unsupported modules and invalid files are rejected", test_invalid_files}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// Test to verify that delimited text files are parsed into the right feature and target tensors
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CsvReader.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+std::string write_file(const std::string &name, const std::string &text) {
+    const std::string kPath = (std::filesystem::temp_directory_path() / ("cpptensor_" + name)).string();
+    std::ofstream(kPath, std::ios::binary) << text;
+    return kPath;
+}
+
+// Rows {i, i / 8, label, -i} of a file with a text column, e.g. "3,0.375,b,-3"
+std::string make_text(size_t rows) {
+    std::string text = "a,b,name,target\n";
+    for (size_t i = 0; i < rows; i++)
+        text += std::to_string(i) + "," + std::to_string(i / 8.0) + ",row" + std::to_string(i) + ","
+            + std::to_string(-double(i)) + "\n";
+    return text;
+}
+
+bool check_rows(const Tensor &x, const Tensor &y, size_t first_row, size_t rows) {
+    bool pass = x.Shape() == std::vector<size_t>({rows, 2}) && y.Shape() == std::vector<size_t>({rows, 1});
+    for (size_t r = 0; pass && r < rows; r++) {
+        const Scalar kI = first_row + r;
+        pass = x.Value({int(r), 0}) == kI && x.Value({int(r), 1}) == Scalar(kI / 8.0)
+            && y.Value({int(r), 0}) == -kI;
+    }
+    return pass;
+}
+
+bool test_read_with_columns() {
+    const std::string kPath = write_file("columns.csv", "x, y ,z\r\n1, 2.5 ,+3\r\n\r\n-4,5e-1,6\r\n");
+    CsvOptions options;
+    options.header = true;
+    options.feature_columns = {2, 0};
+    options.target_columns = {1};
+    Tensor x, y;
+    bool pass = ReadCsv(kPath, options, x, y) && x.Shape() == std::vector<size_t>({2, 2})
+        && y.Shape() == std::vector<size_t>({2, 1})
+        && x[0] == 3 && x[1] == 1 && x[2] == 6 && x[3] == -4 && y[0] == 2.5 && y[1] == 0.5;
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+bool test_parallel_read_matches_serial() {
+    // Large enough to be parsed in several chunks; the text column is skipped
+    const std::string kPath = write_file("large.csv", make_text(100000));
+    CsvOptions options;
+    options.header = true;
+    options.feature_columns = {0, 1};
+    options.target_columns = {3};
+
+    Tensor x, y, x_serial, y_serial;
+    const bool kRead = ReadCsv(kPath, options, x, y);
+    const size_t kThreads = GetNumThreads();
+    SetNumThreads(1);
+    const bool kReadSerial = ReadCsv(kPath, options, x_serial, y_serial);
+    SetNumThreads(kThreads);
+    std::remove(kPath.c_str());
+
+    bool pass = kRead && kReadSerial && check_rows(x, y, 0, 100000);
+    for (size_t i = 0; pass && i < x.Size(); i++)
+        pass = x[i] == x_serial[i];
+    return pass;
+}
+
+bool test_stream_batches() {
+    const std::string kPath = write_file("stream.csv", make_text(1000));
+    CsvOptions options;
+    options.header = true;
+    options.feature_columns = {0, 1};
+    options.target_columns = {3};
+
+    // Chunks much smaller than a batch, and batches ending in the middle of a chunk
+    CsvStream stream(kPath, options, 300, 64);
+    Tensor x, y;
+    size_t rows = 0;
+    bool pass = stream.IsOpen();
+    while (pass && stream.Next(x, y)) {
+        pass = check_rows(x, y, rows, std::min<size_t>(300, 1000 - rows));
+        rows += x.Shape(0);
+    }
+    std::remove(kPath.c_str());
+    return pass && rows == 1000 && !stream.Failed();
+}
+
+bool test_malformed_files() {
+    const std::string kBadField = write_file("bad_field.csv", "1,2\n3,x\n");
+    const std::string kBadRow = write_file("bad_row.csv", "1,2\n3,4,5\n");
+    CsvOptions options, missing_column;
+    missing_column.target_columns = {2};
+    Tensor x, y;
+    CsvStream stream(kBadField, options, 1);
+    const bool kFirst = stream.Next(x, y);
+    bool pass = !ReadCsv(kBadField, options, x, y) && !ReadCsv(kBadRow, options, x, y)
+        && !ReadCsv(kBadRow, missing_column, x, y) && !ReadCsv(kBadRow + ".missing", options, x, y)
+        && kFirst && x[1] == 2 && !stream.Next(x, y) && stream.Failed()
+        && !CsvStream(kBadRow, missing_column, 1).IsOpen();
+    std::remove(kBadField.c_str());
+    std::remove(kBadRow.c_str());
+    return pass;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Selected columns read (header, spaces, CRLF)", test_read_with_columns},
+        {"Parallel read matches serial read", test_parallel_read_matches_serial},
+        {"Streamed batches match the file", test_stream_batches},
+        {"Malformed files rejected", test_malformed_files}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
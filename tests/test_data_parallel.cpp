@@ -0,0 +1,146 @@
+// Test to verify that data-parallel training keeps the replicas identical and matches training on one model
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "DataParallel.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+void make_model(Sequential &model) {
+    model.AddModule<LinearLayer>(4, 16);
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(16, 2);
+}
+
+void copy_parameters(const Sequential &from, const Sequential &to) {
+    auto src = from.Parameters(), dst = to.Parameters();
+    for (size_t p = 0; p < src.size(); p++)
+        src[p]->CopyTo(dst[p]->DataPtr());
+}
+
+std::unique_ptr<Optimizer> make_adam(ParameterArena arena) {
+    return std::make_unique<Adam>(std::move(arena), 0.01);
+}
+
+// Trains with 3 replicas on batches of 10 rows (split 3/3/4) and returns the parameters of the first replica
+std::vector<Scalar> train_parallel(const Sequential &init, int steps) {
+    Sequential model;
+    make_model(model);
+    copy_parameters(init, model);
+    DataParallelTrainer trainer(model, 3, make_adam);
+    const Tensor kX(random_values(10 * 4, 1), {10, 4}), kY(random_values(10 * 2, 2), {10, 2});
+    for (int step = 0; step < steps; step++)
+        trainer.Step(kX, kY, MSELoss());
+    return std::vector<Scalar>(trainer.Arena(0).Data(), trainer.Arena(0).Data() + trainer.Arena(0).Size());
+}
+
+bool test_replicas_identical() {
+    Sequential model;
+    make_model(model);
+    DataParallelTrainer trainer(model, 3, make_adam);
+    const Tensor kX(random_values(7 * 4, 3), {7, 4}), kY(random_values(7 * 2, 4), {7, 2});
+    for (int step = 0; step < 5; step++)
+        trainer.Step(kX, kY, MSELoss());
+
+    bool pass = trainer.IsValid() && trainer.NumReplicas() == 3;
+    for (size_t r = 1; r < trainer.NumReplicas(); r++)
+        pass = pass && std::memcmp(trainer.Arena(r).Data(), trainer.Arena(0).Data(),
+                                   trainer.Arena(0).Size() * sizeof(Scalar)) == 0;
+    return pass;
+}
+
+bool test_matches_single_model() {
+    Sequential init, single;
+    make_model(init);
+    make_model(single);
+    copy_parameters(init, single);
+    Adam optimizer(single.Parameters(), 0.01);
+    const Tensor kX(random_values(10 * 4, 1), {10, 4}), kY(random_values(10 * 2, 2), {10, 2});
+    for (int step = 0; step < 5; step++) {
+        optimizer.ZeroGrad();
+        MSELoss()(single(kX), kY).Backward();
+        optimizer.Step();
+    }
+
+    const std::vector<Scalar> kParallel = train_parallel(init, 5);
+    ParameterArena arena(single.Parameters());
+    bool pass = kParallel.size() == arena.Size();
+    for (size_t i = 0; pass && i < kParallel.size(); i++)
+        pass = std::abs(kParallel[i] - arena.Data()[i]) < 1e-4;
+    return pass;
+}
+
+bool test_independent_of_threads() {
+    Sequential init;
+    make_model(init);
+    const size_t kThreads = GetNumThreads();
+    SetNumThreads(1);
+    const std::vector<Scalar> kSerial = train_parallel(init, 3);
+    SetNumThreads(4);
+    const std::vector<Scalar> kThreaded = train_parallel(init, 3);
+    SetNumThreads(kThreads);
+    return kSerial == kThreaded;
+}
+
+bool test_invalid_model() {
+    // A module without Clone
+    struct Identity : Module {
+        std::vector<SharedTensor> Parameters() const & override { return {}; }
+        Tensor Forward(const Tensor &x) const & override { return x; }
+    };
+    Sequential model;
+    make_model(model);
+    model.AddModule<Identity>();
+    DataParallelTrainer invalid(model, 2, make_adam);
+    const Tensor kX(std::vector<Scalar>(4 * 4, 1), {4, 4}), kY(std::vector<Scalar>(4 * 2, 1), {4, 2});
+    return !invalid.IsValid() && invalid.NumReplicas() == 0 && invalid.Step(kX, kY, MSELoss()) == 0
+        && DataParallelTrainer(model, 1, make_adam).IsValid();
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Replicas stay bit-identical", test_replicas_identical},
+        {"Replicas train like one model on the whole batch", test_matches_single_model},
+        {"Result does not depend on the number of threads", test_independent_of_threads},
+        {"Models that cannot be cloned are invalid", test_invalid_model}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
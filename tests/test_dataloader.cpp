@@ -0,0 +1,210 @@
+// Test to verify that DataLoader assembles the right batches and reuses their buffers
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include "DataLoader.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+// Rows of x are {i, 10 + i, 20 + i} and rows of y are {-i}, so every batch row identifies its sample
+std::pair<Tensor, Tensor> make_data(size_t rows) {
+    std::vector<Scalar> x, y;
+    for (size_t i = 0; i < rows; i++) {
+        x.insert(x.end(), {Scalar(i), Scalar(10 + i), Scalar(20 + i)});
+        y.push_back(-Scalar(i));
+    }
+    return {Tensor(x, {rows, 3}), Tensor(y, {rows, 1})};
+}
+
+bool test_batches_cover_the_data() {
+    auto [x, y] = make_data(10);
+    DataLoader loader(x, y, 4, true);
+
+    std::set<int> seen;
+    std::vector<size_t> sizes;
+    for (auto &[x_batch, y_batch] : loader) {
+        sizes.push_back(x_batch.Shape(0));
+        if (x_batch.Shape() != std::vector<size_t>({x_batch.Shape(0), 3}) || y_batch.Shape(0) != x_batch.Shape(0))
+            return false;
+        for (size_t r = 0; r < x_batch.Shape(0); r++) {
+            const int kSample = x_batch.Value({int(r), 0});
+            if (x_batch.Value({int(r), 2}) != 20 + kSample || y_batch.Value({int(r), 0}) != -kSample)
+                return false;
+            seen.insert(kSample);
+        }
+    }
+    return seen.size() == 10 && sizes == std::vector<size_t>({4, 4, 2});
+}
+
+bool test_gather_from_view() {
+    // Rows gathered from a transposed (non-contiguous) tensor
+    Tensor y = make_data(3).second;
+    Tensor columns = Tensor({0.0, 1.0, 2.0, 3.0, 4.0, 5.0}, {2, 3}).Transpose();
+    DataLoader loader(columns, y, 3, false);
+
+    auto it = loader.begin();
+    auto &[x_batch, y_batch] = *it;
+    return !columns.IsContiguous() && x_batch.Shape() == std::vector<size_t>({3, 2})
+        && x_batch[0] == 0.0 && x_batch[1] == 3.0 && x_batch[2] == 1.0 && x_batch[3] == 4.0
+        && x_batch[4] == 2.0 && x_batch[5] == 5.0;
+}
+
+bool test_buffers_reused() {
+    auto [x, y] = make_data(12);
+    DataLoader loader(x, y, 4, false);
+
+    // Released batches give their buffers to the next one, a batch that is kept is never overwritten
+    std::vector<const Scalar *> buffers;
+    Tensor kept;
+    int batch = 0;
+    for (auto &[x_batch, y_batch] : loader) {
+        buffers.push_back(x_batch.GetTensor()->DataPtr());
+        if (batch++ == 1)
+            kept = x_batch;
+    }
+    return buffers[1] == buffers[0] && buffers[2] != buffers[1]
+        && kept.Value({0, 0}) == 4.0 && kept.Value({3, 1}) == 17.0;
+}
+
+// All values of the batches of a few epochs, in order
+std::vector<double> epochs(DataLoader &loader, int num_epochs) {
+    std::vector<double> res;
+    for (int epoch = 0; epoch < num_epochs; epoch++)
+        for (auto &[x_batch, y_batch] : loader)
+            for (size_t i = 0; i < x_batch.Size(); i++)
+                res.push_back(x_batch[i] + 1000 * y_batch[i / 3]);
+    return res;
+}
+
+bool test_prefetch_matches_serial() {
+    auto [x, y] = make_data(103);
+    DataLoader serial(x, y, 8, true), prefetched(x, y, 8, true), other_seed(x, y, 8, true);
+    serial.SetSeed(7);
+    prefetched.SetSeed(7);
+    other_seed.SetSeed(8);
+    prefetched.SetPrefetch(3, 2);
+
+    const auto kSerial = epochs(serial, 3);
+    const auto kPrefetched = epochs(prefetched, 3);
+    const size_t kEpochSize = 103 * 3;
+    return kSerial.size() == 3 * kEpochSize && kSerial == kPrefetched && kSerial != epochs(other_seed, 3)
+        && !std::equal(kSerial.begin(), kSerial.begin() + kEpochSize, kSerial.begin() + kEpochSize);
+}
+
+bool test_prefetch_interrupted_epoch() {
+    auto [x, y] = make_data(50);
+    DataLoader loader(x, y, 4, true);
+    loader.SetPrefetch(2, 4);
+
+    // Leaving an epoch early stops its workers, the next epoch starts over
+    for (auto &batch : loader) {
+        (void) batch;
+        break;
+    }
+    size_t rows = 0;
+    std::set<int> seen;
+    for (auto &[x_batch, y_batch] : loader) {
+        rows += x_batch.Shape(0);
+        for (size_t r = 0; r < x_batch.Shape(0); r++)
+            seen.insert(x_batch.Value({int(r), 0}));
+    }
+    return rows == 50 && seen.size() == 50;
+}
+
+bool test_prefetch_overlapping_epochs() {
+    auto [x, y] = make_data(40);
+    DataLoader loader(x, y, 4, true);
+    loader.SetPrefetch(2, 2);
+
+    // An iterator keeps its epoch running after the loader has started the next one
+    auto first = loader.begin();
+    auto second = loader.begin();
+    size_t rows = 0;
+    std::set<int> seen;
+    for (auto it = first; it != loader.end(); ++it) {
+        auto &[x_batch, y_batch] = *it;
+        rows += x_batch.Shape(0);
+        for (size_t r = 0; r < x_batch.Shape(0); r++)
+            seen.insert(x_batch.Value({int(r), 0}));
+    }
+    return rows == 40 && seen.size() == 40 && (*second).first.Shape(0) == 4;
+}
+
+bool test_empty_dataset() {
+    auto [x, y] = make_data(0);
+    DataLoader serial(x, y, 4, true), prefetched(x, y, 4, true);
+    prefetched.SetPrefetch(2);
+    size_t batches = 0;
+    for (auto &batch : serial) {
+        (void) batch;
+        batches++;
+    }
+    for (auto &batch : prefetched) {
+        (void) batch;
+        batches++;
+    }
+    return batches == 0;
+}
+
+bool test_block_shuffle() {
+    auto [x, y] = make_data(1000);
+    DataLoader loader(x, y, 32, true);
+    loader.SetBlockShuffle(16, 64);
+
+    // Every epoch covers the data, and each window of 64 rows comes from 4 blocks of 16
+    // (5 once the shorter last block has shifted the windows)
+    std::vector<std::vector<int>> orders(2);
+    for (auto &order : orders)
+        for (auto &[x_batch, y_batch] : loader)
+            for (size_t r = 0; r < x_batch.Shape(0); r++)
+                order.push_back(x_batch.Value({int(r), 0}));
+    bool pass = orders[0] != orders[1];
+    for (auto &order : orders) {
+        pass = pass && std::set<int>(order.begin(), order.end()).size() == 1000 && !std::is_sorted(order.begin(), order.end());
+        for (size_t begin = 0; pass && begin < order.size(); begin += 64) {
+            std::set<int> blocks;
+            for (size_t i = begin; i < std::min<size_t>(order.size(), begin + 64); i++)
+                blocks.insert(order[i] / 16);
+            pass = blocks.size() <= 5;
+        }
+    }
+    return pass;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Batches cover the data (last batch smaller)", test_batches_cover_the_data},
+        {"Rows gathered from a non-contiguous tensor", test_gather_from_view},
+        {"Batch buffers reused unless the batch is kept", test_buffers_reused},
+        {"Prefetched batches match serial ones for a seed", test_prefetch_matches_serial},
+        {"Prefetching epoch left early", test_prefetch_interrupted_epoch},
+        {"Prefetching epochs overlap", test_prefetch_overlapping_epochs},
+        {"Empty dataset has no batches", test_empty_dataset},
+        {"Block shuffle keeps windows local", test_block_shuffle}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Test to verify that lazily fused chains of operations match eager evaluation (forward and backward)
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <thread>
+#include "GradMode.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+const double EPSILON = 1e-6;
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+// Builds a graph with fresh leaves (eagerly or lazily) and returns its output values followed by the leaf gradients
+using Graph = Tensor (*)(const std::vector<Tensor> &leaves);
+
+std::vector<double> run(Graph graph, const std::vector<std::vector<size_t>> &shapes, bool lazy) {
+    std::vector<Tensor> leaves;
+    for (size_t i = 0; i < shapes.size(); i++) {
+        size_t size = 1;
+        for (auto &s : shapes[i])
+            size *= s;
+        leaves.emplace_back(random_values(size, i + 1), shapes[i], true);
+    }
+
+    Tensor::SetLazy(lazy);
+    auto out = graph(leaves);
+    Tensor::SetLazy(false);
+    out.Sum().Backward();
+
+    std::vector<double> res;
+    for (size_t i = 0; i < out.Size(); i++)
+        res.push_back(out[i]);
+    for (auto &leaf : leaves)
+        for (size_t i = 0; i < leaf.Size(); i++)
+            res.push_back(leaf.GetTensor()->Grad(i));
+    return res;
+}
+
+bool matches_eager(Graph graph, const std::vector<std::vector<size_t>> &shapes) {
+    auto eager = run(graph, shapes, false), lazy = run(graph, shapes, true);
+    if (eager.size() != lazy.size())
+        return false;
+    for (size_t i = 0; i < eager.size(); i++)
+        if (std::abs(eager[i] - lazy[i]) > EPSILON * (1 + std::abs(eager[i])))
+            return false;
+    return true;
+}
+
+bool test_mse_chain() {
+    return matches_eager([](const std::vector<Tensor> &t) { return (t[0] - t[1]).Pow(2).Mean(); }, {{20, 3}, {20, 3}});
+}
+
+bool test_broadcast_chain() {
+    // Bias (row broadcast) and scalar operands, division and a leaky ReLU in one chain
+    return matches_eager([](const std::vector<Tensor> &t) {
+        return (t[0] * t[1] + t[2]).Relu(0.1) / t[3] + t[2] * Tensor(-2.0);
+    }, {{50, 4}, {50, 4}, {4}, {}});
+}
+
+bool test_reused_intermediate() {
+    return matches_eager([](const std::vector<Tensor> &t) {
+        auto y = t[0] * Tensor(3.0) - t[1];
+        return (y + Tensor(1.0)) * (y * y) + y.Sum();
+    }, {{7, 5}, {7, 5}});
+}
+
+bool test_materialized_by_matmul() {
+    return matches_eager([](const std::vector<Tensor> &t) {
+        return (t[0].Pow(2) + t[1]).Matmul(t[2]).Relu(0.0).Mean();
+    }, {{6, 4}, {4}, {4, 3}});
+}
+
+bool test_large_chain_in_parallel() {
+    SetNumThreads(4);
+    bool pass = matches_eager([](const std::vector<Tensor> &t) {
+        return (((t[0] - t[1]).Pow(3) + t[2]) * t[0]).Relu(0.2).Mean();
+    }, {{400, 300}, {400, 300}, {300}});
+    SetNumThreads(1);
+    return pass;
+}
+
+bool test_chain_is_a_single_node() {
+    auto pred = Tensor(random_values(12, 1), {4, 3}, true), target = Tensor(random_values(12, 2), {4, 3});
+
+    Tensor::SetLazy(true);
+    auto diff = pred - target;
+    auto loss = diff.Pow(2).Mean();
+    Tensor::SetLazy(false);
+
+    bool pending = diff.GetTensor()->IsPending() && loss.GetTensor()->IsPending();
+    loss.Backward();
+
+    // The intermediate result is never computed, the loss is materialized by Backward
+    return pending && diff.GetTensor()->IsPending() && !loss.GetTensor()->IsPending()
+        && std::abs(pred.GetTensor()->Grad(0) - 2 * (pred[0] - target[0]) / 12) < EPSILON;
+}
+
+// The graph of a chain depends on the grad mode when it was recorded, not when it is materialized
+bool test_materialized_without_grad() {
+    auto w = Tensor(random_values(8, 3), {8}, true);
+    Tensor::SetLazy(true);
+    auto loss = (w * w).Sum();
+    Tensor::SetLazy(false);
+    {
+        NoGradGuard no_grad;
+        loss.Value();
+    }
+    loss.Backward();
+    return w.GetTensor()->HasGrad() && std::abs(w.GetTensor()->Grad(0) - 2 * w[0]) < EPSILON;
+}
+
+// A chain recorded without gradients is a constant in a later chain, like in eager mode
+bool test_no_grad_operand() {
+    auto run = [](bool lazy) {
+        auto x = Tensor(random_values(6, 5), {6}, true);
+        Tensor::SetLazy(lazy);
+        Tensor y;
+        {
+            NoGradGuard no_grad;
+            y = x * Tensor(2.0);
+        }
+        auto loss = (y * x).Sum();
+        Tensor::SetLazy(false);
+        loss.Backward();
+        return x.GetTensor()->Grad(0);
+    };
+    const double kEager = run(false), kLazy = run(true);
+    return std::abs(kEager - kLazy) < EPSILON && std::abs(kEager - 2 * random_values(6, 5)[0]) < EPSILON;
+}
+
+// Backward of a large chain under NoGradGuard - the pool threads follow the caller, which skips every gradient
+bool test_backward_without_grad_in_parallel() {
+    SetNumThreads(4);
+    const size_t kSize = 1 << 20;
+    auto x = Tensor(random_values(kSize, 6), {kSize}, true), bias = Tensor(random_values(4, 7), {4}, true);
+    Tensor::SetLazy(true);
+    auto y = (x * x + bias).Sum();
+    {
+        NoGradGuard no_grad;
+        y.Backward();
+    }
+    Tensor::SetLazy(false);
+    SetNumThreads(1);
+    return !x.GetTensor()->HasGrad() && !bias.GetTensor()->HasGrad();
+}
+
+// Lazy mode is set per thread
+bool test_lazy_mode_per_thread() {
+    Tensor::SetLazy(true);
+    bool other_lazy = true;
+    std::thread([&] {
+        auto a = Tensor(random_values(4, 4), {4}, true);
+        other_lazy = (a * a).GetTensor()->IsPending();
+    }).join();
+    auto a = Tensor(random_values(4, 4), {4}, true);
+    const bool kLazy = (a * a).GetTensor()->IsPending();
+    Tensor::SetLazy(false);
+    return kLazy && !other_lazy;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"MSE chain ((a - b)^2).Mean()", test_mse_chain},
+        {"Chain with bias and scalar broadcasts", test_broadcast_chain},
+        {"Intermediate result used several times", test_reused_intermediate},
+        {"Chain materialized by Matmul", test_materialized_by_matmul},
+        {"Large chain on several threads", test_large_chain_in_parallel},
+        {"Chain recorded as a single node", test_chain_is_a_single_node},
+        {"Chain materialized with gradients disabled", test_materialized_without_grad},
+        {"Chain recorded without gradients used as a constant", test_no_grad_operand},
+        {"Backward under NoGradGuard on several threads", test_backward_without_grad_in_parallel},
+        {"Lazy mode is per thread", test_lazy_mode_per_thread}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Test to verify the blocked GEMM engine against a naive reference implementation
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+#include "Gemm.hpp"
+
+using namespace cpp_tensor;
+
+const double EPSILON = 1e-9;
+
+std::vector<double> random_matrix(size_t size, std::mt19937 &mt) {
+    std::uniform_real_distribution<double> dist(-1, 1);
+    std::vector<double> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+// C = alpha * op(A) * op(B) + beta * C with the textbook triple loop
+void reference_gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k,
+                    double alpha, const std::vector<double> &a, size_t lda,
+                    const std::vector<double> &b, size_t ldb, double beta, std::vector<double> &c, size_t ldc) {
+    for (size_t i = 0; i < m; i++)
+        for (size_t j = 0; j < n; j++) {
+            double sum = 0;
+            for (size_t p = 0; p < k; p++)
+                sum += (trans_a ? a[p * lda + i] : a[i * lda + p]) * (trans_b ? b[j * ldb + p] : b[p * ldb + j]);
+            c[i * ldc + j] = alpha * sum + beta * c[i * ldc + j];
+        }
+}
+
+bool check_shape(size_t m, size_t n, size_t k, double alpha, double beta, size_t pad = 0,
+                 bool trans_a = false, bool trans_b = false) {
+    std::mt19937 mt(m * 31 + n * 7 + k);
+    size_t lda = (trans_a ? m : k) + pad, ldb = (trans_b ? k : n) + pad, ldc = n + pad;
+    auto a = random_matrix((trans_a ? k : m) * lda, mt), b = random_matrix((trans_b ? n : k) * ldb, mt);
+    auto c = random_matrix(m * ldc, mt);
+    auto expected = c;
+
+    reference_gemm(trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, expected, ldc);
+    Gemm(trans_a, trans_b, m, n, k, alpha, a.data(), lda, b.data(), ldb, beta, c.data(), ldc);
+
+    for (size_t i = 0; i < c.size(); i++)
+        if (std::abs(c[i] - expected[i]) > EPSILON * (k + 1))
+            return false;
+    return true;
+}
+
+bool test_small_product() {
+    return check_shape(3, 4, 5, 1, 0);
+}
+
+bool test_square_blocked() {
+    return check_shape(130, 130, 130, 1, 0);
+}
+
+bool test_edge_tiles() {
+    return check_shape(101, 37, 53, 1, 0) && check_shape(7, 301, 45, 1, 0);
+}
+
+bool test_multiple_k_blocks() {
+    return check_shape(50, 40, 600, 1, 0);
+}
+
+bool test_tall_skinny() {
+    return check_shape(2000, 8, 16, 1, 0) && check_shape(16, 8, 3000, 1, 0);
+}
+
+bool test_alpha_beta() {
+    return check_shape(64, 72, 80, 0.5, 1) && check_shape(64, 72, 80, -2, 0.25);
+}
+
+bool test_leading_dimensions() {
+    return check_shape(70, 90, 110, 1, 1, 5) && check_shape(5, 6, 7, 1, 0, 3);
+}
+
+bool test_beta_zero_ignores_garbage() {
+    std::vector<double> a(40 * 40, 1), b(40 * 40, 1), c(40 * 40, std::nan(""));
+    Gemm(false, false, 40, 40, 40, 1, a.data(), 40, b.data(), 40, 0, c.data(), 40);
+    for (auto &v : c)
+        if (std::abs(v - 40) > EPSILON)
+            return false;
+    return true;
+}
+
+bool test_transposed_operands() {
+    bool pass = true;
+    for (bool trans_a : {false, true})
+        for (bool trans_b : {false, true})
+            pass = pass && check_shape(4, 6, 5, 1, 0, 0, trans_a, trans_b)
+                && check_shape(101, 67, 300, 1, 1, 0, trans_a, trans_b)
+                && check_shape(33, 45, 57, 0.5, 0.5, 3, trans_a, trans_b);
+    return pass;
+}
+
+bool test_single_precision() {
+    const size_t kM = 150, kN = 70, kK = 300;
+    std::mt19937 mt(7);
+    auto a = random_matrix(kM * kK, mt), b = random_matrix(kK * kN, mt);
+    std::vector<double> expected(kM * kN);
+    reference_gemm(false, true, kM, kN, kK, 1, a, kK, b, kK, 0, expected, kN);
+
+    std::vector<float> a_f(a.begin(), a.end()), b_f(b.begin(), b.end()), c_f(kM * kN);
+    Gemm(false, true, kM, kN, kK, 1.f, a_f.data(), kK, b_f.data(), kK, 0.f, c_f.data(), kN);
+    for (size_t i = 0; i < c_f.size(); i++)
+        if (std::abs(c_f[i] - expected[i]) > 1e-5 * kK)
+            return false;
+    return true;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Small product (3x5 * 5x4)", test_small_product},
+        {"Square blocked product (130^3)", test_square_blocked},
+        {"Partial micro-kernel tiles", test_edge_tiles},
+        {"Multiple k blocks (k = 600)", test_multiple_k_blocks},
+        {"Tall-skinny shapes", test_tall_skinny},
+        {"Alpha and beta scaling", test_alpha_beta},
+        {"Leading dimensions larger than rows", test_leading_dimensions},
+        {"Beta = 0 overwrites uninitialized output", test_beta_zero_ignores_garbage},
+        {"Transposed operands read in place", test_transposed_operands},
+        {"Single precision GEMM", test_single_precision}
+    };
+
+    std::cout << "GEMM kernel: " << GemmKernelName() << "\n";
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
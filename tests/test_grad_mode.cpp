@@ -0,0 +1,90 @@
+// Test to verify that the gradient mode is per thread and that operations without gradients build no graph
+
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GradMode.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+bool test_no_grad_guard() {
+    Tensor a({1.0, 2.0, 3.0}, true), w({2.0, 2.0, 2.0}, true);
+    Tensor res;
+    const long kUses = a.GetTensor().use_count();
+    bool pass = IsGradEnabled();
+    {
+        NoGradGuard no_grad;
+        res = ((a * w).Relu(0.1) + a).Sum();
+        {
+            NoGradGuard nested;
+        }
+        pass = pass && !IsGradEnabled();
+    }
+    // The result keeps no references to its operands
+    return pass && IsGradEnabled() && !res.GetTensor()->RequiresGrad() && res.Value() == 18
+        && a.GetTensor().use_count() == kUses && w.GetTensor().use_count() == kUses;
+}
+
+bool test_inference_mode() {
+    Tensor a({1.0, 2.0}, true);
+    bool pass = true;
+    {
+        InferenceModeGuard inference_mode;
+        Tensor::SetUseGrad(true);  // has no effect in inference mode
+        pass = IsInferenceMode() && !IsGradEnabled() && !(a * a).GetTensor()->RequiresGrad();
+    }
+    Tensor b = (a * a).Sum();
+    b.Backward();
+    return pass && !IsInferenceMode() && IsGradEnabled() && a.GetTensor()->Grad(1) == 4;
+}
+
+bool test_mode_is_per_thread() {
+    Tensor a({1.0, 2.0}, true);
+    std::promise<void> guarded, trained;
+    bool other_thread_grad = true;
+    std::thread inference([&] {
+        InferenceModeGuard inference_mode;
+        guarded.set_value();
+        trained.get_future().wait();  // the guard stays active while the main thread trains
+        other_thread_grad = (a * a).GetTensor()->RequiresGrad();
+    });
+
+    guarded.get_future().wait();
+    Tensor loss = (a * a).Sum();
+    loss.Backward();
+    trained.set_value();
+    inference.join();
+    return !other_thread_grad && a.GetTensor()->Grad(0) == 2 && IsGradEnabled();
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"NoGradGuard builds no graph and restores the mode", test_no_grad_guard},
+        {"Gradients stay off in inference mode", test_inference_mode},
+        {"Gradient mode is per thread", test_mode_is_per_thread}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
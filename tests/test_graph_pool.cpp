@@ -0,0 +1,112 @@
+// Test to verify that graph nodes and backward operations are recycled by the graph pool between training steps
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "GraphPool.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+// Runs training steps of a small MLP and returns the number of blocks the pool took from the heap
+// during the steps after the warm-up (batched == false trains on one sample at a time, through views)
+size_t heap_allocations_after_warmup(bool batched, bool lazy) {
+    Sequential model;
+    model.AddModule<LinearLayer>(4, 8);
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(8, 2);
+    SGD optimizer(model.Parameters(), 1e-3);
+    MSELoss criterion;
+    Tensor x(random_values(64, 1), {16, 4}), y(random_values(32, 2), {16, 2});
+
+    Tensor::SetLazy(lazy);
+    auto step = [&] {
+        if (batched) {
+            criterion(model(x), y).Backward();
+        } else {
+            for (int i = 0; i < 16; i++)
+                criterion(model(x.ValueTensor({i})), y.ValueTensor({i})).Backward();
+        }
+        optimizer.Step();
+        optimizer.ZeroGrad();
+    };
+
+    step();
+    const GraphPoolStats kBefore = GetGraphPoolStats();
+    for (int i = 0; i < 10; i++)
+        step();
+    const GraphPoolStats kAfter = GetGraphPoolStats();
+    Tensor::SetLazy(false);
+
+    if (kAfter.allocations == kBefore.allocations)  // the graph did not go through the pool at all
+        return -1;
+    return kAfter.heap_allocations - kBefore.heap_allocations;
+}
+
+bool test_batched_steps() {
+    return heap_allocations_after_warmup(true, false) == 0;
+}
+
+bool test_per_sample_steps() {
+    return heap_allocations_after_warmup(false, false) == 0;
+}
+
+bool test_lazy_steps() {
+    return heap_allocations_after_warmup(true, true) == 0 && heap_allocations_after_warmup(false, true) == 0;
+}
+
+bool test_backward_function_captures() {
+    auto captured = std::make_shared<int>(0);
+    BackwardFunction fn = [captured](InternalTensor *) { (*captured)++; };
+    BackwardFunction moved = std::move(fn);
+    moved(nullptr);
+    moved(nullptr);
+
+    const bool kAlive = !fn && moved && captured.use_count() == 2 && *captured == 2;
+    moved = nullptr;
+    return kAlive && !moved && captured.use_count() == 1;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Batched training steps reuse pooled nodes", test_batched_steps},
+        {"Per-sample training steps (views) reuse pooled nodes", test_per_sample_steps},
+        {"Fused training steps reuse pooled nodes", test_lazy_steps},
+        {"BackwardFunction keeps and releases its captures", test_backward_function_captures}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
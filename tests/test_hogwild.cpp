@@ -0,0 +1,114 @@
+// Test to verify that asynchronous workers train the shared parameters of a model
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "DataLoader.hpp"
+#include "Hogwild.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+// y = x . w + 1 for 512 rows of 4 features
+void make_data(Tensor &x, Tensor &y) {
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    const std::vector<Scalar> kW = {0.5, -1, 2, 0.25};
+    std::vector<Scalar> x_data, y_data;
+    for (int i = 0; i < 512; i++) {
+        Scalar target = 1;
+        for (auto &w : kW) {
+            x_data.push_back(dist(mt));
+            target += w * x_data.back();
+        }
+        y_data.push_back(target);
+    }
+    x = Tensor(x_data, {512, 4});
+    y = Tensor(y_data, {512, 1});
+}
+
+std::unique_ptr<Optimizer> make_sgd(ParameterArena arena) {
+    return std::make_unique<SGD>(std::move(arena), 0.05);
+}
+
+Scalar loss_of(const Sequential &model, const Tensor &x, const Tensor &y) {
+    NoGradGuard no_grad;
+    return MSELoss()(model(x), y).Value();
+}
+
+bool test_single_worker_is_sgd() {
+    Tensor x, y;
+    make_data(x, y);
+    Sequential model, reference;
+    model.AddModule<LinearLayer>(4, 1);
+    reference.AddModule<LinearLayer>(4, 1);
+    model.Parameters()[0]->CopyTo(reference.Parameters()[0]->DataPtr());
+    model.Parameters()[1]->CopyTo(reference.Parameters()[1]->DataPtr());
+
+    // One worker trains on all rows, shuffled with seed 0
+    HogwildTrainer trainer(model, 1, make_sgd);
+    const size_t kSteps = trainer.Train(x, y, MSELoss(), 2);
+    SGD optimizer(reference.Parameters(), 0.05);
+    DataLoader loader(x, y, 32, true);
+    loader.SetSeed(0);
+    for (int epoch = 0; epoch < 2; epoch++) {
+        for (auto &[x_batch, y_batch] : loader) {
+            optimizer.ZeroGrad();
+            MSELoss()(reference(x_batch), y_batch).Backward();
+            optimizer.Step();
+        }
+    }
+    return kSteps == 32 && std::abs(loss_of(model, x, y) - loss_of(reference, x, y)) < 1e-6;
+}
+
+bool test_workers_converge() {
+    Tensor x, y;
+    make_data(x, y);
+    const size_t kThreads = GetNumThreads();
+    SetNumThreads(4);
+    bool pass = true;
+    for (size_t staleness : {0, 4}) {
+        Sequential model;
+        model.AddModule<LinearLayer>(4, 1);
+        const Scalar kBefore = loss_of(model, x, y);
+        HogwildTrainer trainer(model, 4, make_sgd, staleness);
+        pass = pass && trainer.IsValid() && trainer.Train(x, y, MSELoss(), 20, 16) == 20 * 32;
+        pass = pass && loss_of(model, x, y) < 1e-3 * kBefore;
+    }
+    SetNumThreads(kThreads);
+    return pass;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"A single worker trains like SGD", test_single_worker_is_sgd},
+        {"Asynchronous workers converge (with and without staleness)", test_workers_converge}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+// Test to verify that frozen inference plans compute the model's outputs without allocating, from many threads
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "Losses.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+// Every heap allocation of the process is counted
+std::atomic<size_t> allocations{0};
+
+// (The operators are not inlined, so that the compiler does not pair malloc and free with new and delete expressions)
+[[gnu::noinline]] void *operator new(size_t size) {
+    allocations++;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+void make_model(Sequential &model) {
+    model.AddModule<LinearLayer>(5, 16);
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(16, 8, Initialization::Uniform(), false);
+    model.AddModule<ReLU>(0.2);
+    model.AddModule<ReLU>();
+    model.AddModule<LinearLayer>(8, 3);
+}
+
+bool close(const Tensor &a, const Tensor &b) {
+    bool pass = a.Shape() == b.Shape();
+    for (size_t i = 0; pass && i < a.Size(); i++)
+        pass = std::abs(a[i] - b[i]) < 1e-4;
+    return pass;
+}
+
+bool test_plan_matches_forward() {
+    Sequential model;
+    make_model(model);
+    InferencePlan plan = model.Freeze(32);
+    Tensor x(random_values(20 * 5, 1), {20, 5}), row(random_values(5, 2));
+
+    NoGradGuard no_grad;
+    return plan.IsValid() && plan.InFeatures() == 5 && plan.OutFeatures() == 3
+        && close(plan.Run(x), model(x)) && close(plan.Run(row), model(row));
+}
+
+bool test_plan_is_a_snapshot() {
+    Sequential model;
+    make_model(model);
+    InferencePlan plan = model.Freeze(8);
+    Tensor x(random_values(8 * 5, 3), {8, 5}), y(random_values(8 * 3, 4), {8, 3});
+    const Tensor kBefore = plan.Run(x);
+
+    SGD optimizer(model.Parameters(), 0.1);
+    MSELoss()(model(x), y).Backward();
+    optimizer.Step();
+    NoGradGuard no_grad;
+    return close(plan.Run(x), kBefore) && !close(model(x), kBefore);
+}
+
+bool test_run_does_not_allocate() {
+    Sequential model;
+    make_model(model);
+    const InferencePlan kPlan = model.Freeze(16);
+    InferencePlan::Workspace workspace = kPlan.MakeWorkspace();
+    const std::vector<Scalar> kInput = random_values(16 * 5, 5);
+    std::vector<Scalar> output(16 * 3);
+
+    kPlan.Run(kInput.data(), 16, output.data(), workspace);  // warm-up (e.g. the packing buffers of Gemm)
+    const size_t kAllocations = allocations;
+    bool pass = true;
+    for (size_t rows = 1; rows <= 16; rows++)
+        pass = pass && kPlan.Run(kInput.data(), rows, output.data(), workspace);
+    return pass && allocations == kAllocations && !kPlan.Run(kInput.data(), 17, output.data(), workspace);
+}
+
+bool test_concurrent_runs() {
+    Sequential model;
+    make_model(model);
+    const InferencePlan kPlan = model.Freeze(4);
+    const std::vector<Scalar> kInput = random_values(4 * 5, 6);
+    std::vector<Scalar> expected(4 * 3);
+    InferencePlan::Workspace workspace = kPlan.MakeWorkspace();
+    kPlan.Run(kInput.data(), 4, expected.data(), workspace);
+
+    std::atomic<bool> pass{true};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            InferencePlan::Workspace own = kPlan.MakeWorkspace();
+            std::vector<Scalar> output(4 * 3);
+            for (int i = 0; i < 1000; i++)
+                if (!kPlan.Run(kInput.data(), 4, output.data(), own) || output != expected)
+                    pass = false;
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    return pass;
+}
+
+bool test_invalid_plans() {
+    Sequential mismatched;
+    mismatched.AddModule<LinearLayer>(2, 3);
+    mismatched.AddModule<LinearLayer>(4, 1);
+    Sequential model;
+    make_model(model);
+    InferencePlan plan = model.Freeze(4);
+    // Inputs that are not rows of InFeatures() elements are rejected instead of read past their end
+    const Tensor kWrongWidth(random_values(3 * 4, 3), {3, 4}), kWrongRow(random_values(3, 4)), kScalar(1.0);
+    return !mismatched.Freeze(1).IsValid() && !Sequential().Freeze(1).IsValid()
+        && plan.Run(kWrongWidth).Shape().empty() && plan.Run(kWrongRow).Shape().empty()
+        && plan.Run(kScalar).Shape().empty();
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Plan matches Forward (batch and single row)", test_plan_matches_forward},
+        {"Plan keeps the parameters it was frozen with", test_plan_is_a_snapshot},
+        {"Running a plan does not allocate", test_run_does_not_allocate},
+        {"Plan run concurrently from several threads", test_concurrent_runs},
+        {"Mismatched models, empty models and inputs of another width are invalid", test_invalid_plans}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
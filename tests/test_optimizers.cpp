@@ -0,0 +1,192 @@
+// Test to verify the fused optimizer steps against straightforward implementations of their update rules
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Checkpoint.hpp"
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ParameterArena.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+// 37 elements: full SIMD vectors and a remainder in both precisions
+const size_t kSize = 37;
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+// Runs steps of the optimizer on a parameter with the gradient sin(step + i), and compares the parameter
+// with reference(p, g, step) applied to a copy in double precision after every step
+template<typename Make, typename Reference>
+bool matches_reference(Make make, Reference reference, bool arena) {
+    Tensor p(random_values(kSize, 1), {kSize}, true);
+    std::vector<double> expected(p.Size());
+    for (size_t i = 0; i < p.Size(); i++)
+        expected[i] = p[i];
+    std::vector<SharedTensor> parameters = {p.GetTensor()};
+    auto optimizer = arena ? make(ParameterArena(parameters)) : make(parameters);
+
+    bool pass = true;
+    for (int step = 1; step <= 5; step++) {
+        Buffer grad(kSize);
+        std::vector<double> g(kSize);
+        for (size_t i = 0; i < kSize; i++)
+            g[i] = grad[i] = std::sin(step + i);
+        optimizer.ZeroGrad();
+        p.GetTensor()->UpdateGrad(std::move(grad));
+        optimizer.Step();
+        reference(expected, g, step);
+        for (size_t i = 0; i < kSize; i++)
+            pass = pass && std::abs(p[i] - expected[i]) < 1e-5;
+    }
+    return pass;
+}
+
+bool test_sgd() {
+    const double kLr = 0.1, kMomentum = 0.9;
+    std::vector<double> buf(kSize, 0);
+    auto momentum = [&](bool nesterov) {
+        return [&, nesterov](std::vector<double> &p, const std::vector<double> &g, int) {
+            for (size_t i = 0; i < kSize; i++) {
+                buf[i] = kMomentum * buf[i] + g[i];
+                p[i] -= kLr * (nesterov ? g[i] + kMomentum * buf[i] : buf[i]);
+            }
+        };
+    };
+
+    bool pass = true;
+    for (bool arena : {false, true}) {
+        for (bool nesterov : {false, true}) {
+            buf.assign(kSize, 0);
+            pass = pass && matches_reference([&](auto parameters) { return SGD(parameters, kLr, kMomentum, nesterov); },
+                                             momentum(nesterov), arena);
+        }
+        pass = pass && matches_reference([&](auto parameters) { return SGD(parameters, kLr); },
+                                         [&](std::vector<double> &p, const std::vector<double> &g, int) {
+                                             for (size_t i = 0; i < kSize; i++)
+                                                 p[i] -= kLr * g[i];
+                                         }, arena);
+    }
+    return pass;
+}
+
+bool test_adam() {
+    const double kLr = 0.01, kBeta1 = 0.9, kBeta2 = 0.999, kEps = 1e-8, kDecay = 0.1;
+    std::vector<double> m, v;
+    auto adam = [&](bool decoupled) {
+        return [&, decoupled](std::vector<double> &p, const std::vector<double> &g, int step) {
+            for (size_t i = 0; i < kSize; i++) {
+                const double kG = decoupled ? g[i] : g[i] + kDecay * p[i];
+                m[i] = kBeta1 * m[i] + (1 - kBeta1) * kG;
+                v[i] = kBeta2 * v[i] + (1 - kBeta2) * kG * kG;
+                const double kM = m[i] / (1 - std::pow(kBeta1, step)), kV = v[i] / (1 - std::pow(kBeta2, step));
+                if (decoupled)
+                    p[i] *= 1 - kLr * kDecay;
+                p[i] -= kLr * kM / (std::sqrt(kV) + kEps);
+            }
+        };
+    };
+
+    bool pass = true;
+    for (bool arena : {false, true}) {
+        m.assign(kSize, 0), v.assign(kSize, 0);
+        pass = pass && matches_reference([&](auto parameters) {
+            return Adam(parameters, kLr, kBeta1, kBeta2, kEps, kDecay);
+        }, adam(false), arena);
+        m.assign(kSize, 0), v.assign(kSize, 0);
+        pass = pass && matches_reference([&](auto parameters) {
+            return AdamW(parameters, kLr, kBeta1, kBeta2, kEps, kDecay);
+        }, adam(true), arena);
+    }
+    return pass;
+}
+
+// Without an arena, zeroing keeps the gradient buffers of the parameters instead of allocating new ones
+bool test_zero_grad_in_place() {
+    auto p = Tensor(random_values(kSize, 5), {kSize}, true);
+    SGD optimizer({p.GetTensor()}, 0.1);
+    (p * p).Sum().Backward();
+    const Scalar *kGrad = &p.GetTensor()->Grad(0);
+    optimizer.ZeroGrad();
+    bool pass = &p.GetTensor()->Grad(0) == kGrad;
+    for (size_t i = 0; pass && i < kSize; i++)
+        pass = p.GetTensor()->Grad(i) == 0;
+    return pass;
+}
+
+bool test_resume_from_checkpoint() {
+    const std::string kPath = "test_optimizers.ckpt";
+    Sequential model;
+    model.AddModule<LinearLayer>(3, 5);
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(5, 2);
+    Adam optimizer(model.Parameters(), 0.05);
+    const Tensor kX(random_values(8 * 3, 2), {8, 3}), kY(random_values(8 * 2, 3), {8, 2});
+    auto train = [&](const Sequential &m, Optimizer &opt, int steps) {
+        for (int step = 0; step < steps; step++) {
+            opt.ZeroGrad();
+            MSELoss()(m(kX), kY).Backward();
+            opt.Step();
+        }
+    };
+
+    // Training on from the checkpoint gives the same model as training without interruption
+    train(model, optimizer, 3);
+    bool pass = SaveCheckpoint(kPath, model, &optimizer);
+    Checkpoint checkpoint(kPath);
+    Sequential resumed;
+    pass = pass && checkpoint.LoadModel(resumed, false);
+    Adam resumed_optimizer(resumed.Parameters());
+    SGD sgd(resumed.Parameters(), 0.1);
+    pass = pass && checkpoint.LoadOptimizer(resumed_optimizer) && !checkpoint.LoadOptimizer(sgd);
+    train(model, optimizer, 3);
+    train(resumed, resumed_optimizer, 3);
+    NoGradGuard no_grad;
+    const Tensor kA = model(kX), kB = resumed(kX);
+    for (size_t i = 0; pass && i < kA.Size(); i++)
+        pass = std::abs(kA[i] - kB[i]) < 1e-5;
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"SGD with and without (Nesterov) momentum", test_sgd},
+        {"Adam and AdamW", test_adam},
+        {"ZeroGrad without an arena keeps the gradient buffers", test_zero_grad_in_place},
+        {"Adam resumes from a checkpoint", test_resume_from_checkpoint}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+// Test to verify that the intra-op thread pool gives the same results as serial execution
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include "Gemm.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+const double EPSILON = 1e-9;
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+bool test_parallel_for_covers_range() {
+    SetNumThreads(4);
+    std::vector<int> hits(100003);
+    ParallelFor(0, hits.size(), 1000, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            hits[i]++;
+    });
+    for (auto &h : hits)
+        if (h != 1)
+            return false;
+    return true;
+}
+
+bool test_parallel_reduce_is_deterministic() {
+    auto values = random_values(1 << 20, 1);
+    auto sum = [&](size_t begin, size_t end) {
+        double res = 0;
+        for (size_t i = begin; i < end; i++)
+            res += values[i];
+        return res;
+    };
+
+    SetNumThreads(1);
+    double serial = ParallelReduce(0, values.size(), kGrainSize, 0., sum, std::plus<>());
+    SetNumThreads(4);
+    double parallel = ParallelReduce(0, values.size(), kGrainSize, 0., sum, std::plus<>());
+    return serial == parallel;
+}
+
+bool test_nested_parallel_for_runs_serially() {
+    SetNumThreads(4);
+    std::vector<int> hits(64 * 64);
+    ParallelFor(0, 64, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            ParallelFor(0, 64, 1, [&](size_t inner_begin, size_t inner_end) {
+                for (size_t j = inner_begin; j < inner_end; j++)
+                    hits[i * 64 + j]++;
+            });
+    });
+    for (auto &h : hits)
+        if (h != 1)
+            return false;
+    return true;
+}
+
+// Resizing the pool while another thread is inside one of its regions keeps that pool alive until it finishes
+bool test_resize_during_region() {
+    SetNumThreads(4);
+    std::atomic<bool> started{false};
+    std::vector<int> hits(256);
+    std::thread runner([&] {
+        ParallelFor(0, hits.size(), 1, [&](size_t begin, size_t end) {
+            started = true;
+            for (size_t i = begin; i < end; i++) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                hits[i]++;
+            }
+        });
+    });
+    while (!started)
+        std::this_thread::yield();
+    for (size_t threads : {2, 3, 4}) {
+        SetNumThreads(threads);
+        std::vector<int> other(1024);
+        ParallelFor(0, other.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                other[i]++;
+        });
+    }
+    runner.join();
+    SetNumThreads(4);
+    for (auto &h : hits)
+        if (h != 1)
+            return false;
+    return true;
+}
+
+bool test_parallel_gemm_matches_serial() {
+    const size_t kM = 500, kN = 300, kK = 400;
+    auto a = random_values(kM * kK, 2), b = random_values(kK * kN, 3);
+    std::vector<Scalar> serial(kM * kN), parallel(kM * kN);
+
+    SetNumThreads(1);
+    Gemm(false, false, kM, kN, kK, 1, a.data(), kK, b.data(), kN, 0, serial.data(), kN);
+    SetNumThreads(4);
+    Gemm(false, false, kM, kN, kK, 1, a.data(), kK, b.data(), kN, 0, parallel.data(), kN);
+
+    for (size_t i = 0; i < serial.size(); i++)
+        if (std::abs(serial[i] - parallel[i]) > EPSILON)
+            return false;
+    return true;
+}
+
+// Forward and backward of a chain covering every elementwise kernel on a large tensor
+std::vector<Scalar> run_graph(size_t threads) {
+    SetNumThreads(threads);
+    const size_t kRows = 2000, kCols = 100;
+    auto x = Tensor(random_values(kRows * kCols, 4), {kRows, kCols}, true);
+    auto w = Tensor(random_values(kRows * kCols, 5), {kRows, kCols}, true);
+    auto bias = Tensor(random_values(kCols, 6), {kCols}, true);
+    auto scale = Tensor(0.5, true);
+
+    auto y = ((x * w + bias).Relu(0.1) * scale + Tensor(1.0)).Pow(2) - x;
+    auto loss = y.Mean();
+    loss.Backward();
+
+    std::vector<Scalar> res = {loss.Value(), scale.GetTensor()->Grad(0)};
+    for (size_t i = 0; i < kCols; i++)
+        res.push_back(bias.GetTensor()->Grad(i));
+    for (size_t i = 0; i < x.Size(); i += 997)
+        res.push_back(x.GetTensor()->Grad(i));
+    return res;
+}
+
+bool test_parallel_kernels_match_serial() {
+    auto serial = run_graph(1), parallel = run_graph(4);
+    for (size_t i = 0; i < serial.size(); i++)
+        if (std::abs(serial[i] - parallel[i]) > EPSILON)
+            return false;
+    return true;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"ParallelFor visits every index once", test_parallel_for_covers_range},
+        {"ParallelReduce does not depend on the thread count", test_parallel_reduce_is_deterministic},
+        {"Nested ParallelFor runs serially", test_nested_parallel_for_runs_serially},
+        {"Resizing the pool during a region", test_resize_during_region},
+        {"Parallel GEMM matches serial GEMM", test_parallel_gemm_matches_serial},
+        {"Parallel kernels match serial kernels (forward and backward)", test_parallel_kernels_match_serial}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
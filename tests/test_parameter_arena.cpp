@@ -0,0 +1,134 @@
+// Test to verify that parameters moved into an arena keep their values and train as before
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ParameterArena.hpp"
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+std::vector<Scalar> random_values(size_t size, unsigned seed) {
+    std::mt19937 mt(seed);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> res(size);
+    for (auto &v : res)
+        v = dist(mt);
+    return res;
+}
+
+void make_model(Sequential &model) {
+    model.AddModule<LinearLayer>(5, 7);
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(7, 3);
+}
+
+void copy_parameters(const Sequential &from, const Sequential &to) {
+    auto src = from.Parameters(), dst = to.Parameters();
+    for (size_t p = 0; p < src.size(); p++)
+        src[p]->CopyTo(dst[p]->DataPtr());
+}
+
+bool close(const Tensor &a, const Tensor &b) {
+    bool pass = a.Shape() == b.Shape();
+    for (size_t i = 0; pass && i < a.Size(); i++)
+        pass = std::abs(a[i] - b[i]) < 1e-5;
+    return pass;
+}
+
+bool test_layout() {
+    Sequential model;
+    make_model(model);
+    const Tensor kX(random_values(4 * 5, 1), {4, 5});
+    const Tensor kBefore = model(kX);
+
+    ParameterArena arena(model.Parameters());
+    bool pass = close(model(kX), kBefore) && arena.Parameters().size() == 4;
+    for (auto &p : arena.Parameters()) {
+        const size_t kOffset = p->DataPtr() - arena.Data();
+        pass = pass && kOffset < arena.Size() && p->IsContiguous()
+            && reinterpret_cast<size_t>(p->DataPtr()) % kBufferAlignment == 0 && &p->Grad(0) == arena.Grad() + kOffset;
+    }
+    return pass;
+}
+
+bool test_training_matches() {
+    Sequential plain, flat;
+    make_model(plain);
+    make_model(flat);
+    copy_parameters(plain, flat);
+    SGD plain_optimizer(plain.Parameters(), 0.1);
+    SGD flat_optimizer(ParameterArena(flat.Parameters()), 0.1);
+
+    const Tensor kX(random_values(8 * 5, 2), {8, 5}), kY(random_values(8 * 3, 3), {8, 3});
+    for (int step = 0; step < 5; step++) {
+        plain_optimizer.ZeroGrad();
+        MSELoss()(plain(kX), kY).Backward();
+        plain_optimizer.Step();
+        flat_optimizer.ZeroGrad();
+        MSELoss()(flat(kX), kY).Backward();
+        flat_optimizer.Step();
+    }
+    NoGradGuard no_grad;
+    return close(plain(kX), flat(kX));
+}
+
+bool test_gradients_stay_in_arena() {
+    Sequential model;
+    make_model(model);
+    ParameterArena arena(model.Parameters());
+    const Tensor kX(random_values(2 * 5, 4), {2, 5}), kY(random_values(2 * 3, 5), {2, 3});
+
+    // Backward accumulates into the arena, and zeroing (also through a parameter) keeps it there
+    MSELoss()(model(kX), kY).Backward();
+    MSELoss()(model(kX), kY).Backward();
+    Scalar norm = 0;
+    for (size_t i = 0; i < arena.Size(); i++)
+        norm += std::abs(arena.Grad()[i]);
+    arena.Parameters()[0]->SetGrad(0);
+    bool pass = norm > 0 && arena.Parameters()[0]->Grad(0) == 0 && &arena.Parameters()[0]->Grad(0) == arena.Grad();
+    arena.ZeroGrad();
+    for (size_t i = 0; i < arena.Size(); i++)
+        pass = pass && arena.Grad()[i] == 0;
+
+    // A gradient of the wrong size is rejected instead of overrunning the parameter's range
+    const auto &kLast = arena.Parameters().back();
+    kLast->SetGrad(Buffer(arena.Size(), 1));
+    for (size_t i = 0; i < arena.Size(); i++)
+        pass = pass && arena.Grad()[i] == 0;
+    return pass;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Parameters become aligned views of the arena", test_layout},
+        {"Training through the arena matches per-parameter training", test_training_matches},
+        {"Gradients accumulate and are zeroed in the arena", test_gradients_stay_in_arena}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
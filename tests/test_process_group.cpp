@@ -0,0 +1,192 @@
+// Test to verify that processes of a group average buffers through shared memory and stay in sync while training
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Optimizers.hpp"
+#include "ProcessGroup.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+const std::string kName = "/cpptensor-test-" + std::to_string(getpid());
+const Scalar kTolerance = sizeof(Scalar) == sizeof(float) ? 1e-4 : 1e-9;
+
+// True if a region of the global pool with several threads runs every task once
+bool pool_works() {
+    SetNumThreads(2);
+    std::vector<int> hits(8);
+    ThreadPool::Global()->Run(hits.size(), [&](size_t i) { hits[i]++; });
+    return std::count(hits.begin(), hits.end(), 1) == 8;
+}
+
+// Runs func(rank) in num_processes forked processes - true if it returned true in every one of them.
+// The parent has used the thread pool before forking, and every child uses a pool of its own.
+bool run_processes(size_t num_processes, const std::function<bool(size_t)> &func) {
+    const size_t kThreads = GetNumThreads();
+    bool pass = pool_works();
+    std::vector<pid_t> children;
+    for (size_t rank = 0; rank < num_processes; rank++) {
+        const pid_t kPid = fork();
+        if (kPid == 0) {
+            const bool kPoolWorks = pool_works();
+            SetNumThreads(1);  // one thread per process
+            _exit(kPoolWorks && func(rank) ? 0 : 1);
+        }
+        children.push_back(kPid);
+    }
+    for (auto pid : children) {
+        int status = 0;
+        pass = waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && pass;
+    }
+    SetNumThreads(kThreads);
+    return pass;
+}
+
+// True if the buffers of all processes equal the one of rank 0
+bool in_sync(ProcessGroup &group, const Scalar *data, size_t size) {
+    std::vector<Scalar> root(data, data + size);
+    group.Broadcast(root.data());
+    return root == std::vector<Scalar>(data, data + size);
+}
+
+bool test_all_reduce() {
+    const size_t kWorld = 3, kSize = 1001;
+    return run_processes(kWorld, [&](size_t rank) {
+        ProcessGroup group(kName, rank, kWorld, kSize);
+        bool pass = group.IsOpen() && group.Rank() == rank && group.WorldSize() == kWorld;
+        std::vector<Scalar> data(kSize);
+        for (int round = 0; pass && round < 10; round++) {
+            for (size_t i = 0; i < kSize; i++)
+                data[i] = Scalar(rank + 1) * i + round;
+            group.AllReduce(data.data());
+            for (size_t i = 0; pass && i < kSize; i++)
+                pass = std::abs(data[i] - (Scalar(2) * i + round)) <= kTolerance * (i + round + 1);
+            pass = pass && in_sync(group, data.data(), kSize);
+        }
+        return pass;
+    });
+}
+
+bool test_training_in_sync() {
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<Scalar> dist(-1, 1);
+    std::vector<Scalar> x_data(96 * 4), y_data(96);
+    for (auto &v : x_data)
+        v = dist(mt);
+    for (auto &v : y_data)
+        v = dist(mt);
+    const Tensor kX(x_data, {96, 4}), kY(y_data, {96, 1});
+    Sequential model;
+    model.AddModule<LinearLayer>(4, 8);
+    model.AddModule<ReLU>();
+    model.AddModule<LinearLayer>(8, 1);
+
+    // Averaging the gradients of equal shards gives the gradient of the whole batch
+    auto reference = model.Clone();
+    SGD optimizer(reference->Parameters(), 0.1);
+    for (int step = 0; step < 20; step++) {
+        optimizer.ZeroGrad();
+        MSELoss()((*reference)(kX), kY).Backward();
+        optimizer.Step();
+    }
+    const std::vector<SharedTensor> kExpected = reference->Parameters();
+
+    const size_t kWorld = 4, kShard = 96 / kWorld;
+    return run_processes(kWorld, [&](size_t rank) {
+        ParameterArena arena(model.Parameters());
+        ProcessGroup group(kName, rank, kWorld, arena.Size());
+        if (!group.IsOpen())
+            return false;
+        group.Broadcast(arena.Data());
+        SGD replica_optimizer(arena, 0.1);
+        const Tensor kXShard = kX.Slice(0, rank * kShard, (rank + 1) * kShard);
+        const Tensor kYShard = kY.Slice(0, rank * kShard, (rank + 1) * kShard);
+        bool pass = true;
+        for (int step = 0; step < 20; step++) {
+            replica_optimizer.ZeroGrad();
+            MSELoss()(model(kXShard), kYShard).Backward();
+            group.AllReduce(arena.Grad());
+            replica_optimizer.Step();
+            pass = pass && in_sync(group, arena.Data(), arena.Size());
+        }
+        const std::vector<SharedTensor> kParameters = arena.Parameters();
+        for (size_t p = 0; pass && p < kParameters.size(); p++)
+            for (size_t i = 0; pass && i < kParameters[p]->Size(); i++)
+                pass = std::abs(kParameters[p]->DataPtr()[i] - kExpected[p]->DataPtr()[i]) <= kTolerance;
+        return pass;
+    });
+}
+
+bool test_stale_segment() {
+    const size_t kWorld = 2, kSize = 64;
+    // A crashed run leaves its segment behind (its rank 0 exits without removing it)
+    const pid_t kCrashed = fork();
+    if (kCrashed == 0) {
+        new ProcessGroup(kName, 0, kWorld, kSize);
+        _exit(0);
+    }
+    int status = 0;
+    bool pass = waitpid(kCrashed, &status, 0) == kCrashed;
+
+    // Rank 1 starts first and must wait for the segment of the new rank 0 instead of joining the stale one
+    return run_processes(kWorld, [&](size_t rank) {
+        if (rank == 0)
+            usleep(50000);
+        ProcessGroup group(kName, rank, kWorld, kSize);
+        std::vector<Scalar> data(kSize, Scalar(rank));
+        if (!group.IsOpen())
+            return false;
+        group.AllReduce(data.data());
+        return data[0] == Scalar(0.5);
+    }) && pass;
+}
+
+bool test_invalid_groups() {
+    ProcessGroup creator(kName, 0, 2, 16);
+    ProcessGroup other_size(kName, 1, 2, 32);
+    ProcessGroup other_world(kName, 1, 3, 16);
+    ProcessGroup bad_rank(kName, 2, 2, 16);
+    ProcessGroup member(kName, 1, 2, 16);
+    return creator.IsOpen() && member.IsOpen() && !other_size.IsOpen() && !other_world.IsOpen()
+        && !bad_rank.IsOpen();
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"AllReduce averages the buffers of 3 processes", test_all_reduce},
+        {"Processes training shards stay in sync with full-batch SGD", test_training_in_sync},
+        {"A segment left by a crashed run is not joined", test_stale_segment},
+        {"Groups of another size or rank are not joined", test_invalid_groups}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": " << std::flush;
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+// Test to verify that the profiler records forward and backward ops, summarizes them and exports a Chrome trace
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Losses.hpp"
+#include "Modules.hpp"
+#include "Profiler.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpp_tensor;
+
+const std::string kPath = "test_profiler.json";
+
+Scalar train_step(const Sequential &model) {
+    const Tensor kX(std::vector<Scalar>(16 * 4, 0.5), {16, 4}), kY(std::vector<Scalar>(16 * 2, 1), {16, 2});
+    Tensor loss = MSELoss()(model(kX), kY);
+    loss.Backward();
+    return loss.Value();
+}
+
+void make_model(Sequential &model) {
+    model.AddModule<LinearLayer>(4, 8);
+    model.AddModule<ReLU>(0.1);
+    model.AddModule<LinearLayer>(8, 2);
+}
+
+const ProfileEvent *find(const std::vector<ProfileEvent> &events, const std::string &op, ProfilePhase phase) {
+    for (auto &event : events)
+        if (event.op == op && event.phase == phase)
+            return &event;
+    return nullptr;
+}
+
+bool test_disabled() {
+    Sequential model;
+    make_model(model);
+    StartProfiler();
+    StopProfiler();
+    train_step(model);
+    return GetProfileEvents().empty() && GetProfileSummary().empty();
+}
+
+bool test_forward_and_backward() {
+    Sequential model;
+    make_model(model);
+    StartProfiler();
+    train_step(model);
+    train_step(model);
+    StopProfiler();
+    train_step(model);
+
+    const std::vector<ProfileEvent> kEvents = GetProfileEvents();
+    const ProfileEvent *kMatmul = find(kEvents, "matmul", ProfilePhase::kForward);
+    bool pass = kMatmul && kMatmul->shapes == "[16, 4] [4, 8]" && kMatmul->bytes_allocated >= 16 * 8 * sizeof(Scalar)
+        && kMatmul->start_ns + kMatmul->duration_ns > 0;
+    for (const char *op : {"matmul", "add-bias", "relu"})
+        pass = pass && find(kEvents, op, ProfilePhase::kForward) && find(kEvents, op, ProfilePhase::kBackward);
+
+    // Two steps, each with 2 matmuls forward and backward
+    size_t calls = 0;
+    for (auto &row : GetProfileSummary())
+        if (row.op == "matmul")
+            calls += row.calls;
+    std::ostringstream table;
+    PrintProfileSummary(table);
+    return pass && calls == 8 && table.str().find("add-bias") != std::string::npos;
+}
+
+bool test_chrome_trace() {
+    Sequential model;
+    make_model(model);
+    StartProfiler();
+    train_step(model);
+    StopProfiler();
+    bool pass = SaveChromeTrace(kPath);
+
+    std::ifstream file(kPath);
+    const std::string kTrace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t complete_events = 0;
+    long braces = 0, brackets = 0;
+    for (size_t pos = 0; (pos = kTrace.find("\"ph\": \"X\"", pos)) != std::string::npos; pos++)
+        complete_events++;
+    for (char c : kTrace) {
+        braces += c == '{' ? 1 : c == '}' ? -1 : 0;
+        brackets += c == '[' ? 1 : c == ']' ? -1 : 0;
+    }
+    pass = pass && kTrace.rfind("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [", 0) == 0
+        && complete_events == GetProfileEvents().size() && braces == 0 && brackets == 0
+        && kTrace.find("\"cat\": \"backward\"") != std::string::npos;
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+// Buffers allocated by the pool threads of a parallel kernel count for the op that launched it
+bool test_parallel_allocations() {
+    SetNumThreads(4);
+    StartProfiler();
+    {
+        ProfileScope scope("parallel", {});
+        ThreadPool::Global()->Run(8, [](size_t) { Buffer buffer(1024); });
+    }
+    StopProfiler();
+    SetNumThreads(1);
+    const auto kEvents = GetProfileEvents();
+    return kEvents.size() == 1 && kEvents[0].bytes_allocated == 8 * 1024 * sizeof(Scalar);
+}
+
+// Names are escaped, so that the trace stays valid JSON
+bool test_trace_escaping() {
+    StartProfiler();
+    {
+        ProfileScope scope("say \"hi\" \\", {});
+    }
+    StopProfiler();
+    bool pass = SaveChromeTrace(kPath);
+    std::ifstream file(kPath);
+    const std::string kTrace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(kPath.c_str());
+    return pass && kTrace.find(R"("name": "say \"hi\" \\")") != std::string::npos;
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Nothing is recorded while the profiler is stopped", test_disabled},
+        {"Forward and backward ops are recorded with shapes and allocations", test_forward_and_backward},
+        {"Chrome trace contains every event", test_chrome_trace},
+        {"Allocations of pool threads count for their op", test_parallel_allocations},
+        {"Event names are escaped in the trace", test_trace_escaping}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
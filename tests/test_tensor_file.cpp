@@ -0,0 +1,128 @@
+// Test to verify that tensor files round-trip and that mapped datasets feed DataLoader without loading the file
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Buffer.hpp"
+#include "DataLoader.hpp"
+#include "TensorFile.hpp"
+
+using namespace cpp_tensor;
+
+std::string temp_path(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / ("cpptensor_" + name)).string();
+}
+
+Tensor make_rows(size_t rows, size_t cols) {
+    std::vector<Scalar> values(rows * cols);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = Scalar(i) / 4;
+    return Tensor(values, {rows, cols});
+}
+
+bool test_round_trip() {
+    const std::string kPath = temp_path("round_trip.bin");
+    Tensor t = make_rows(6, 4);
+    // A transposed view is written in row-major order of its own shape
+    bool pass = WriteTensorFile(kPath, t) && WriteTensorFile(kPath + "t", t.Transpose());
+
+    MappedDataset mapped(kPath), mapped_t(kPath + "t");
+    pass = pass && mapped.IsOpen() && mapped.NumRows() == 6 && mapped.Data().Shape() == t.Shape()
+        && mapped_t.IsOpen() && mapped_t.Data().Shape() == std::vector<size_t>({4, 6});
+    for (size_t i = 0; pass && i < t.Size(); i++)
+        pass = mapped.Data()[i] == t[i] && mapped_t.Data().Value({int(i % 4), int(i / 4)}) == t[i];
+    std::remove(kPath.c_str());
+    std::remove((kPath + "t").c_str());
+    return pass;
+}
+
+bool test_writer_appends_rows() {
+    const std::string kPath = temp_path("append.bin");
+    {
+        TensorFileWriter writer(kPath, {2});
+        const Scalar kRows[] = {1, 2, 3, 4, 5, 6};
+        writer.AppendRows(kRows, 1);
+        writer.AppendRows(kRows + 2, 2);
+    }
+    MappedDataset mapped(kPath);
+    bool pass = mapped.IsOpen() && mapped.Data().Shape() == std::vector<size_t>({3, 2}) && mapped.Data()[5] == 6;
+    std::remove(kPath.c_str());
+    return pass;
+}
+
+bool test_mapping_is_zero_copy() {
+    const std::string kX = temp_path("x.bin"), kY = temp_path("y.bin");
+    WriteTensorFile(kX, make_rows(1000, 3));
+    WriteTensorFile(kY, make_rows(1000, 1));
+
+    const size_t kInUse = GetBufferCacheStats().bytes_in_use;
+    MappedDataset x(kX), y(kY);
+    const bool kNoCopy = GetBufferCacheStats().bytes_in_use == kInUse;
+
+    // Training split as a view of the mapping, batches gathered straight from it
+    Tensor x_train = x.Data().Slice(0, 0, 800), y_train = y.Data().Slice(0, 0, 800);
+    DataLoader loader(x_train, y_train, 64, true);
+    size_t rows = 0;
+    bool pass = kNoCopy && x_train.GetTensor()->GetStorage() == x.Data().GetTensor()->GetStorage();
+    for (auto &[x_batch, y_batch] : loader) {
+        for (size_t r = 0; r < x_batch.Shape(0); r++)
+            pass = pass && x_batch.Value({int(r), 0}) == 3 * y_batch.Value({int(r), 0})
+                && y_batch.Value({int(r), 0}) < 800 / 4.0;
+        rows += x_batch.Shape(0);
+    }
+    std::remove(kX.c_str());
+    std::remove(kY.c_str());
+    return pass && rows == 800;
+}
+
+bool test_invalid_files() {
+    const std::string kPath = temp_path("invalid.bin");
+    std::ofstream(kPath) << "not a tensor file";
+    MappedDataset garbage(kPath), missing(temp_path("missing.bin"));
+
+    // A shape whose number of elements overflows (2^62 * 4 wraps to 0) must not pass the bounds check
+    bool pass = WriteTensorFile(kPath, make_rows(6, 4));
+    TensorFileHeader header = {};
+    std::fstream file(kPath, std::ios::binary | std::ios::in | std::ios::out);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    header.shape[0] = uint64_t(1) << 62;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.close();
+    MappedDataset overflowing(kPath);
+    std::remove(kPath.c_str());
+    return pass && !garbage.IsOpen() && !missing.IsOpen() && missing.NumRows() == 0 && !overflowing.IsOpen();
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"Tensor written and mapped back", test_round_trip},
+        {"Rows appended by TensorFileWriter", test_writer_appends_rows},
+        {"Mapped dataset feeds DataLoader without copies", test_mapping_is_zero_copy},
+        {"Invalid and missing files are not opened", test_invalid_files}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+// Test to verify that views share the Data of their source tensor and that gradients flow through them
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include "Tensor.hpp"
+
+using namespace cpp_tensor;
+
+const double EPSILON = 1e-6;
+
+bool equal(const Tensor &t, const std::vector<double> &expected) {
+    if (t.Size() != expected.size())
+        return false;
+    for (size_t i = 0; i < expected.size(); i++)
+        if (std::abs(t[i] - expected[i]) > EPSILON)
+            return false;
+    return true;
+}
+
+bool equal_grad(const Tensor &t, const std::vector<double> &expected) {
+    for (size_t i = 0; i < expected.size(); i++)
+        if (std::abs(t.GetTensor()->Grad(i) - expected[i]) > EPSILON)
+            return false;
+    return true;
+}
+
+bool test_value_tensor_shares_data() {
+    auto x = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}, {2, 3});
+    auto row = x.ValueTensor({1});
+    x.GetTensor()->Data(4) = 10.0;
+
+    return row.Shape() == std::vector<size_t>({3}) && row.GetTensor()->GetStorage() == x.GetTensor()->GetStorage()
+        && equal(row, {4.0, 10.0, 6.0}) && x.ValueTensor({1, 2}).Value() == 6.0;
+}
+
+bool test_reshape_keeps_other_handles() {
+    auto x = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}, {2, 3});
+    auto handle = x.Clone(false);
+    auto reshaped = x.Reshape({3, 2});
+    auto flat = x.Flatten();
+
+    return handle.Shape() == std::vector<size_t>({2, 3}) && x.Shape() == std::vector<size_t>({2, 3})
+        && reshaped.Shape() == std::vector<size_t>({3, 2}) && reshaped.Value({2, 0}) == 5.0
+        && flat.Shape() == std::vector<size_t>({6}) && flat.GetTensor()->GetStorage() == x.GetTensor()->GetStorage();
+}
+
+bool test_transpose_and_slice_layout() {
+    auto x = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}, {2, 3});
+    auto t = x.Transpose();
+    auto column = x.Slice(1, 1, 3);
+
+    return !t.IsContiguous() && t.Shape() == std::vector<size_t>({3, 2}) && equal(t, {1.0, 4.0, 2.0, 5.0, 3.0, 6.0})
+        && t.Contiguous().IsContiguous() && equal(t.Contiguous(), {1.0, 4.0, 2.0, 5.0, 3.0, 6.0})
+        && equal(t.Flatten(), {1.0, 4.0, 2.0, 5.0, 3.0, 6.0})
+        && equal(column, {2.0, 3.0, 5.0, 6.0}) && equal(column.Transpose().ValueTensor({1}), {3.0, 6.0});
+}
+
+bool test_gradient_through_slice() {
+    auto x = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}, {2, 3}, true);
+    auto z = x.Slice(1, 1, 3).Pow(2).Sum() + x.ValueTensor({0}).Sum();
+
+    z.Backward();
+
+    return equal_grad(x, {1.0, 5.0, 7.0, 0.0, 10.0, 12.0});
+}
+
+bool test_matmul_with_transposed_views() {
+    auto a = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0}, {3, 2}, true);
+    auto b = Tensor({1.0, -1.0, 2.0, 0.5, -2.0, 1.0}, {3, 2}, true);
+    auto c = a.Transpose().Matmul(b);  // (2x3) * (3x2), both operands read in place by Gemm
+    auto z = (c * Tensor({1.0, 2.0, 3.0, 4.0}, {2, 2})).Sum();
+
+    z.Backward();
+
+    // C = A^T B, dA = B dC^T and dB = A dC with dC = [[1, 2], [3, 4]]
+    return equal(c, {-3.0, 5.5, -2.0, 6.0})
+        && equal_grad(a, {-1.0, -1.0, 3.0, 8.0, 0.0, -2.0})
+        && equal_grad(b, {7.0, 10.0, 15.0, 22.0, 23.0, 34.0});
+}
+
+bool test_matmul_with_noncontiguous_operand() {
+    // A matrix selected from a transposed 3D tensor has no unit stride and is copied before the product
+    auto x = Tensor({1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, {2, 2, 2}, true);
+    auto m = x.Transpose(0, 2).ValueTensor({1});  // m[i][j] = x[j][i][1]
+    auto z = m.Matmul(Tensor({1.0, 1.0}, {2, 1})).Sum();
+
+    z.Backward();
+
+    return !m.IsContiguous() && equal(m, {2.0, 6.0, 4.0, 8.0}) && std::abs(z.Value() - 20.0) < EPSILON
+        && equal_grad(x, {0.0, 1.0, 0.0, 1.0, 0.0, 1.0, 0.0, 1.0});
+}
+
+int main() {
+    struct Test {
+        std::string name;
+        bool (*func)();
+    };
+
+    std::vector<Test> tests = {
+        {"ValueTensor shares the Data of its source", test_value_tensor_shares_data},
+        {"Reshape and Flatten leave other handles unchanged", test_reshape_keeps_other_handles},
+        {"Transpose and Slice layouts", test_transpose_and_slice_layout},
+        {"Gradient through Slice and ValueTensor", test_gradient_through_slice},
+        {"Matmul with transposed views (forward and backward)", test_matmul_with_transposed_views},
+        {"Matmul with a non-contiguous operand", test_matmul_with_noncontiguous_operand}
+    };
+
+    int passed = 0;
+    int total = tests.size();
+
+    for (int i = 0; i < total; i++) {
+        std::cout << "Test " << (i + 1) << ": " << tests[i].name << ": ";
+        if (tests[i].func()) {
+            std::cout << "PASS\n";
+            passed++;
+        } else {
+            std::cout << "FAIL\n";
+        }
+    }
+
+    std::cout << "\nResults: " << passed << "/" << total << " tests passed\n";
+    return (passed == total) ? 0 : 1;
+}